@@ -0,0 +1,98 @@
+#!/bin/sh
+#
+# @file bench.sh
+# @author Afonso Campos (afonso.campos@ua.pt)
+# @author Simão Arrais (simaoarrais@ua.pt)
+# @brief Problem name: Vowel Count.
+#
+#  Scaling benchmark of the vowel counters: each configuration (threads or ranks, chunk size) is run a number of
+#  times with --format=csv, the best throughput is kept, and throughput and speedup tables are printed, the speedup
+#  being over the smallest number of threads (ranks) for the same chunk size.
+#
+#  Usage: bench.sh [-p prog1] [-m MPI prog1] [-t "threads"] [-r "ranks"] [-c "chunk sizes"] [-k repeats] input...
+#         input being files and directories, e.g. a corpus made by genCorpus.
+#         MPIRUN overrides the MPI launcher (e.g. "mpirun --oversubscribe").
+#
+# @version 0.1
+# @date 2023-03-22
+#
+# @copyright Copyright (c) 2023
+#
+
+prog1=../prog1/prog1
+mpiProg1=
+threads="1 2 4 8"
+ranks="2 3 5 9"
+chunks="4K 64K 1M auto"
+repeats=3
+
+usage() {
+    echo "Usage: $0 [-p prog1] [-m MPI prog1] [-t \"threads\"] [-r \"ranks\"] [-c \"chunk sizes\"] [-k repeats] input..." >&2
+    exit 1
+}
+
+while getopts "p:m:t:r:c:k:h" opt; do
+    case $opt in
+        p) prog1=$OPTARG ;;
+        m) mpiProg1=$OPTARG ;;
+        t) threads=$OPTARG ;;
+        r) ranks=$OPTARG ;;
+        c) chunks=$OPTARG ;;
+        k) repeats=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || usage
+
+# best throughput (MB/s) of a command over the repeats, from the last line of its CSV output
+best() {
+    top=0
+    i=0
+    while [ $i -lt "$repeats" ]; do
+        line=$("$@" --format=csv 2>/dev/null | tail -n 1)
+        case $line in
+            *,*,*) ;;
+            *) echo "bench.sh: $* failed" >&2; echo 0; return ;;
+        esac
+        top=$(echo "$line" | awk -F, -v top="$top" '{ print ($3 > top) ? $3 : top }')
+        i=$((i + 1))
+    done
+    echo "$top"
+}
+
+# tables of a program: $1 title, $2 label of the columns, $3 their values, then the command with @N@ and @C@
+table() {
+    title=$1
+    label=$2
+    values=$3
+    shift 3
+    results=
+    for c in $chunks; do
+        row=$c
+        for n in $values; do
+            cmd=$(echo "$*" | sed -e "s/@N@/$n/g" -e "s/@C@/$c/g")
+            row="$row $(best $cmd)"
+        done
+        results="$results$row
+"
+    done
+
+    printf '\n%s: throughput (MB/s)\n' "$title"
+    printf '%-8s' chunk
+    for n in $values; do printf ' %10s' "$label$n"; done
+    printf '\n'
+    printf '%s' "$results" | awk '{ printf "%-8s", $1; for(i = 2; i <= NF; i++) printf " %10.1f", $i; printf "\n" }'
+
+    printf '\n%s: speedup\n' "$title"
+    printf '%-8s' chunk
+    for n in $values; do printf ' %10s' "$label$n"; done
+    printf '\n'
+    printf '%s' "$results" |
+        awk '{ printf "%-8s", $1; for(i = 2; i <= NF; i++) printf " %10.2f", ($2 > 0) ? $i / $2 : 0; printf "\n" }'
+}
+
+table "prog1" "t=" "$threads" "$prog1" -t @N@ -c @C@ -f "$@"
+if [ -n "$mpiProg1" ]; then
+    table "MPI prog1" "n=" "$ranks" ${MPIRUN:-mpirun} -n @N@ "$mpiProg1" -c @C@ -f "$@"
+fi
@@ -0,0 +1,338 @@
+/**
+ * @file checkKernels.c
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ *  Check of the block kernels of the vowel counter against the letter by letter one, and of the counts of texts cut
+ *  in chunks against those of the whole texts.
+ *
+ *  Short random texts are built from runs of ASCII letters, of bytes which neither start nor end a word (digits, '='),
+ *  of separators and brackets, from two and three byte letters and from malformed UTF8 (cut characters, stray
+ *  continuation bytes), so words and separators fall on every position of the 32 byte blocks, and blocks holding no
+ *  separator follow words ended letter by letter. Each kernel the CPU supports counts every text as a whole and
+ *  summarizes chunks of it starting and ending at random offsets; the counts and summaries must be those of the
+ *  scalar kernel. Every text is also cut at random offsets and the summaries of its chunks folded, with and without
+ *  letters and word lengths; the counts must be those of the whole text. The first text found to differ is printed.
+ *
+ *  Build: gcc -O2 -o checkKernels checkKernels.c ../prog1/prog1Utils.c -lm
+ *  Usage: checkKernels [-n texts] [-r seed]
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <libgen.h>
+#include <unistd.h>
+
+#include "../prog1/prog1Utils.h"
+
+/** \brief default number of texts checked. */
+#define CHECKTEXTS 200000
+
+/** \brief longest text checked, in bytes. */
+#define CHECKSIZE 256
+
+/** \brief longest run of letters or neutral bytes, in bytes. */
+#define CHECKRUN 40
+
+/** \brief chunks summarized per text. */
+#define CHECKCHUNKS 4
+
+/** \brief most cuts of a text whose chunks are folded. */
+#define CHECKCUTS 4
+
+/** \brief kernels compared with the scalar one, skipped if the CPU lacks them. */
+static const char * const kernels[] = {"sse4.2", "avx2"};
+
+/** \brief ASCII letters, vowels and capitals included. */
+static const char letters[] = "abcdeiouyzAEIOUY_";
+
+/** \brief bytes which neither start nor end a word. */
+static const char neutrals[] = "0123456789='";
+
+/** \brief separators, brackets (which start a word outside of one and end it otherwise) included. */
+static const char * const separators[] = {" ", "\n", ",", ".", "[", "]", "“", "–", "…"};
+
+/** \brief two byte letters, accented vowels included. */
+static const char * const wideLetters[] = {"ç", "ã", "é", "Í", "õ", "ü", "ý", "ñ"};
+
+/** \brief malformed UTF8: characters missing bytes, stray continuation bytes and bytes which never start one. */
+static const char * const malformed[] = {"\xc3", "\xe2", "\xe2\x80", "\xf0\x9f", "\xf0\x9f\x98", "\x80", "\xa9", "\xbf", "\xff"};
+
+/** \brief counts of a text and summaries of chunks of it, as given by one kernel. */
+struct textCounts {
+    unsigned int words;                                 /**< words of the whole text */
+    unsigned int vowels[LETTER_VOWELNUM];               /**< words of the whole text holding each vowel */
+    struct chunkSummary summaries[CHECKCHUNKS];         /**< summaries of the chunks */
+};
+
+/** \brief state of a random number generator (xorshift64*). */
+typedef uint64_t randomState;
+
+/**
+ * @brief Draw the next number of a random number generator.
+ *
+ * @param state state of the generator, never 0
+ * @return uint64_t : random number
+ */
+static uint64_t nextRandom(randomState * state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Draw a number uniformly in [0, n).
+ *
+ * @param state state of the generator
+ * @param n number of values
+ * @return int : random number
+ */
+static int draw(randomState * state, int n) {
+    return (int)(nextRandom(state) % (uint64_t)n);
+}
+
+/**
+ * @brief Append a string to a text, if it fits.
+ *
+ * @param text text
+ * @param size size of the text, in bytes, updated
+ * @param piece string to append
+ */
+static void append(char * text, int * size, const char * piece) {
+    int length = strlen(piece);
+    if(*size + length > CHECKSIZE) return;
+    memcpy(&text[*size], piece, length);
+    *size += length;
+}
+
+/**
+ * @brief Build a random text.
+ *
+ * @param state state of the generator
+ * @param text output variable, text (CHECKSIZE bytes at most)
+ * @return int : size of the text, in bytes
+ */
+static int buildText(randomState * state, char * text) {
+    int size = 0, target = 1 + draw(state, CHECKSIZE);
+    char run[CHECKRUN + 1];
+
+    while(size < target) {
+        int kind = draw(state, 5), length = 1 + draw(state, CHECKRUN);
+        switch(kind) {
+            case 0: // letters
+                for(int i = 0; i < length; i++) run[i] = letters[draw(state, sizeof(letters) - 1)];
+                run[length] = '\0';
+                append(text, &size, run);
+                break;
+            case 1: // neutral bytes
+                for(int i = 0; i < length; i++) run[i] = neutrals[draw(state, sizeof(neutrals) - 1)];
+                run[length] = '\0';
+                append(text, &size, run);
+                break;
+            case 2:
+                append(text, &size, separators[draw(state, sizeof(separators) / sizeof(separators[0]))]);
+                break;
+            case 3:
+                append(text, &size, malformed[draw(state, sizeof(malformed) / sizeof(malformed[0]))]);
+                break;
+            default:
+                append(text, &size, wideLetters[draw(state, sizeof(wideLetters) / sizeof(wideLetters[0]))]);
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Count a text and summarize chunks of it with the kernels in use.
+ *
+ * @param text text
+ * @param size size of the text, in bytes
+ * @param chunks start and end of each chunk
+ * @param counts output variable, counts and summaries
+ */
+static void countText(const unsigned char * text, int size, const int chunks[][2], struct textCounts * counts) {
+    memset(counts, 0, sizeof(struct textCounts));
+    countWords(text, size, &counts->words, counts->vowels);
+    for(int c = 0; c < CHECKCHUNKS; c++) {
+        summarizeChunk(&text[chunks[c][0]], chunks[c][1] - chunks[c][0], &counts->summaries[c]);
+    }
+}
+
+/**
+ * @brief Count a text cut in chunks, folding their summaries.
+ *
+ * @param text text
+ * @param size size of the text, in bytes
+ * @param cuts offsets the text is cut at, in increasing order
+ * @param nCuts number of cuts
+ * @param stats statistics to gather
+ * @param tally output variable, counts of the text
+ * @param extra output variable, statistics of the text
+ */
+static void foldCuts(const unsigned char * text, int size, const int * cuts, int nCuts, int stats,
+                     struct wordTally * tally, struct statsTally * extra) {
+    struct chunkSummary summary;
+    struct chunkStats chunkExtra;
+
+    memset(tally, 0, sizeof(struct wordTally));
+    memset(extra, 0, sizeof(struct statsTally));
+    for(int c = 0; c <= nCuts; c++) {
+        int start = (c > 0) ? cuts[c - 1] : 0, end = (c < nCuts) ? cuts[c] : size;
+        summarizeChunkStats(&text[start], end - start, stats, &summary, &chunkExtra);
+        foldChunkStats(tally, extra, &summary, &chunkExtra, stats);
+    }
+    finishTallyStats(tally, extra, stats);
+}
+
+/**
+ * @brief Tell if two summaries of a chunk are the same.
+ *
+ * @param a summary
+ * @param b summary
+ * @return true if every field is the same
+ */
+static bool sameSummary(const struct chunkSummary * a, const struct chunkSummary * b) {
+    if((a->headSize != b->headSize) || memcmp(a->head, b->head, a->headSize) || (a->tailSize != b->tailSize) ||
+       memcmp(a->tail, b->tail, a->tailSize) || (a->hasLetters != b->hasLetters)) return false;
+    if((a->continuedVowels != b->continuedVowels) || (a->continuedThrough != b->continuedThrough)) return false;
+    for(int s = 0; s < 2; s++) {
+        if((a->words[s] != b->words[s]) || memcmp(a->vowels[s], b->vowels[s], sizeof(a->vowels[s])) ||
+           (a->exitInWord[s] != b->exitInWord[s]) || (a->exitVowels[s] != b->exitVowels[s])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Print a text as a C string.
+ *
+ * @param text text
+ * @param size size of the text, in bytes
+ */
+static void printText(const unsigned char * text, int size) {
+    putchar('"');
+    for(int i = 0; i < size; i++) {
+        if((text[i] >= 0x20) && (text[i] < 0x7F) && (text[i] != '"') && (text[i] != '\\')) putchar(text[i]);
+        else printf("\\x%02x\"\"", text[i]);
+    }
+    printf("\"\n");
+}
+
+/**
+ * @brief Main thread.
+ *
+ *  \param argc number of words of the command line
+ *  \param argv list of words of the command line
+ *
+ *  \return status of operation
+ */
+int main(int argc, char *argv[]) {
+    int opt;
+    long long nTexts = CHECKTEXTS;
+    randomState state = 1;
+
+    opterr = 0;
+    while((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch(opt) {
+            case 'n':
+                nTexts = atoll(optarg);
+                break;
+            case 'r':
+                state = strtoull(optarg, NULL, 10) | 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n texts] [-r seed]\n", basename(argv[0]));
+                return EXIT_FAILURE;
+        }
+    }
+
+    int nKernels = 0;
+    bool supported[sizeof(kernels) / sizeof(kernels[0])];
+    for(size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if((supported[k] = useKernels(kernels[k]))) nKernels++;
+        else printf("%s: not supported by the CPU, skipped\n", kernels[k]);
+    }
+
+    unsigned char text[CHECKSIZE];
+    int chunks[CHECKCHUNKS][2];
+    struct textCounts expected, found;
+    for(long long t = 0; t < nTexts; t++) {
+        int size = buildText(&state, (char *)text);
+        for(int c = 0; c < CHECKCHUNKS; c++) { // chunks may start or end inside a letter
+            chunks[c][0] = draw(&state, size);
+            chunks[c][1] = chunks[c][0] + 1 + draw(&state, size - chunks[c][0]);
+        }
+        useKernels("scalar");
+        countText(text, size, (const int (*)[2])chunks, &expected);
+        for(size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+            if(!supported[k]) continue;
+            useKernels(kernels[k]);
+            countText(text, size, (const int (*)[2])chunks, &found);
+            bool same = (found.words == expected.words) && !memcmp(found.vowels, expected.vowels, sizeof(found.vowels));
+            for(int c = 0; same && (c < CHECKCHUNKS); c++) {
+                if(!sameSummary(&found.summaries[c], &expected.summaries[c])) {
+                    printf("%s: summary of bytes %d to %d differs from the scalar kernel's, text:\n", kernels[k],
+                           chunks[c][0], chunks[c][1]);
+                    printText(text, size);
+                    return EXIT_FAILURE;
+                }
+            }
+            if(!same) {
+                printf("%s: %u words (", kernels[k], found.words);
+                for(int j = 0; j < LETTER_VOWELNUM; j++) printf("%s%u", j ? " " : "", found.vowels[j]);
+                printf("), scalar kernel %u words (", expected.words);
+                for(int j = 0; j < LETTER_VOWELNUM; j++) printf("%s%u", j ? " " : "", expected.vowels[j]);
+                printf("), text:\n");
+                printText(text, size);
+                return EXIT_FAILURE;
+            }
+        }
+
+        int nCuts = draw(&state, CHECKCUTS + 1), cuts[CHECKCUTS];
+        for(int c = 0; c < nCuts; c++) cuts[c] = draw(&state, size + 1);
+        for(int c = 1; c < nCuts; c++) { // sort the cuts, chunks may be empty
+            for(int d = c; (d > 0) && (cuts[d - 1] > cuts[d]); d--) {
+                int cut = cuts[d];
+                cuts[d] = cuts[d - 1];
+                cuts[d - 1] = cut;
+            }
+        }
+        for(int stats = STAT_VOWELS; stats <= (STAT_VOWELS | STAT_LETTERS | STAT_LENGTHS); stats += STAT_LETTERS) {
+            struct wordTally whole, cut;
+            struct statsTally wholeExtra, cutExtra;
+            foldCuts(text, size, NULL, 0, stats, &whole, &wholeExtra);
+            foldCuts(text, size, cuts, nCuts, stats, &cut, &cutExtra);
+            bool counted = (whole.words == expected.words);
+            for(int j = 0; j < LETTER_VOWELNUM; j++) counted = counted && (whole.vowels[j] == expected.vowels[j]);
+            if(!counted) {
+                printf("statistics %d: whole text summarized and counted differ, text:\n", stats);
+                printText(text, size);
+                return EXIT_FAILURE;
+            }
+            if((cut.words != whole.words) || memcmp(cut.vowels, whole.vowels, sizeof(cut.vowels)) ||
+               memcmp(&cutExtra, &wholeExtra, sizeof(struct statsTally))) {
+                printf("statistics %d: text cut at", stats);
+                for(int c = 0; c < nCuts; c++) printf(" %d", cuts[c]);
+                printf(" gives %llu words (", cut.words);
+                for(int j = 0; j < LETTER_VOWELNUM; j++) printf("%s%llu", j ? " " : "", cut.vowels[j]);
+                printf("), whole %llu words (", whole.words);
+                for(int j = 0; j < LETTER_VOWELNUM; j++) printf("%s%llu", j ? " " : "", whole.vowels[j]);
+                printf(") or other statistics, text:\n");
+                printText(text, size);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    printf("%lld texts, %d kernels match the scalar one, cut texts count as whole ones\n", nTexts, nKernels);
+
+    return EXIT_SUCCESS;
+}
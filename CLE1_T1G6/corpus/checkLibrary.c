@@ -0,0 +1,336 @@
+/**
+ * @file checkLibrary.c
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ *  Check of libvowelcount against the vowel counter.
+ *
+ *  The files are counted by prog1 with the monitor of prog1SM.c (memory-mapped, then with stealing), which is the
+ *  reference, and by a plain run of prog1, counted by a pool of the library. They are then counted by the library
+ *  itself: by jobs of several chunk sizes on one pool, by two jobs submitted at once to that pool from two threads,
+ *  by a job on a pool started for it only, and streamed through vc_count_buffer in pieces of random sizes (empty
+ *  pieces and pieces cutting letters included). The counts of every file must be those of the reference; the first
+ *  file found to differ is printed.
+ *
+ *  Build: gcc -O2 -o checkLibrary checkLibrary.c ../prog1/vowelCount.c ../prog1/prog1Utils.c -pthread -lm
+ *  Usage: checkLibrary [-p prog1] [-t threads] [-r seed] file...
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "../prog1/vowelCount.h"
+
+/** \brief longest line of the output of prog1 read, in bytes. */
+#define MAXLINE 4096
+
+/** \brief largest piece given to vc_count_buffer, in bytes. */
+#define MAXPIECE 8192
+
+/** \brief counts of a file. */
+struct fileCounts {
+    uint64_t words;                 /**< number of words */
+    uint64_t vowels[VC_VOWELS];     /**< number of words holding each vowel */
+    bool found;                     /**< the file was reported */
+};
+
+/** \brief job submitted to a shared pool from a thread of its own. */
+struct sharedJob {
+    vc_pool * pool;                 /**< the pool */
+    const char * const * paths;     /**< names of the files */
+    size_t nPaths;                  /**< number of files */
+    size_t chunkSize;               /**< size, in bytes, of the chunks */
+    vc_result * results;            /**< counts of each file */
+    int status;                     /**< value returned by vc_count_files */
+};
+
+/**
+ * @brief Run prog1 on the files and read the counts it reports.
+ *
+ * @param prog1 path of prog1
+ * @param mode options of the run, NULL terminated
+ * @param paths names of the files
+ * @param nPaths number of files
+ * @param counts output variable, counts of each file
+ * @return true if prog1 reported every file and ended with success, false otherwise
+ */
+static bool runProg1(const char * prog1, const char * const * mode, char ** paths, int nPaths, struct fileCounts * counts) {
+    int link[2], nMode = 0;
+    pid_t pid;
+
+    while(mode[nMode] != NULL) nMode++;
+    char ** args = (char **)malloc((nMode + nPaths + 3) * sizeof(char *));
+    if((args == NULL) || (pipe(link) == -1)) {
+        free(args);
+        return false;
+    }
+    args[0] = (char *)prog1;
+    for(int i = 0; i < nMode; i++) args[1 + i] = (char *)mode[i];
+    args[1 + nMode] = "-f";
+    for(int i = 0; i < nPaths; i++) args[2 + nMode + i] = paths[i];
+    args[2 + nMode + nPaths] = NULL;
+
+    if((pid = fork()) == -1) {
+        free(args);
+        return false;
+    }
+    if(pid == 0) {
+        dup2(link[1], STDOUT_FILENO);
+        close(link[0]);
+        close(link[1]);
+        execv(prog1, args);
+        _exit(127);
+    }
+    free(args);
+    close(link[1]);
+
+    FILE * out = fdopen(link[0], "r");
+    char line[MAXLINE];
+    int idx = -1;
+    memset(counts, 0, nPaths * sizeof(struct fileCounts));
+    while((out != NULL) && (fgets(line, sizeof(line), out) != NULL)) {
+        line[strcspn(line, "\n")] = '\0';
+        if(strncmp(line, "File name: ", 11) == 0) { // files are reported as they are done, found by name
+            for(idx = 0; (idx < nPaths) && (counts[idx].found || (strcmp(paths[idx], line + 11) != 0)); idx++);
+            if(idx == nPaths) idx = -1;
+        }
+        else if((idx >= 0) && (sscanf(line, "Total number of words = %" SCNu64, &counts[idx].words) == 1)) continue;
+        else if((idx >= 0) && (line[0] == '\t') && (line[1] >= '0') && (line[1] <= '9')) {
+            char * end = line;
+            for(int k = 0; k < VC_VOWELS; k++) counts[idx].vowels[k] = strtoull(end, &end, 10);
+            counts[idx].found = true;
+            idx = -1;
+        }
+    }
+    if(out != NULL) fclose(out);
+    else close(link[0]);
+
+    int status;
+    if((waitpid(pid, &status, 0) == -1) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) return false;
+    for(int i = 0; i < nPaths; i++) if(!counts[i].found) return false;
+    return true;
+}
+
+/**
+ * @brief Compare the counts of a file with those of the reference, printing them if they differ.
+ *
+ * @param how name of the way the file was counted
+ * @param path name of the file
+ * @param words number of words counted
+ * @param vowels number of words holding each vowel counted
+ * @param reference counts of the reference
+ * @return true if the counts are those of the reference, false otherwise
+ */
+static bool sameCounts(const char * how, const char * path, uint64_t words, const uint64_t * vowels,
+                       const struct fileCounts * reference) {
+    bool same = (words == reference->words);
+    for(int k = 0; k < VC_VOWELS; k++) same = same && (vowels[k] == reference->vowels[k]);
+    if(same) return true;
+
+    printf("%s differs on %s:\n\t%" PRIu64 " words", how, path, words);
+    for(int k = 0; k < VC_VOWELS; k++) printf(" %" PRIu64, vowels[k]);
+    printf("\n\t%" PRIu64 " words", reference->words);
+    for(int k = 0; k < VC_VOWELS; k++) printf(" %" PRIu64, reference->vowels[k]);
+    printf(" expected\n");
+    return false;
+}
+
+/**
+ * @brief Compare the results of a job with the reference.
+ *
+ * @param how name of the job
+ * @param paths names of the files
+ * @param nPaths number of files
+ * @param results counts of each file
+ * @param reference counts of the reference
+ * @return true if every file has the counts of the reference, false otherwise
+ */
+static bool sameResults(const char * how, char ** paths, int nPaths, const vc_result * results,
+                        const struct fileCounts * reference) {
+    for(int i = 0; i < nPaths; i++) {
+        if(results[i].error != 0) {
+            printf("%s could not count %s: %s\n", how, paths[i], strerror(results[i].error));
+            return false;
+        }
+        if(!sameCounts(how, paths[i], results[i].words, results[i].vowels, &reference[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Submit a job to a shared pool, from a thread of its own.
+ *
+ * @param args the job
+ * @return void* : NULL
+ */
+static void * submitShared(void * args) {
+    struct sharedJob * job = (struct sharedJob *)args;
+
+    job->status = vc_count_files(job->pool, job->paths, job->nPaths, job->chunkSize, job->results, NULL, NULL);
+    return NULL;
+}
+
+/**
+ * @brief Count a file through vc_count_buffer, in pieces of random sizes.
+ *
+ * @param path name of the file
+ * @param result output variable, counts of the file
+ * @return true on success, false otherwise (errno is set)
+ */
+static bool streamFile(const char * path, vc_result * result) {
+    uint8_t piece[MAXPIECE];
+    vc_state state;
+    int fd;
+
+    if((fd = open(path, O_RDONLY)) == -1) return false;
+    vc_init(&state);
+    memset(result, 0, sizeof(vc_result));
+    while(true) {
+        size_t size = (random() % 4 == 0) ? (size_t)(random() % 7) : (size_t)(random() % MAXPIECE); // some letters cut
+        ssize_t n = read(fd, piece, size);
+        if(n < 0) {
+            close(fd);
+            return false;
+        }
+        vc_count_buffer(piece, (size_t)n, &state, result);
+        if((n == 0) && (size > 0)) break;
+    }
+    close(fd);
+    return true;
+}
+
+/**
+ * @brief Main thread.
+ *
+ *  \param argc number of words of the command line
+ *  \param argv list of words of the command line
+ *
+ *  \return status of operation
+ */
+int main(int argc, char *argv[]) {
+    int opt, nThreads = 3;
+    const char * prog1 = "../prog1/prog1";
+    unsigned int seed = 1;
+
+    opterr = 0;
+    while((opt = getopt(argc, argv, "p:t:r:")) != -1) {
+        switch(opt) {
+            case 'p':
+                prog1 = optarg;
+                break;
+            case 't':
+                nThreads = atoi(optarg);
+                break;
+            case 'r':
+                seed = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "%s: invalid option\n", basename(argv[0]));
+                return EXIT_FAILURE;
+        }
+    }
+    if((optind >= argc) || (nThreads <= 0)) {
+        fprintf(stderr, "usage: %s [-p prog1] [-t threads] [-r seed] file...\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+    srandom(seed);
+
+    char ** paths = &argv[optind];
+    int nPaths = argc - optind;
+    struct fileCounts * reference, * counts;
+    vc_result * results, * others;
+    if(((reference = (struct fileCounts *)malloc(nPaths * sizeof(struct fileCounts))) == NULL) ||
+       ((counts = (struct fileCounts *)malloc(nPaths * sizeof(struct fileCounts))) == NULL) ||
+       ((results = (vc_result *)malloc(nPaths * sizeof(vc_result))) == NULL) ||
+       ((others = (vc_result *)malloc(nPaths * sizeof(vc_result))) == NULL)) {
+        fprintf(stderr, "Error on allocating memory.\n");
+        return EXIT_FAILURE;
+    }
+
+    // the monitor of prog1SM.c is the reference, prog1 counts a plain run with the library
+    char threads[16];
+    snprintf(threads, sizeof(threads), "%d", nThreads);
+    const char * mapped[] = {"-m", "-t", threads, NULL};
+    const char * stealing[] = {"-s", "-t", threads, "-c", "4K", NULL};
+    const char * plain[] = {"-t", threads, "-c", "4K", NULL};
+    if(!runProg1(prog1, mapped, paths, nPaths, reference)) {
+        fprintf(stderr, "%s: %s -m did not report every file\n", basename(argv[0]), prog1);
+        return EXIT_FAILURE;
+    }
+    const char * const * modes[] = {stealing, plain};
+    const char * modeNames[] = {"prog1 -s", "prog1 (plain run)"};
+    for(int m = 0; m < 2; m++) {
+        if(!runProg1(prog1, modes[m], paths, nPaths, counts)) {
+            printf("%s did not report every file\n", modeNames[m]);
+            return EXIT_FAILURE;
+        }
+        for(int i = 0; i < nPaths; i++) {
+            if(!sameCounts(modeNames[m], paths[i], counts[i].words, counts[i].vowels, &reference[i])) return EXIT_FAILURE;
+        }
+    }
+
+    // jobs of several chunk sizes on one pool, then two jobs at once on it
+    vc_pool * pool;
+    if((pool = vc_pool_create(nThreads)) == NULL) {
+        perror("Error on creating the pool.");
+        return EXIT_FAILURE;
+    }
+    const size_t chunkSizes[] = {CHUNKSIZE_MIN, 64 * 1024, 0};
+    for(int c = 0; c < (int)(sizeof(chunkSizes) / sizeof(chunkSizes[0])); c++) {
+        char how[64];
+        snprintf(how, sizeof(how), "vc_count_files (chunks of %zu bytes)", chunkSizes[c]);
+        if((vc_count_files(pool, (const char * const *)paths, nPaths, chunkSizes[c], results, NULL, NULL) == -1) ||
+           !sameResults(how, paths, nPaths, results, reference)) return EXIT_FAILURE;
+    }
+    struct sharedJob jobs[2] = {
+        {pool, (const char * const *)paths, nPaths, CHUNKSIZE_MIN, results, 0},
+        {pool, (const char * const *)paths, nPaths, 16 * 1024, others, 0}
+    };
+    pthread_t submitters[2];
+    for(int j = 0; j < 2; j++) {
+        if(pthread_create(&submitters[j], NULL, submitShared, &jobs[j]) != 0) {
+            perror("Error on creating thread submitter.");
+            return EXIT_FAILURE;
+        }
+    }
+    for(int j = 0; j < 2; j++) pthread_join(submitters[j], NULL);
+    if((jobs[0].status == -1) || (jobs[1].status == -1) ||
+       !sameResults("vc_count_files (two jobs at once)", paths, nPaths, results, reference) ||
+       !sameResults("vc_count_files (two jobs at once)", paths, nPaths, others, reference)) return EXIT_FAILURE;
+    vc_pool_destroy(pool);
+
+    // a pool for the job only, then each file streamed
+    if((vc_count_files(NULL, (const char * const *)paths, nPaths, 0, results, NULL, NULL) == -1) ||
+       !sameResults("vc_count_files (pool of its own)", paths, nPaths, results, reference)) return EXIT_FAILURE;
+    for(int i = 0; i < nPaths; i++) {
+        if(!streamFile(paths[i], &results[i])) {
+            printf("vc_count_buffer could not read %s: %s\n", paths[i], strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    if(!sameResults("vc_count_buffer", paths, nPaths, results, reference)) return EXIT_FAILURE;
+
+    printf("%d files counted alike by prog1 and libvowelcount\n", nPaths);
+    free(reference);
+    free(counts);
+    free(results);
+    free(others);
+
+    return EXIT_SUCCESS;
+}
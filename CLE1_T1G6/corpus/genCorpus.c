@@ -0,0 +1,516 @@
+/**
+ * @file genCorpus.c
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ *  Generator of synthetic Portuguese-like UTF8 corpora, for performance work on the vowel counter.
+ *
+ *  Words are built from syllables of Portuguese consonants (ç, lh, nh, ch, qu and gu included) and vowels, some of
+ *  them accented (á, â, ã, é, ê, í, ó, ô, õ, ú, ü); sentences start with a capital letter and words are followed by
+ *  spaces, newlines or punctuation, the three byte “ ” – … separators included. Apostrophes and hyphens join words
+ *  now and then, as in d'água or guarda-chuva. The total size is shared among the files following a distribution:
+ *  fixed (equal sizes), uniform (between half and one and a half times the mean) or pareto (heavy tailed, a few large
+ *  files and many small ones).
+ *
+ *  The output only depends on the options: each file is drawn from a generator seeded with the seed and its index.
+ *  Files are as large as asked for, but for the last character when it would not fit (up to 3 bytes short).
+ *  Asked for, the counts the vowel counter must print are written to the standard output, in its own format. They
+ *  are taken from the generator's own record of the letters it wrote, the words they belong to and the vowels they
+ *  hold, so they do not depend on the code under test.
+ *
+ *  Build: gcc -O2 -o genCorpus genCorpus.c -lm
+ *  Usage: genCorpus [-s total size in MB] [-n files] [-d fixed|uniform|pareto] [-a accent density]
+ *                   [-w mean word length] [-p punctuation density] [-r seed] [-c] directory
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/** \brief default total size of the corpus, in MB. */
+#define CORPUSSIZE 1024
+
+/** \brief size of the blocks the files are written in, each ends after a separator. */
+#define CORPUSBLOCK (1 << 20)
+
+/** \brief longest piece written at once (a word or a separator), in bytes. */
+#define MAXPIECE 256
+
+/** \brief shape of the pareto distribution of the file sizes. */
+#define PARETOSHAPE 1.5
+
+/** \brief number of vowels counted (a, e, i, o, u, y). */
+#define VOWELNUM 6
+
+/** \brief index of the vowel u, held by the qu and gu digraphs. */
+#define VOWEL_U 4
+
+/** \brief state of a random number generator (xorshift64*). */
+typedef uint64_t randomState;
+
+/** \brief options of the generator */
+struct corpusOptions {
+    double accents;         /**< probability of a vowel being accented */
+    double wordLength;      /**< mean number of letters of a word */
+    double punctuation;     /**< probability of a word being followed by punctuation */
+};
+
+/** \brief letter written to a block, as the vowel counter must see it. */
+struct writtenLetter {
+    int end;                /**< offset, in the block, right after the letter */
+    signed char vowel;      /**< vowel the letter holds, accents and case aside (-1 if none) */
+    bool startsWord;        /**< the letter starts a word (the words joined by an apostrophe are one) */
+};
+
+/** \brief record of the letters written to a block. */
+struct blockRecord {
+    struct writtenLetter * letters;     /**< letters, in the order they were written */
+    int nLetters;                       /**< number of letters */
+    bool wordStart;                     /**< the next letter written starts a word */
+};
+
+/** \brief consonants, and the digraphs written as one. */
+static const char * const consonants[] = {
+    "b", "c", "d", "f", "g", "j", "l", "m", "n", "p", "r", "s", "t", "v", "x", "z",
+    "ç", "lh", "nh", "ch", "qu", "gu", "rr", "ss", "k", "w"
+};
+
+/** \brief relative frequency of each consonant. */
+static const int consonantWeights[] = {
+    6, 10, 12, 4, 4, 2, 8, 10, 10, 8, 14, 14, 12, 5, 2, 2,
+    2, 2, 2, 2, 2, 1, 2, 2, 1, 1
+};
+
+/** \brief vowels, y included. */
+static const char * const vowels[] = {"a", "e", "i", "o", "u", "y"};
+
+/** \brief relative frequency of each vowel. */
+static const int vowelWeights[] = {28, 25, 12, 22, 10, 1};
+
+/** \brief accented forms of each vowel (y has none). */
+static const char * const accented[][4] = {
+    {"á", "â", "ã", "à"}, {"é", "ê", "é", "ê"}, {"í", "í", "í", "í"}, {"ó", "ô", "õ", "ó"}, {"ú", "ü", "ú", "ú"}, {"y", "y", "y", "y"}
+};
+
+/** \brief capital forms of the vowels and of their accented forms, in the same order. */
+static const char * const capitalVowels[] = {"A", "E", "I", "O", "U", "Y"};
+static const char * const capitalAccented[][4] = {
+    {"Á", "Â", "Ã", "À"}, {"É", "Ê", "É", "Ê"}, {"Í", "Í", "Í", "Í"}, {"Ó", "Ô", "Õ", "Ó"}, {"Ú", "Ü", "Ú", "Ú"}, {"Y", "Y", "Y", "Y"}
+};
+
+/** \brief punctuation ending a sentence. */
+static const char * const sentenceEnds[] = {".", "!", "?", "…"};
+
+/** \brief punctuation inside a sentence. */
+static const char * const pauses[] = {",", ";", ":", " –", ",", " -"};
+
+/**
+ * @brief Draw the next number of a random number generator.
+ *
+ * @param state state of the generator, never 0
+ * @return uint64_t : random number
+ */
+static uint64_t nextRandom(randomState * state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Draw a number uniformly in [0, 1).
+ *
+ * @param state state of the generator
+ * @return double : random number
+ */
+static double uniform(randomState * state) {
+    return (double)(nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Seed a generator from the seed and a stream index, with splitmix64.
+ *
+ * @param seed seed given by the user
+ * @param stream index of the stream (file)
+ * @return randomState : state of the generator
+ */
+static randomState seedRandom(uint64_t seed, uint64_t stream) {
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+/**
+ * @brief Pick an index following relative weights.
+ *
+ * @param state state of the generator
+ * @param weights weight of each index
+ * @param n number of indices
+ * @return int : index picked
+ */
+static int pickWeighted(randomState * state, const int * weights, int n) {
+    int total = 0;
+    for(int i = 0; i < n; i++) total += weights[i];
+    int r = (int)(uniform(state) * total);
+    for(int i = 0; i < n; i++) {
+        if(r < weights[i]) return i;
+        r -= weights[i];
+    }
+    return n - 1;
+}
+
+/**
+ * @brief Append a string to a piece of text.
+ *
+ * @param piece text, room for MAXPIECE bytes
+ * @param size number of bytes of the text, updated
+ * @param text string appended, dropped if it does not fit
+ * @return true if the string was appended, false if it was dropped
+ */
+static bool append(char * piece, int * size, const char * text) {
+    int length = (int)strlen(text);
+    if(*size + length >= MAXPIECE) return false;
+    memcpy(piece + *size, text, length);
+    *size += length;
+    return true;
+}
+
+/**
+ * @brief Append a letter to a word, recording it.
+ *
+ * @param piece word, room for MAXPIECE bytes
+ * @param size number of bytes of the word, updated
+ * @param text letter appended, dropped if it does not fit
+ * @param vowel vowel the letter holds (-1 if none)
+ * @param record record of the block, the letter is added to it
+ * @param offset offset, in the block, of the word
+ */
+static void appendLetter(char * piece, int * size, const char * text, int vowel, struct blockRecord * record, int offset) {
+    if(!append(piece, size, text)) return;
+    struct writtenLetter * letter = &record->letters[record->nLetters++];
+    letter->end = offset + *size;
+    letter->vowel = (signed char)vowel;
+    letter->startsWord = record->wordStart;
+    record->wordStart = false;
+}
+
+/**
+ * @brief Append a consonant to a word, recording each of its letters.
+ *
+ * @param piece word, room for MAXPIECE bytes
+ * @param size number of bytes of the word, updated
+ * @param text consonant appended, a digraph being two letters (ç is one, of two bytes)
+ * @param record record of the block, the letters are added to it
+ * @param offset offset, in the block, of the word
+ */
+static void appendConsonant(char * piece, int * size, const char * text, struct blockRecord * record, int offset) {
+    if((unsigned char)text[0] >= 0x80) { // ç or Ç
+        appendLetter(piece, size, text, -1, record, offset);
+        return;
+    }
+    for(int i = 0; text[i] != '\0'; i++) {
+        char letter[2] = {text[i], '\0'};
+        appendLetter(piece, size, letter, (text[i] == 'u') ? VOWEL_U : -1, record, offset); // qu and gu hold a u
+    }
+}
+
+/**
+ * @brief Write a word: alternating consonants and vowels, as many letters as drawn around the mean word length.
+ *
+ * @param state state of the generator
+ * @param options options of the generator
+ * @param capital true if the word starts a sentence
+ * @param piece output variable, bytes of the word
+ * @param record record of the block, the letters of the word are added to it
+ * @param offset offset, in the block, the word is written at
+ * @return int : number of bytes of the word
+ */
+static int makeWord(randomState * state, const struct corpusOptions * options, bool capital, char * piece,
+                    struct blockRecord * record, int offset) {
+    int size = 0;
+    int letters = 1 + (int)(-log(1.0 - uniform(state)) * (options->wordLength - 1.0)); // geometric-like, mean wordLength
+    if(letters > 4 * (int)options->wordLength + 4) letters = 4 * (int)options->wordLength + 4;
+    bool vowel = (uniform(state) < 0.4);
+
+    for(int l = 0; l < letters; l++, vowel = !vowel) {
+        if(vowel) {
+            int v = pickWeighted(state, vowelWeights, sizeof(vowelWeights) / sizeof(int));
+            bool accent = (uniform(state) < options->accents);
+            int form = (int)(uniform(state) * 4);
+            if(capital && (l == 0)) appendLetter(piece, &size, accent ? capitalAccented[v][form] : capitalVowels[v], v, record, offset);
+            else appendLetter(piece, &size, accent ? accented[v][form] : vowels[v], v, record, offset);
+        }
+        else {
+            const char * c = consonants[pickWeighted(state, consonantWeights, sizeof(consonantWeights) / sizeof(int))];
+            if(capital && (l == 0)) {
+                char upper[4];
+                if(strcmp(c, "ç") == 0) strcpy(upper, "Ç");
+                else {
+                    snprintf(upper, sizeof(upper), "%s", c);
+                    upper[0] = (char)(upper[0] - 'a' + 'A');
+                }
+                appendConsonant(piece, &size, upper, record, offset);
+            }
+            else appendConsonant(piece, &size, c, record, offset);
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Write what follows a word: an apostrophe or hyphen joining the next one, punctuation or a plain space.
+ *
+ * @param state state of the generator
+ * @param options options of the generator
+ * @param sentenceEnd output variable, true if the sentence ended
+ * @param joins output variable, true if the next word goes on the same word (an apostrophe is not a separator)
+ * @param piece output variable, bytes written
+ * @return int : number of bytes written
+ */
+static int makeSeparator(randomState * state, const struct corpusOptions * options, bool * sentenceEnd, bool * joins,
+                         char * piece) {
+    int size = 0;
+    double r = uniform(state);
+
+    *sentenceEnd = false;
+    *joins = (r < 0.01);
+    if(r < 0.01) append(piece, &size, "'"); // d'água
+    else if(r < 0.02) append(piece, &size, "-"); // guarda-chuva
+    else if(uniform(state) >= options->punctuation) append(piece, &size, (uniform(state) < 0.05) ? "\n" : " ");
+    else {
+        double kind = uniform(state);
+        if(kind < 0.35) {
+            append(piece, &size, sentenceEnds[(int)(uniform(state) * 4)]);
+            append(piece, &size, (uniform(state) < 0.2) ? "\n" : " ");
+            *sentenceEnd = true;
+        }
+        else if(kind < 0.75) {
+            append(piece, &size, pauses[(int)(uniform(state) * 6)]);
+            append(piece, &size, " ");
+        }
+        else if(kind < 0.85) append(piece, &size, "” “"); // quote closed and another opened
+        else if(kind < 0.92) append(piece, &size, " (");
+        else append(piece, &size, ") ");
+    }
+    return size;
+}
+
+/**
+ * @brief Count the words written to a block and, for each vowel, the words holding it, from the record of the block.
+ *
+ * @param record record of the block
+ * @param used number of bytes of the block written to the file (the letters past it are not counted)
+ * @param wordCount output variable, incremented by the number of words
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ */
+static void countRecord(const struct blockRecord * record, int used, unsigned long long * wordCount,
+                        unsigned long long * vowelCounts) {
+    unsigned char seen = 0;
+
+    for(int l = 0; (l < record->nLetters) && (record->letters[l].end <= used); l++) {
+        const struct writtenLetter * letter = &record->letters[l];
+        if(letter->startsWord) {
+            (*wordCount)++;
+            seen = 0;
+        }
+        if((letter->vowel >= 0) && !(seen & (1 << letter->vowel))) {
+            seen |= 1 << letter->vowel;
+            vowelCounts[letter->vowel]++;
+        }
+    }
+}
+
+/**
+ * @brief Get the size of an UTF8 character from its first byte.
+ *
+ * @param lead first byte of the character
+ * @return int : size of the character, in bytes
+ */
+static int characterSize(unsigned char lead) {
+    if(lead >= 0xF0) return 4;
+    if(lead >= 0xE0) return 3;
+    return (lead >= 0xC0) ? 2 : 1;
+}
+
+/**
+ * @brief Write a file of the corpus, in blocks ending after a separator.
+ *
+ * @param name name of the file
+ * @param size number of bytes of the file
+ * @param state state of the generator of the file
+ * @param options options of the generator
+ * @param wordCount output variable, number of words of the file (NULL if not counted)
+ * @param vowelCounts output variable, number of words of the file holding each vowel
+ * @return true on success, false otherwise (errno is set)
+ */
+static bool writeFile(const char * name, unsigned long long size, randomState * state, const struct corpusOptions * options,
+                      unsigned long long * wordCount, unsigned long long * vowelCounts) {
+    FILE * fp;
+    char * block;
+    char piece[MAXPIECE];
+    unsigned long long written = 0;
+    bool capital = true, joins = false;
+    struct blockRecord record = {NULL, 0, true};
+
+    if((fp = fopen(name, "wb")) == NULL) return false;
+    if(((block = (char *)malloc(CORPUSBLOCK + 2 * MAXPIECE)) == NULL) ||
+       ((record.letters = (struct writtenLetter *)malloc((CORPUSBLOCK + 2 * MAXPIECE) * sizeof(struct writtenLetter))) == NULL)) {
+        free(block);
+        fclose(fp);
+        return false;
+    }
+    while(written < size) {
+        int used = 0;
+        unsigned long long left = size - written;
+        int target = (left < CORPUSBLOCK) ? (int)left : CORPUSBLOCK;
+
+        record.nLetters = 0;
+        while((used < target) || joins) { // blocks end after a separator
+            record.wordStart = !joins;
+            int n = makeWord(state, options, capital, piece, &record, used);
+            memcpy(block + used, piece, n);
+            used += n;
+            n = makeSeparator(state, options, &capital, &joins, piece);
+            memcpy(block + used, piece, n);
+            used += n;
+        }
+        if(left <= (unsigned long long)used) { // last block, cut where the file ends but not inside a character
+            used = (int)left;
+            int start = used;
+            while((start > 0) && (((unsigned char)block[start - 1] & 0xC0) == 0x80)) start--;
+            if((start > 0) && ((unsigned char)block[start - 1] >= 0xC0) &&
+               (used - start + 1 < characterSize((unsigned char)block[start - 1]))) used = start - 1;
+            if(used == 0) break;
+        }
+        if(fwrite(block, 1, used, fp) != (size_t)used) {
+            free(record.letters);
+            free(block);
+            fclose(fp);
+            return false;
+        }
+        if(wordCount != NULL) countRecord(&record, used, wordCount, vowelCounts); // words never straddle blocks
+        written += used;
+        if(written + 4 > size) break; // the last character did not fit
+    }
+    free(record.letters);
+    free(block);
+    return (fclose(fp) == 0);
+}
+
+/**
+ * @brief Main thread.
+ *
+ *  \param argc number of words of the command line
+ *  \param argv list of words of the command line
+ *
+ *  \return status of operation
+ */
+int main(int argc, char *argv[]) {
+    int opt, nFiles = 1;
+    unsigned long long total = (unsigned long long)CORPUSSIZE << 20, seed = 1;
+    const char * distribution = "fixed";
+    struct corpusOptions options = {0.15, 5.0, 0.1};
+    bool counts = false;
+
+    opterr = 0;
+    while((opt = getopt(argc, argv, "s:n:d:a:w:p:r:c")) != -1) {
+        switch(opt) {
+            case 's':
+                total = strtoull(optarg, NULL, 10) << 20;
+                break;
+            case 'n':
+                nFiles = atoi(optarg);
+                break;
+            case 'd':
+                distribution = optarg;
+                break;
+            case 'a':
+                options.accents = atof(optarg);
+                break;
+            case 'w':
+                options.wordLength = atof(optarg);
+                break;
+            case 'p':
+                options.punctuation = atof(optarg);
+                break;
+            case 'r':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'c':
+                counts = true;
+                break;
+            default:
+                fprintf(stderr, "%s: invalid option\n", basename(argv[0]));
+                return EXIT_FAILURE;
+        }
+    }
+    bool known = (strcmp(distribution, "fixed") == 0) || (strcmp(distribution, "uniform") == 0) ||
+                 (strcmp(distribution, "pareto") == 0);
+    if((optind != argc - 1) || (nFiles <= 0) || (total == 0) || !known || (options.accents < 0) ||
+       (options.accents > 1) || (options.wordLength < 1) || (options.punctuation < 0) || (options.punctuation > 1)) {
+        fprintf(stderr, "usage: %s [-s total size in MB] [-n files] [-d fixed|uniform|pareto] [-a accent density]\n"
+                        "       [-w mean word length] [-p punctuation density] [-r seed] [-c] directory\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+    const char * dir = argv[optind];
+    if((mkdir(dir, 0755) == -1) && (errno != EEXIST)) {
+        fprintf(stderr, "%s: can not create %s: %s\n", basename(argv[0]), dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // share the total size among the files
+    double * weights;
+    if((weights = (double *)malloc(nFiles * sizeof(double))) == NULL) {
+        fprintf(stderr, "Error on allocating memory.\n");
+        return EXIT_FAILURE;
+    }
+    randomState sizes = seedRandom(seed, 0);
+    double sum = 0;
+    for(int i = 0; i < nFiles; i++) {
+        if(strcmp(distribution, "uniform") == 0) weights[i] = 0.5 + uniform(&sizes);
+        else if(strcmp(distribution, "pareto") == 0) weights[i] = pow(1.0 - uniform(&sizes), -1.0 / PARETOSHAPE);
+        else weights[i] = 1.0;
+        sum += weights[i];
+    }
+
+    unsigned long long given = 0;
+    for(int i = 0; i < nFiles; i++) {
+        char name[4096];
+        unsigned long long size = (i == nFiles - 1) ? total - given : (unsigned long long)((double)total * weights[i] / sum);
+        unsigned long long wordCount = 0, vowelCounts[VOWELNUM] = {0};
+        randomState state = seedRandom(seed, i + 1);
+
+        given += size;
+        snprintf(name, sizeof(name), "%s/corpus%04d.txt", dir, i);
+        if(!writeFile(name, size, &state, &options, counts ? &wordCount : NULL, vowelCounts)) {
+            fprintf(stderr, "%s: can not write %s: %s\n", basename(argv[0]), name, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        if(counts) {
+            printf("File name: %s\n", name);
+            printf("Total number of words = %llu\n", wordCount);
+            printf("N. of words with an\n");
+            printf("\tA\tE\tI\tO\tU\tY\n");
+            for(int j = 0; j < VOWELNUM; j++) printf("\t%llu", vowelCounts[j]);
+            printf("\n\n");
+        }
+    }
+    free(weights);
+
+    return EXIT_SUCCESS;
+}
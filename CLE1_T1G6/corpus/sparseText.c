@@ -0,0 +1,137 @@
+/**
+ * @file sparseText.c
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ *  Generator of sparse test input larger than 4 GB.
+ *
+ *  A short UTF8 text is written at every multiple of a stride, straddling it, and once more at the end of the file;
+ *  the rest of the file is a hole, which takes no space on disk and reads as NUL bytes (neither letters nor
+ *  separators). Every 32 bit boundary (2 GB, 4 GB) is thus crossed by a word. The counts the vowel counter must
+ *  print are written to the standard output, in its own format, so both can be compared with diff. They are those
+ *  of the text counted by hand, times the number of copies, so they do not depend on the code under test.
+ *
+ *  Build: gcc -O2 -o sparseText sparseText.c
+ *  Usage: sparseText [-g size in GB] [-s stride in MB] file
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdbool.h>
+
+/** \brief default size of the generated file, in GB. */
+#define SPARSESIZE 5
+
+/** \brief default distance between the copies of the text, in MB. */
+#define SPARSESTRIDE 64
+
+/** \brief text written in each copy, starting and ending outside of a word. */
+static const char sparseText[] =
+    "Olá! O ninho do pássaro “caiu” da árvore – por isso, a Ýrsa voou… [depois] 2023_ano.\n";
+
+/**
+ * \brief number of words of the text, counted by hand.
+ *
+ * Olá, O, ninho, do, pássaro, caiu, da, árvore, por, isso, a, Ýrsa, voou, [depois (a bracket starts a word when found
+ * outside of one) and _ano (digits do not start a word, an underscore does).
+ */
+#define SPARSEWORDS 15
+
+/** \brief number of words of the text holding each vowel (a, e, i, o, u, y), counted by hand from the same words. */
+static const unsigned long long sparseVowels[] = {8, 2, 4, 11, 2, 1};
+
+/**
+ * @brief Write a copy of the text at a given offset.
+ *
+ * @param fd file descriptor
+ * @param offset file offset of the first byte of the copy
+ * @return true on success, false otherwise
+ */
+static bool writeCopy(int fd, off_t offset) {
+    size_t size = sizeof(sparseText) - 1, written = 0;
+
+    while(written < size) {
+        ssize_t n = pwrite(fd, sparseText + written, size - written, offset + (off_t)written);
+        if(n < 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Main thread.
+ *
+ *  \param argc number of words of the command line
+ *  \param argv list of words of the command line
+ *
+ *  \return status of operation
+ */
+int main(int argc, char *argv[]) {
+    int opt;
+    off_t size = (off_t)SPARSESIZE << 30, stride = (off_t)SPARSESTRIDE << 20;
+
+    opterr = 0;
+    while((opt = getopt(argc, argv, "g:s:")) != -1) {
+        switch(opt) {
+            case 'g':
+                size = (off_t)atoll(optarg) << 30;
+                break;
+            case 's':
+                stride = (off_t)atoll(optarg) << 20;
+                break;
+            default:
+                fprintf(stderr, "%s: invalid option\n", basename(argv[0]));
+                return EXIT_FAILURE;
+        }
+    }
+    off_t copySize = sizeof(sparseText) - 1;
+    if((optind != argc - 1) || (stride < 2 * copySize) || (size < stride)) {
+        fprintf(stderr, "usage: %s [-g size in GB] [-s stride in MB] file\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+
+    int fd;
+    if((fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        fprintf(stderr, "%s: can not create %s: %s\n", basename(argv[0]), argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if(ftruncate(fd, size) == -1) {
+        fprintf(stderr, "%s: can not grow %s: %s\n", basename(argv[0]), argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    unsigned long long copies = 0;
+    for(off_t boundary = stride; boundary + copySize <= size - copySize; boundary += stride, copies++) {
+        if(!writeCopy(fd, boundary - copySize / 2)) {
+            perror("Error writing file.");
+            return EXIT_FAILURE;
+        }
+    }
+    if(!writeCopy(fd, size - copySize)) { // last copy ends the file
+        perror("Error writing file.");
+        return EXIT_FAILURE;
+    }
+    copies++;
+    close(fd);
+
+    // the copies are apart and start and end outside of a word, the counts of the file are those of one copy times
+    printf("File name: %s\n", argv[optind]);
+    printf("Total number of words = %llu\n", copies * SPARSEWORDS);
+    printf("N. of words with an\n");
+    printf("\tA\tE\tI\tO\tU\tY\n");
+    for(int j = 0; j < (int)(sizeof(sparseVowels) / sizeof(sparseVowels[0])); j++) printf("\t%llu", copies * sparseVowels[j]);
+    printf("\n\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file followState.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * State of growing files followed from run to run, so only the bytes appended since the last run are counted.
+ *
+ * The state file starts with a FOLLOWMAGIC line, followed by a line per file:
+ *
+ *     offset dev inode inWord seenVowels pending words a e i o u y \\t name
+ *
+ * pending being the bytes of the cut letter in hexadecimal ("-" if none). Records are sorted by name once loaded, so
+ * each file is looked up by binary search; files met for the first time are appended after them.
+ *
+ * Functions:
+ *     \li followLoad
+ *     \li followLookup
+ *     \li followUpdate
+ *     \li followSave.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "followState.h"
+#include "prog1Utils.h"
+
+/** \brief first line of a state file */
+#define FOLLOWMAGIC "VCFOLLOW1"
+
+/** \brief initial number of records the table has room for */
+#define FOLLOWCAPACITY 64
+
+/** \brief state of a followed file */
+struct followRecord {
+    char * name;                /**< name of the file */
+    unsigned long long dev;     /**< device holding the file */
+    unsigned long long ino;     /**< inode of the file */
+    long long offset;           /**< offset counted up to */
+    struct wordTally tally;     /**< running counts at that offset, unfinished */
+};
+
+/** \brief flag signaling if files are followed */
+bool followOn = false;
+
+/** \brief name of the state file */
+static char * statePath = NULL;
+
+/** \brief records of the followed files, sorted by name up to nSorted */
+static struct followRecord * records = NULL;
+
+/** \brief number of records */
+static size_t nRecords = 0;
+
+/** \brief number of records sorted by name, those loaded */
+static size_t nSorted = 0;
+
+/** \brief number of records the table has room for */
+static size_t capacity = 0;
+
+/**
+ * @brief Compare two records by name, for qsort and bsearch.
+ *
+ * @param a first record
+ * @param b second record
+ * @return int : order of the names
+ */
+static int compareRecords(const void * a, const void * b) {
+    return strcmp(((const struct followRecord *)a)->name, ((const struct followRecord *)b)->name);
+}
+
+/**
+ * @brief Find the record of a file.
+ *
+ * @param name name of the file
+ * @return struct followRecord* : record of the file, NULL if none
+ */
+static struct followRecord * findRecord(const char * name) {
+    struct followRecord key = {(char *)name, 0, 0, 0, {0}};
+    struct followRecord * found = (struct followRecord *)bsearch(&key, records, nSorted, sizeof(struct followRecord),
+                                                                 compareRecords);
+    for(size_t i = nSorted; (found == NULL) && (i < nRecords); i++) { // met this run
+        if(strcmp(records[i].name, name) == 0) found = &records[i];
+    }
+    return found;
+}
+
+/**
+ * @brief Append a record, growing the table geometrically.
+ *
+ * @param record record to append, its name copied
+ * @return true on success, false if memory runs out
+ */
+static bool appendRecord(const struct followRecord * record) {
+    if(nRecords == capacity) {
+        size_t grown = (capacity > 0) ? 2 * capacity : FOLLOWCAPACITY;
+        struct followRecord * table;
+        if((table = (struct followRecord *)realloc(records, grown * sizeof(struct followRecord))) == NULL) return false;
+        records = table;
+        capacity = grown;
+    }
+    records[nRecords] = *record;
+    if((records[nRecords].name = strdup(record->name)) == NULL) return false;
+    nRecords++;
+    return true;
+}
+
+/**
+ * @brief Load the state of the followed files (a state file which does not exist yet is an empty state).
+ *
+ * @param path name of the state file
+ * @return true on success, false if the file can not be read or is not a state file (errno is set)
+ */
+bool followLoad(const char * path) {
+    FILE * fp;
+    char * line = NULL;
+    size_t lineCapacity = 0;
+    bool valid = true;
+
+    if((statePath = strdup(path)) == NULL) return false;
+    followOn = true;
+    if((fp = fopen(path, "r")) == NULL) return (errno == ENOENT); // first run
+
+    if((getline(&line, &lineCapacity, fp) == -1) || (strncmp(line, FOLLOWMAGIC "\n", sizeof(FOLLOWMAGIC)) != 0)) valid = false;
+    while(valid && (getline(&line, &lineCapacity, fp) != -1)) {
+        struct followRecord record;
+        unsigned int inWord, seenVowels;
+        char pending[8];
+        int name = 0;
+        memset(&record, 0, sizeof(record));
+        line[strcspn(line, "\n")] = '\0';
+        if(sscanf(line, "%lld %llu %llu %u %u %7s %llu %llu %llu %llu %llu %llu %llu\t%n", &record.offset, &record.dev,
+                  &record.ino, &inWord, &seenVowels, pending, &record.tally.words, &record.tally.vowels[0],
+                  &record.tally.vowels[1], &record.tally.vowels[2], &record.tally.vowels[3], &record.tally.vowels[4],
+                  &record.tally.vowels[5], &name) != 13 || (name == 0) || (record.offset < 0)) {
+            valid = false;
+            break;
+        }
+        record.tally.scan.inWord = (inWord != 0);
+        record.tally.scan.seenVowels = (unsigned char)(seenVowels & LETTER_VOWELS);
+        if(strcmp(pending, "-") != 0) { // bytes of the letter cut by the offset
+            size_t digits = strlen(pending);
+            if((digits % 2 != 0) || (digits > 2 * sizeof(record.tally.pending))) {
+                valid = false;
+                break;
+            }
+            for(size_t d = 0; d < digits; d += 2) {
+                unsigned int byte;
+                sscanf(&pending[d], "%2x", &byte);
+                record.tally.pending[record.tally.pendingSize++] = (unsigned char)byte;
+            }
+        }
+        record.name = &line[name];
+        if(!appendRecord(&record)) {
+            free(line);
+            fclose(fp);
+            return false;
+        }
+    }
+    free(line);
+    fclose(fp);
+    if(!valid) {
+        errno = EINVAL;
+        return false;
+    }
+    qsort(records, nRecords, sizeof(struct followRecord), compareRecords);
+    nSorted = nRecords;
+    return true;
+}
+
+/**
+ * @brief Look up where counting a file starts from.
+ *
+ * @param name name of the file
+ * @param st stat of the file
+ * @param offset output variable, offset counting starts from (0 if the file is new, rotated or truncated)
+ * @param tally output variable, running counts at that offset (zeroed if counting starts from 0)
+ */
+void followLookup(const char * name, const struct stat * st, off_t * offset, struct wordTally * tally) {
+    struct followRecord * record = followOn ? findRecord(name) : NULL;
+
+    if((record != NULL) && (record->dev == (unsigned long long)st->st_dev) && (record->ino == (unsigned long long)st->st_ino) &&
+       (record->offset <= (long long)st->st_size)) {
+        *offset = (off_t)record->offset;
+        *tally = record->tally;
+        return;
+    }
+    *offset = 0; // new, rotated or truncated
+    memset(tally, 0, sizeof(struct wordTally));
+}
+
+/**
+ * @brief Record the state of a file once its new bytes were counted.
+ *
+ * @param name name of the file
+ * @param dev device holding the file
+ * @param ino inode of the file
+ * @param offset offset counted up to
+ * @param tally running counts at that offset, unfinished
+ * @return true on success, false if memory runs out
+ */
+bool followUpdate(const char * name, dev_t dev, ino_t ino, off_t offset, const struct wordTally * tally) {
+    struct followRecord * record = findRecord(name);
+    struct followRecord updated = {(char *)name, (unsigned long long)dev, (unsigned long long)ino, (long long)offset, *tally};
+
+    if(record == NULL) return appendRecord(&updated);
+    updated.name = record->name;
+    *record = updated;
+    return true;
+}
+
+/**
+ * @brief Write the state of the followed files back to the state file.
+ *
+ * @return true on success (or if no files are followed), false if it can not be written (errno is set)
+ */
+bool followSave(void) {
+    char * temporary;
+    FILE * fp;
+
+    if(!followOn) return true;
+    if((temporary = (char *)malloc(strlen(statePath) + 5)) == NULL) return false;
+    sprintf(temporary, "%s.tmp", statePath);
+    if((fp = fopen(temporary, "w")) == NULL) {
+        free(temporary);
+        return false;
+    }
+    fprintf(fp, "%s\n", FOLLOWMAGIC);
+    for(size_t i = 0; i < nRecords; i++) {
+        const struct followRecord * r = &records[i];
+        char pending[8] = "-";
+        for(int b = 0; b < r->tally.pendingSize; b++) sprintf(&pending[2 * b], "%02x", r->tally.pending[b]);
+        fprintf(fp, "%lld %llu %llu %d %u %s %llu", r->offset, r->dev, r->ino, r->tally.scan.inWord ? 1 : 0,
+                (unsigned int)r->tally.scan.seenVowels, pending, r->tally.words);
+        for(int j = 0; j < LETTER_VOWELNUM; j++) fprintf(fp, " %llu", r->tally.vowels[j]);
+        fprintf(fp, "\t%s\n", r->name);
+    }
+    bool written = (fflush(fp) == 0) && (fsync(fileno(fp)) == 0);
+    written = (fclose(fp) == 0) && written;
+    if(!written || (rename(temporary, statePath) == -1)) {
+        int error = errno;
+        unlink(temporary);
+        free(temporary);
+        errno = error;
+        return false;
+    }
+    free(temporary);
+    return true;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file followState.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * State of growing files followed from run to run, so only the bytes appended since the last run are counted.
+ *
+ * For each file the state holds the offset counted up to, its device and inode, and the running counts at that
+ * offset, unfinished: the word going on, the vowels already found in it and the first bytes of a letter cut by the
+ * offset. A file with another inode (rotated) or shorter than the offset (truncated) is counted again from its start.
+ * A file rewritten in place, keeping its inode and growing, is not told apart from an appended one.
+ *
+ * The state file is a text file, a line per file, rewritten as a whole (through a temporary file renamed over it) at
+ * the end of the run; files not given to the run keep their lines.
+ *
+ * Not thread safe: lookups are made by the main thread before the workers start, updates inside the monitor.
+ *
+ * Functions:
+ *     \li followLoad
+ *     \li followLookup
+ *     \li followUpdate
+ *     \li followSave.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef FOLLOW_STATE_H
+#define FOLLOW_STATE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "prog1Utils.h"
+
+/** \brief flag signaling if files are followed */
+extern bool followOn;
+
+/**
+ * @brief Load the state of the followed files (a state file which does not exist yet is an empty state).
+ *
+ * @param path name of the state file
+ * @return true on success, false if the file can not be read or is not a state file (errno is set)
+ */
+extern bool followLoad(const char * path);
+
+/**
+ * @brief Look up where counting a file starts from.
+ *
+ * @param name name of the file
+ * @param st stat of the file
+ * @param offset output variable, offset counting starts from (0 if the file is new, rotated or truncated)
+ * @param tally output variable, running counts at that offset (zeroed if counting starts from 0)
+ */
+extern void followLookup(const char * name, const struct stat * st, off_t * offset, struct wordTally * tally);
+
+/**
+ * @brief Record the state of a file once its new bytes were counted.
+ *
+ * @param name name of the file
+ * @param dev device holding the file
+ * @param ino inode of the file
+ * @param offset offset counted up to
+ * @param tally running counts at that offset, unfinished
+ * @return true on success, false if memory runs out
+ */
+extern bool followUpdate(const char * name, dev_t dev, ino_t ino, off_t offset, const struct wordTally * tally);
+
+/**
+ * @brief Write the state of the followed files back to the state file.
+ *
+ * @return true on success (or if no files are followed), false if it can not be written (errno is set)
+ */
+extern bool followSave(void);
+
+#endif
@@ -0,0 +1,332 @@
+/**
+ * @file monitorProbe.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Instrumentation of the monitors.
+ *
+ *  Opt-in probe wrapping the locking flag and the synchronization points of a monitor, compiled in with
+ *  -DMONITOR_PROBE and turned on by the MONITOR_PROBE environment variable.
+ *
+ *  Each thread keeps its statistics in a record of its own, so the probe adds no lock of its own to the monitors;
+ *  records are only linked into a list, under a lock, the first time a thread enters a monitor. Times are binned in
+ *  power of two histograms (nanoseconds), dumped at exit per thread and summed over the threads. Waits are also
+ *  recorded in the trace, if one is open.
+ *
+ *  Functions:
+ *     \li probeLock
+ *     \li probeUnlock
+ *     \li probeWait.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifdef MONITOR_PROBE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "monitorProbe.h"
+
+/** \brief number of monitor operations a thread may be probed in */
+#define PROBESITES 16
+
+/** \brief number of histogram bins, bin b holds times below 2^b ns (the last one every longer time) */
+#define PROBEBINS 36
+
+/** \brief histogram of times, in nanoseconds */
+struct probeHistogram {
+    unsigned long long count;               /**< number of times */
+    unsigned long long total;               /**< sum of the times */
+    unsigned long long max;                 /**< longest time */
+    unsigned long long bins[PROBEBINS];     /**< number of times in each bin */
+};
+
+/** \brief statistics of a monitor operation, for one thread */
+struct probeSite {
+    const char * name;                      /**< name of the operation */
+    unsigned long long calls;               /**< number of times the monitor was entered */
+    unsigned long long contended;           /**< number of times the lock was found taken */
+    struct probeHistogram wait;             /**< time waiting to enter the monitor */
+    struct probeHistogram hold;             /**< time inside the monitor, waits on conditions excluded */
+    struct probeHistogram condWait;         /**< time waiting on conditions, the lock taken back included */
+};
+
+/** \brief statistics of a thread */
+struct probeThread {
+    long tid;                               /**< kernel thread id */
+    int nSites;                             /**< number of operations the thread was probed in */
+    struct probeSite sites[PROBESITES];     /**< statistics of each operation */
+    struct probeSite * held;                /**< operation holding the lock, NULL if none */
+    unsigned long long acquired;            /**< time the lock was (re)acquired */
+    unsigned long long heldSoFar;           /**< time the lock was held before the last wait on a condition */
+    struct probeThread * next;              /**< next thread in the list */
+};
+
+/** \brief flag signaling if the probe was turned on by the environment */
+static bool probeOn = false;
+
+/** \brief name of the file the statistics are dumped to, NULL for the standard error */
+static const char * probeFile = NULL;
+
+/** \brief flag which warrants that the environment is read exactly once */
+static pthread_once_t probeInit = PTHREAD_ONCE_INIT;
+
+/** \brief locking flag which warrants mutual exclusion on the list of threads */
+static pthread_mutex_t probeListLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief list of the statistics of the threads, most recent first */
+static struct probeThread * probeThreads = NULL;
+
+/** \brief statistics of the calling thread, NULL until it first enters a monitor */
+static _Thread_local struct probeThread * self = NULL;
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return unsigned long long : time, in nanoseconds, from an arbitrary origin
+ */
+static unsigned long long probeClock(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long)t.tv_sec * 1000000000ULL + (unsigned long long)t.tv_nsec;
+}
+
+/**
+ * @brief Add a time to a histogram.
+ *
+ * @param histogram histogram
+ * @param ns time, in nanoseconds
+ */
+static void record(struct probeHistogram * histogram, unsigned long long ns) {
+    int bin = 0;
+
+    while((bin < PROBEBINS - 1) && (ns >= (1ULL << bin))) bin++;
+    histogram->bins[bin]++;
+    histogram->count++;
+    histogram->total += ns;
+    if(ns > histogram->max) histogram->max = ns;
+}
+
+/**
+ * @brief Add a histogram to another.
+ *
+ * @param sum histogram added to
+ * @param histogram histogram added
+ */
+static void addHistogram(struct probeHistogram * sum, const struct probeHistogram * histogram) {
+    sum->count += histogram->count;
+    sum->total += histogram->total;
+    if(histogram->max > sum->max) sum->max = histogram->max;
+    for(int b = 0; b < PROBEBINS; b++) sum->bins[b] += histogram->bins[b];
+}
+
+/**
+ * @brief Print a time in the most readable unit.
+ *
+ * @param out output stream
+ * @param ns time, in nanoseconds
+ */
+static void printTime(FILE * out, unsigned long long ns) {
+    if(ns < 1000ULL) fprintf(out, "%lluns", ns);
+    else if(ns < 1000000ULL) fprintf(out, "%.1fus", ns / 1.0e3);
+    else if(ns < 1000000000ULL) fprintf(out, "%.1fms", ns / 1.0e6);
+    else fprintf(out, "%.2fs", ns / 1.0e9);
+}
+
+/**
+ * @brief Print a histogram: count, total, mean and longest time, then the non-empty bins by upper bound.
+ *
+ * @param out output stream
+ * @param label name of the histogram
+ * @param histogram histogram
+ */
+static void printHistogram(FILE * out, const char * label, const struct probeHistogram * histogram) {
+    if(histogram->count == 0) return;
+    fprintf(out, "    %-9s n %llu, total ", label, histogram->count);
+    printTime(out, histogram->total);
+    fprintf(out, ", mean ");
+    printTime(out, histogram->total / histogram->count);
+    fprintf(out, ", max ");
+    printTime(out, histogram->max);
+    fprintf(out, "\n     ");
+    for(int b = 0; b < PROBEBINS; b++) {
+        if(histogram->bins[b] == 0) continue;
+        if(b == PROBEBINS - 1) fprintf(out, " >");
+        else fprintf(out, " <");
+        printTime(out, 1ULL << ((b == PROBEBINS - 1) ? b - 1 : b));
+        fprintf(out, ":%llu", histogram->bins[b]);
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * @brief Print the statistics of a monitor operation.
+ *
+ * @param out output stream
+ * @param site statistics of the operation
+ */
+static void printSite(FILE * out, const struct probeSite * site) {
+    fprintf(out, "  %s: calls %llu, contended %llu\n", site->name, site->calls, site->contended);
+    printHistogram(out, "wait", &site->wait);
+    printHistogram(out, "hold", &site->hold);
+    printHistogram(out, "condWait", &site->condWait);
+}
+
+/**
+ * @brief Dump the statistics of every thread, then of every monitor operation over all threads.
+ *
+ * Registered with atexit once the probe is turned on, threads are all done by then.
+ */
+static void probeDump(void) {
+    FILE * out = stderr;
+    struct probeSite sums[PROBESITES];
+    int nSums = 0, nThreads = 0;
+
+    if((probeFile != NULL) && ((out = fopen(probeFile, "w")) == NULL)) {
+        fprintf(stderr, "Error on opening monitor probe file %s: %s\n", probeFile, strerror(errno));
+        return;
+    }
+    pthread_mutex_lock(&probeListLock);
+    for(struct probeThread * t = probeThreads; t != NULL; t = t->next) nThreads++;
+    fprintf(out, "Monitor probe: %d threads\n", nThreads);
+    for(struct probeThread * t = probeThreads; t != NULL; t = t->next) {
+        fprintf(out, "Thread %ld\n", t->tid);
+        for(int s = 0; s < t->nSites; s++) {
+            printSite(out, &t->sites[s]);
+
+            int k = 0;
+            while((k < nSums) && (strcmp(sums[k].name, t->sites[s].name) != 0)) k++;
+            if(k == nSums) {
+                memset(&sums[nSums], 0, sizeof(struct probeSite));
+                sums[nSums++].name = t->sites[s].name;
+            }
+            sums[k].calls += t->sites[s].calls;
+            sums[k].contended += t->sites[s].contended;
+            addHistogram(&sums[k].wait, &t->sites[s].wait);
+            addHistogram(&sums[k].hold, &t->sites[s].hold);
+            addHistogram(&sums[k].condWait, &t->sites[s].condWait);
+        }
+    }
+    pthread_mutex_unlock(&probeListLock);
+    fprintf(out, "All threads\n");
+    for(int k = 0; k < nSums; k++) printSite(out, &sums[k]);
+    if(out != stderr) fclose(out);
+}
+
+/**
+ * @brief Turn the probe on if the environment asks for it.
+ */
+static void probeSetup(void) {
+    const char * value = getenv("MONITOR_PROBE");
+
+    if((value == NULL) || (*value == '\0') || (strcmp(value, "0") == 0)) return;
+    probeFile = (strcmp(value, "1") == 0) ? NULL : value;
+    probeOn = true;
+    atexit(probeDump);
+}
+
+/**
+ * @brief Get the statistics of the calling thread for a monitor operation, registering the thread on its first call.
+ *
+ * @param name name of the operation
+ * @return struct probeSite* : statistics of the operation, NULL if the thread is probed in too many
+ */
+static struct probeSite * siteOf(const char * name) {
+    if(self == NULL) {
+        if((self = (struct probeThread *)calloc(1, sizeof(struct probeThread))) == NULL) return NULL;
+        self->tid = (long)syscall(SYS_gettid);
+        pthread_mutex_lock(&probeListLock);
+        self->next = probeThreads;
+        probeThreads = self;
+        pthread_mutex_unlock(&probeListLock);
+    }
+    for(int s = 0; s < self->nSites; s++) {
+        if((self->sites[s].name == name) || (strcmp(self->sites[s].name, name) == 0)) return &self->sites[s];
+    }
+    if(self->nSites == PROBESITES) return NULL;
+    self->sites[self->nSites].name = name;
+    return &self->sites[self->nSites++];
+}
+
+/**
+ * @brief Lock a monitor's locking flag, timing the wait.
+ *
+ * @param site name of the monitor operation
+ * @param mutex locking flag
+ * @return int : status of pthread_mutex_lock
+ */
+int probeLock(const char * site, pthread_mutex_t * mutex) {
+    pthread_once(&probeInit, probeSetup);
+    if(!probeOn) return traceLock(site, mutex);
+
+    struct probeSite * stats = siteOf(site);
+    double traceStart = traceNow();
+    unsigned long long start = probeClock();
+    int status = pthread_mutex_trylock(mutex);
+    bool contended = (status == EBUSY);
+    if(contended) status = pthread_mutex_lock(mutex);
+    unsigned long long now = probeClock();
+    traceSpan(site, "lock", traceStart);
+
+    if((status == 0) && (stats != NULL)) {
+        stats->calls++;
+        if(contended) stats->contended++;
+        record(&stats->wait, now - start);
+        self->held = stats;
+        self->acquired = now;
+        self->heldSoFar = 0;
+    }
+    return status;
+}
+
+/**
+ * @brief Unlock a monitor's locking flag, timing how long it was held.
+ *
+ * @param site name of the monitor operation
+ * @param mutex locking flag
+ * @return int : status of pthread_mutex_unlock
+ */
+int probeUnlock(const char * site, pthread_mutex_t * mutex) {
+    (void)site; // the hold is charged to the operation which entered the monitor
+    if(probeOn && (self != NULL) && (self->held != NULL)) {
+        record(&self->held->hold, self->heldSoFar + probeClock() - self->acquired);
+        self->held = NULL;
+    }
+    return pthread_mutex_unlock(mutex);
+}
+
+/**
+ * @brief Wait on a synchronization point of a monitor, timing the wait (the lock taken back included).
+ *
+ * @param site name of the monitor operation
+ * @param cond synchronization point
+ * @param mutex locking flag, held
+ * @return int : status of pthread_cond_wait
+ */
+int probeWait(const char * site, pthread_cond_t * cond, pthread_mutex_t * mutex) {
+    if(!probeOn || (self == NULL)) return traceWait(site, cond, mutex);
+
+    struct probeSite * stats = siteOf(site);
+    double traceStart = traceNow();
+    unsigned long long start = probeClock();
+    if(self->held != NULL) self->heldSoFar += start - self->acquired; // the lock is given up while waiting
+    int status = pthread_cond_wait(cond, mutex);
+    unsigned long long now = probeClock();
+    traceSpan(site, "wait", traceStart);
+
+    if(stats != NULL) record(&stats->condWait, now - start);
+    self->acquired = now;
+    return status;
+}
+
+#endif
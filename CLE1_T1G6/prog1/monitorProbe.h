@@ -0,0 +1,82 @@
+/**
+ * @file monitorProbe.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Instrumentation of the monitors.
+ *
+ *  Opt-in probe wrapping the locking flag and the synchronization points of a monitor. For each thread and monitor
+ *  operation (site) it records the number of calls, how many found the lock taken, and histograms of the time spent
+ *  waiting to enter, the time the lock was held (waits on conditions excluded) and the time spent waiting on
+ *  conditions. The statistics are dumped at exit.
+ *
+ *  The probe is compiled in with -DMONITOR_PROBE and turned on at run time by the MONITOR_PROBE environment variable:
+ *  1 to dump the statistics to the standard error, any other value (but 0) to dump them to the file it names.
+ *  Without -DMONITOR_PROBE the wrappers only record the waits in the trace, if one is open (traceEvents.h). Shared by
+ *  the vowel count (prog1) and bitonic sort (prog2) programs, a thread is assumed to hold one monitor lock at a time.
+ *
+ *  Functions:
+ *     \li monitorLock
+ *     \li monitorUnlock
+ *     \li monitorWait.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef MONITOR_PROBE_H
+#define MONITOR_PROBE_H
+
+#include <pthread.h>
+
+#include "traceEvents.h"
+
+#ifdef MONITOR_PROBE
+
+/**
+ * @brief Lock a monitor's locking flag, timing the wait.
+ *
+ * @param site name of the monitor operation
+ * @param mutex locking flag
+ * @return int : status of pthread_mutex_lock
+ */
+extern int probeLock(const char * site, pthread_mutex_t * mutex);
+
+/**
+ * @brief Unlock a monitor's locking flag, timing how long it was held.
+ *
+ * @param site name of the monitor operation
+ * @param mutex locking flag
+ * @return int : status of pthread_mutex_unlock
+ */
+extern int probeUnlock(const char * site, pthread_mutex_t * mutex);
+
+/**
+ * @brief Wait on a synchronization point of a monitor, timing the wait (the lock taken back included).
+ *
+ * @param site name of the monitor operation
+ * @param cond synchronization point
+ * @param mutex locking flag, held
+ * @return int : status of pthread_cond_wait
+ */
+extern int probeWait(const char * site, pthread_cond_t * cond, pthread_mutex_t * mutex);
+
+/** \brief enter a monitor, from the operation named site */
+#define monitorLock(site, mutex) probeLock(site, mutex)
+
+/** \brief exit a monitor, from the operation named site */
+#define monitorUnlock(site, mutex) probeUnlock(site, mutex)
+
+/** \brief wait on a synchronization point of a monitor, from the operation named site */
+#define monitorWait(site, cond, mutex) probeWait(site, cond, mutex)
+
+#else
+
+#define monitorLock(site, mutex) traceLock(site, mutex)
+#define monitorUnlock(site, mutex) pthread_mutex_unlock(mutex)
+#define monitorWait(site, cond, mutex) traceWait(site, cond, mutex)
+
+#endif
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * @file perfCounters.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Hardware performance counters per phase, with perf_event_open.
+ *
+ *  Each thread opens one counter per event on itself (no group, so a counter the kernel refuses does not take the
+ *  others with it) and keeps its counts per phase in a record of its own; records are only linked into a list, under
+ *  a lock, when the thread starts. Counts are scaled by the time each counter was enabled over the time it was
+ *  counting.
+ *
+ *  Functions:
+ *     \li perfInit
+ *     \li perfThreadStart
+ *     \li perfBegin
+ *     \li perfEnd
+ *     \li perfThreadStop
+ *     \li perfReport.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfCounters.h"
+
+/** \brief index of the task clock counter, in ns */
+#define PERF_TASKCLOCK 0
+
+/** \brief index of the cycles counter */
+#define PERF_CYCLES 1
+
+/** \brief index of the instructions counter */
+#define PERF_INSTRUCTIONS 2
+
+/** \brief event counted by a counter */
+struct perfEvent {
+    const char * name;          /**< name of the event, in the report */
+    unsigned int type;          /**< perf_event_attr type */
+    unsigned long long config;  /**< perf_event_attr config */
+};
+
+/** \brief events counted, in the order of the report */
+static const struct perfEvent perfEvents[PERFEVENTS] = {
+    {"task-clock(ms)", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"L1d-misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}
+};
+
+/** \brief counters and counts of a thread */
+struct perfThread {
+    char name[32];                  /**< name of the thread, in the report */
+    int fd[PERFEVENTS];             /**< file descriptor of each counter, -1 if it could not be opened */
+    unsigned long long * calls;     /**< number of times each phase ran */
+    double * counts;                /**< count of each event in each phase, phase after phase */
+    struct perfThread * next;       /**< next thread in the list */
+};
+
+/** \brief flag signaling if the counters are read */
+bool perfOn = false;
+
+/** \brief names of the phases */
+static const char * const * phaseNames;
+
+/** \brief number of phases */
+static int nPhases;
+
+/** \brief locking flag which warrants mutual exclusion on the list of threads and the errors */
+static pthread_mutex_t perfListLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief list of the threads, most recent first */
+static struct perfThread * perfThreads = NULL;
+
+/** \brief number of threads each counter could be opened for */
+static int opened[PERFEVENTS];
+
+/** \brief error of the first refused opening of each counter, 0 if none */
+static int refused[PERFEVENTS];
+
+/** \brief counters and counts of the calling thread, NULL if it did not start them */
+static _Thread_local struct perfThread * self = NULL;
+
+/**
+ * @brief Open a counter on the calling thread, user space only.
+ *
+ * @param event event to count
+ * @return int : file descriptor of the counter, -1 on error (errno is set)
+ */
+static int openCounter(const struct perfEvent * event) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief Read the counters of the calling thread.
+ *
+ * @param sample output variable, reading of the counters (zero for counters which are not open)
+ */
+static void readCounters(struct perfSample * sample) {
+    for(int e = 0; e < PERFEVENTS; e++) {
+        unsigned long long buf[3] = {0, 0, 0};
+        if((self->fd[e] >= 0) && (read(self->fd[e], buf, sizeof(buf)) != sizeof(buf))) memset(buf, 0, sizeof(buf));
+        sample->value[e] = buf[0];
+        sample->enabled[e] = buf[1];
+        sample->running[e] = buf[2];
+    }
+}
+
+/**
+ * @brief Turn profiling on, for the given phases.
+ *
+ * Called by the main thread before any other thread is created.
+ *
+ * @param names names of the phases, kept by pointer
+ * @param n number of phases
+ */
+void perfInit(const char * const * names, int n) {
+    phaseNames = names;
+    nPhases = n;
+    perfOn = true;
+}
+
+/**
+ * @brief Open the counters of the calling thread, which appears in the report as e.g. "worker" 2.
+ *
+ * @param role role of the thread
+ * @param id application defined identification of the thread
+ */
+void perfThreadStart(const char * role, int id) {
+    struct perfThread * thread;
+
+    if(!perfOn) return;
+    if(((thread = (struct perfThread *)calloc(1, sizeof(struct perfThread))) == NULL) ||
+       ((thread->calls = (unsigned long long *)calloc(nPhases, sizeof(unsigned long long))) == NULL) ||
+       ((thread->counts = (double *)calloc((size_t)nPhases * PERFEVENTS, sizeof(double))) == NULL)) {
+        fprintf(stderr, "Error on allocating space to the performance counters, the thread is not profiled.\n");
+        return;
+    }
+    snprintf(thread->name, sizeof(thread->name), "%s %d", role, id);
+
+    pthread_mutex_lock(&perfListLock);
+    for(int e = 0; e < PERFEVENTS; e++) {
+        if((thread->fd[e] = openCounter(&perfEvents[e])) >= 0) opened[e]++;
+        else if(refused[e] == 0) refused[e] = errno;
+    }
+    thread->next = perfThreads;
+    perfThreads = thread;
+    pthread_mutex_unlock(&perfListLock);
+    self = thread;
+}
+
+/**
+ * @brief Read the counters of the calling thread as a phase begins.
+ *
+ * @param sample output variable, reading of the counters
+ */
+void perfBegin(struct perfSample * sample) {
+    if(self != NULL) readCounters(sample);
+}
+
+/**
+ * @brief Read the counters of the calling thread as a phase ends, charging what they counted to it.
+ *
+ * @param phase index of the phase
+ * @param sample reading of the counters as the phase began
+ */
+void perfEnd(int phase, const struct perfSample * sample) {
+    struct perfSample now;
+
+    if((self == NULL) || (phase < 0) || (phase >= nPhases)) return;
+    readCounters(&now);
+    self->calls[phase]++;
+    for(int e = 0; e < PERFEVENTS; e++) {
+        unsigned long long running = now.running[e] - sample->running[e];
+        if(running == 0) continue; // not counting, the kernel gave the PMU to others
+        self->counts[phase * PERFEVENTS + e] += (double)(now.value[e] - sample->value[e]) *
+                                               (double)(now.enabled[e] - sample->enabled[e]) / (double)running;
+    }
+}
+
+/**
+ * @brief Close the counters of the calling thread, before it exits.
+ */
+void perfThreadStop(void) {
+    if(self == NULL) return;
+    for(int e = 0; e < PERFEVENTS; e++) {
+        if(self->fd[e] >= 0) close(self->fd[e]);
+        self->fd[e] = -1;
+    }
+    self = NULL;
+}
+
+/**
+ * @brief Print a row of the report: a phase, summed over the threads, or a thread within it.
+ *
+ * @param label name of the row
+ * @param calls number of times the phase ran
+ * @param counts count of each event
+ */
+static void printRow(const char * label, unsigned long long calls, const double * counts) {
+    fprintf(stderr, "%-18s %10llu", label, calls);
+    for(int e = 0; e < PERFEVENTS; e++) {
+        if(opened[e] == 0) fprintf(stderr, " %14s", "n/a");
+        else if(e == PERF_TASKCLOCK) fprintf(stderr, " %14.3f", counts[e] / 1.0e6);
+        else fprintf(stderr, " %14.0f", counts[e]);
+    }
+    if((opened[PERF_CYCLES] > 0) && (opened[PERF_INSTRUCTIONS] > 0) && (counts[PERF_CYCLES] > 0)) {
+        fprintf(stderr, " %6.2f", counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]);
+    }
+    else fprintf(stderr, " %6s", "n/a");
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Print the counts per phase, summed over the threads and for each thread, to the standard error.
+ *
+ * Called once every other thread stopped its counters.
+ */
+void perfReport(void) {
+    double sum[PERFEVENTS];
+
+    if(!perfOn) return;
+    pthread_mutex_lock(&perfListLock);
+    fprintf(stderr, "\nPerformance counters (user space)\n");
+    for(int e = 0; e < PERFEVENTS; e++) {
+        if(refused[e] != 0) {
+            fprintf(stderr, "  %s: %s%s\n", perfEvents[e].name, strerror(refused[e]),
+                    (opened[e] > 0) ? ", for some threads" : ", not counted");
+        }
+    }
+    fprintf(stderr, "%-18s %10s", "phase", "calls");
+    for(int e = 0; e < PERFEVENTS; e++) fprintf(stderr, " %14s", perfEvents[e].name);
+    fprintf(stderr, " %6s\n", "IPC");
+    for(int p = 0; p < nPhases; p++) {
+        unsigned long long calls = 0;
+        memset(sum, 0, sizeof(sum));
+        for(struct perfThread * t = perfThreads; t != NULL; t = t->next) {
+            calls += t->calls[p];
+            for(int e = 0; e < PERFEVENTS; e++) sum[e] += t->counts[p * PERFEVENTS + e];
+        }
+        if(calls == 0) continue;
+        printRow(phaseNames[p], calls, sum);
+        for(struct perfThread * t = perfThreads; t != NULL; t = t->next) {
+            if(t->calls[p] == 0) continue;
+            char label[40];
+            snprintf(label, sizeof(label), "  %s", t->name);
+            printRow(label, t->calls[p], &t->counts[p * PERFEVENTS]);
+        }
+    }
+    pthread_mutex_unlock(&perfListLock);
+}
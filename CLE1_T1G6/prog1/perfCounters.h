@@ -0,0 +1,93 @@
+/**
+ * @file perfCounters.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Hardware performance counters per phase, with perf_event_open.
+ *
+ *  Each thread opens its own counters (task clock, cycles, instructions, branch misses, L1 data and last level cache
+ *  misses), user space only, and charges what they count between perfBegin and perfEnd to a phase of the program.
+ *  The counts are summed per phase and per thread and printed to the standard error at the end, scaled if the kernel
+ *  had to multiplex the counters.
+ *
+ *  Counters the kernel refuses (no PMU in a virtual machine, perf_event_paranoid, seccomp) are reported as n/a and
+ *  the program runs on; nothing is opened or read unless profiling was asked for. Shared by the vowel count (prog1)
+ *  and bitonic sort (prog2) programs.
+ *
+ *  Functions:
+ *     \li perfInit
+ *     \li perfThreadStart
+ *     \li perfBegin
+ *     \li perfEnd
+ *     \li perfThreadStop
+ *     \li perfReport.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+
+/** \brief number of counters opened by each thread */
+#define PERFEVENTS 6
+
+/** \brief reading of the counters of a thread, taken when a phase begins */
+struct perfSample {
+    unsigned long long value[PERFEVENTS];   /**< raw count of each counter */
+    unsigned long long enabled[PERFEVENTS]; /**< time each counter was enabled, in ns */
+    unsigned long long running[PERFEVENTS]; /**< time each counter was actually counting, in ns */
+};
+
+/** \brief flag signaling if the counters are read */
+extern bool perfOn;
+
+/**
+ * @brief Turn profiling on, for the given phases.
+ *
+ * Called by the main thread before any other thread is created.
+ *
+ * @param names names of the phases, kept by pointer
+ * @param n number of phases
+ */
+extern void perfInit(const char * const * names, int n);
+
+/**
+ * @brief Open the counters of the calling thread, which appears in the report as e.g. "worker" 2.
+ *
+ * @param role role of the thread
+ * @param id application defined identification of the thread
+ */
+extern void perfThreadStart(const char * role, int id);
+
+/**
+ * @brief Read the counters of the calling thread as a phase begins.
+ *
+ * @param sample output variable, reading of the counters
+ */
+extern void perfBegin(struct perfSample * sample);
+
+/**
+ * @brief Read the counters of the calling thread as a phase ends, charging what they counted to it.
+ *
+ * @param phase index of the phase
+ * @param sample reading of the counters as the phase began
+ */
+extern void perfEnd(int phase, const struct perfSample * sample);
+
+/**
+ * @brief Close the counters of the calling thread, before it exits.
+ */
+extern void perfThreadStop(void);
+
+/**
+ * @brief Print the counts per phase, summed over the threads and for each thread, to the standard error.
+ *
+ * Called once every other thread stopped its counters.
+ */
+extern void perfReport(void);
+
+#endif
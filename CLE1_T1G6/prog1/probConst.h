@@ -15,15 +15,12 @@
 #ifndef PROBCONST_H_
 #define PROBCONST_H_
 
-/** \brief maximum string length for a file name. */
-#define MAXFILENAMELEN 30
-
-/** \brief maximum number of files as input. */
-#define MAXFILECOUNT 10
-
-/** \brief maximum chunk size for each worker to read. */
+/** \brief default chunk size for each worker to read. */
 #define MAXTEXTSIZE 4000
 
+/** \brief fixed cost, in seconds, of handing a chunk to a worker (claiming and reading it), to tune the chunk size. */
+#define CHUNKCOST 5.0e-6
+
 /** \brief number of defined vowels. */
 #define VOWELNUM 6
 
@@ -9,6 +9,10 @@
  *  monitor of Lampson / Redell type.
  *
  *  Generator thread of the intervening entities.
+ *
+ *  A plain run (chunks claimed in order, no pipeline, inflaters, trace, perf counters, cache, follow state or extra
+ *  statistics) is counted by a pool of libvowelcount, as the jobs of the daemon mode are; the other modes are
+ *  scheduled by the monitor of prog1SM.c.
  * 
  * @version 0.1
  * @date 2023-03-22
@@ -20,16 +24,25 @@
 #include <stdlib.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <string.h>
+#include <errno.h>
 
 #include "prog1SM.h"
 #include "probConst.h"
 #include "prog1Utils.h"
-
-/** \brief list of characters considered vowels */
-static unsigned char vowels[6] = {'a', 'e', 'i', 'o', 'u', 'y'};
+#include "prog1Files.h"
+#include "prog1Report.h"
+#include "traceEvents.h"
+#include "perfCounters.h"
+#include "prog1Server.h"
+#include "resultCache.h"
+#include "followState.h"
+#include "wordFreq.h"
+#include "prog1Gzip.h"
+#include "vowelCount.h"
 
 /** \brief return status on monitor initialization */
 int statusInitMon;
@@ -40,18 +53,93 @@ int *statusWorker;
 /** \brief main/generator thread return status */
 int statusMain;
 
+/** \brief reader threads return status array */
+int *statusReader;
+
+/** \brief inflater threads return status array */
+int *statusInflater;
+
 /** \brief worker life cycle routine */
 static void *worker(void *args);
 
+/** \brief reader life cycle routine */
+static void *reader(void *args);
+
+/** \brief inflater life cycle routine */
+static void *inflater(void *args);
+
 /** \brief execution time measurement */
 static double get_delta_time(void);
 
+/** \brief plain run, counted by a pool of libvowelcount */
+static int countFiles(char ** names);
+
 /** \brief number of files input by the user */
 int nFiles;
 
 /** \brief number of threads input by the user */
 int nThreads = 4;
 
+/** \brief flag signaling if input files are memory-mapped instead of read chunk by chunk */
+bool useMmap = false;
+
+/** \brief size, in bytes, of the text chunks the files are cut into (0 to tune it) */
+unsigned int textSize = MAXTEXTSIZE;
+
+/** \brief number of reader threads filling the buffers ahead of the workers (0 if workers read their own chunks) */
+int nReaders = 0;
+
+/** \brief number of reads each reader keeps in flight with io_uring (0 for synchronous reads) */
+int queueDepth = 0;
+
+/** \brief number of inflater threads filling the buffers with the text of the compressed files (0 if none is) */
+int nInflaters = 0;
+
+/** \brief workers per inflater started by default, inflating being several times faster than counting */
+#define WORKERSPERINFLATER 4
+
+/** \brief flag signaling if byte ranges are claimed from per-thread task deques with stealing, instead of in order */
+bool useStealing = false;
+
+/** \brief output format of the results (FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV) */
+int outputFormat = FORMAT_TEXT;
+
+/** \brief statistics gathered (STAT_VOWELS, with STAT_LETTERS and/or STAT_LENGTHS) */
+int statistics = STAT_VOWELS;
+
+/** \brief number of most frequent words reported (0 if words are not interned) */
+int topWords = 0;
+
+/** \brief work done by each worker */
+static struct workerStats * workerStats;
+
+/** \brief profiled phase: reading a chunk (waiting for a reader in pipeline mode) */
+#define PHASE_READ 0
+
+/** \brief profiled phase: classifying the bytes of a chunk into words and vowels (and letters and word lengths) */
+#define PHASE_CLASSIFY 1
+
+/** \brief profiled phase: storing the summary of a chunk and folding those of a finished file */
+#define PHASE_REDUCE 2
+
+/** \brief names of the profiled phases */
+static const char * const phaseNames[] = {"read", "classify", "reduce"};
+
+/** \brief long command line options */
+static const struct option longOptions[] = {
+    {"format", required_argument, NULL, 'F'},
+    {"trace", required_argument, NULL, 'T'},
+    {"perf", no_argument, NULL, 'P'},
+    {"serve", required_argument, NULL, 'S'},
+    {"submit", required_argument, NULL, 'J'},
+    {"cache", required_argument, NULL, 'C'},
+    {"cache-verify", no_argument, NULL, 'V'},
+    {"follow", required_argument, NULL, 'W'},
+    {"stats", required_argument, NULL, 'X'},
+    {"top", required_argument, NULL, 'K'},
+    {NULL, 0, NULL, 0}
+};
+
 /**
  * @brief Main thread.
  *
@@ -66,24 +154,16 @@ int nThreads = 4;
 int main(int argc, char *argv[]) {
     // Process the command line options
     int opt;
-    char ** files;
-
-    nFiles = 0;
-    if((files = (char **)malloc(MAXFILECOUNT * sizeof(char *))) == NULL) {
-        fprintf(stderr, "Error allocating memory.\n");
-        return EXIT_FAILURE;
-    }
-    for(int i = 0; i < MAXFILECOUNT; i++) {
-        if((files[i] = (char *)malloc((MAXFILENAMELEN+1) * sizeof(char))) == NULL) {
-            fprintf(stderr, "Error allocating memory.\n");
-            return EXIT_FAILURE;
-        }
-    }
+    struct fileList files = {NULL, 0, 0};
+    char * traceFile = NULL;
+    char * serveSocket = NULL, * submitSocket = NULL;
+    char * cacheFile = NULL, * followFile = NULL;
+    bool verifyCache = false;
     
     opterr = 0;
     do {
         bool errFlg = false;
-        switch (opt = getopt(argc, argv, "t:f:")) {
+        switch (opt = getopt_long(argc, argv, "t:f:l:c:p:u:z:ms", longOptions, NULL)) {
             case 't':
                 if(atoi(optarg) <= 0) {
                     fprintf(stderr, "%s: number of threads must be a positive integer!\n", basename(argv[0]));
@@ -91,21 +171,94 @@ int main(int argc, char *argv[]) {
                 }
                 nThreads = (int) atoi(optarg);
                 break;
+            case 'm':
+                useMmap = true;
+                break;
+            case 's':
+                useStealing = true;
+                break;
+            case 'p':
+                if(atoi(optarg) <= 0) {
+                    fprintf(stderr, "%s: number of readers must be a positive integer!\n", basename(argv[0]));
+                    errFlg = true;
+                }
+                nReaders = (int) atoi(optarg);
+                break;
+            case 'u':
+                if(atoi(optarg) <= 0) {
+                    fprintf(stderr, "%s: io_uring queue depth must be a positive integer!\n", basename(argv[0]));
+                    errFlg = true;
+                }
+                queueDepth = (int) atoi(optarg);
+                break;
+            case 'z':
+                if(atoi(optarg) <= 0) {
+                    fprintf(stderr, "%s: number of inflaters must be a positive integer!\n", basename(argv[0]));
+                    errFlg = true;
+                }
+                nInflaters = (int) atoi(optarg);
+                break;
+            case 'c':
+                if(!parseChunkSize(optarg, &textSize)) {
+                    fprintf(stderr, "%s: chunk size must be auto or between %i KB and %i MB!\n", basename(argv[0]),
+                            CHUNKSIZE_MIN / 1024, CHUNKSIZE_MAX / (1024 * 1024));
+                    errFlg = true;
+                }
+                break;
             case 'f':
                 optind--;
-                for(;optind < argc && *argv[optind] != '-'; optind++) {
-                    if(nFiles >= MAXFILECOUNT) {
-                        fprintf(stderr, "%s: you may only select up to %i files!\n", basename(argv[0]), MAXFILECOUNT);
-                        errFlg = true;
-                        break;
-                    }
-                    char* fileName = argv[optind];
-                    if(strlen(fileName) > MAXFILENAMELEN) {
-                        fprintf(stderr, "%s: file names may not be larger than %i characters!\n", basename(argv[0]), MAXFILENAMELEN);
+                for(;optind < argc && *argv[optind] != '-'; optind++) { // files or directory trees
+                    if(!addPath(&files, argv[optind])) {
+                        fprintf(stderr, "%s: can not read %s: %s\n", basename(argv[0]), argv[optind], strerror(errno));
                         errFlg = true;
                         break;
                     }
-                    strcpy(files[nFiles++], fileName);
+                }
+                break;
+            case 'F':
+                if(!parseFormat(optarg, &outputFormat)) {
+                    fprintf(stderr, "%s: output format must be text, json or csv!\n", basename(argv[0]));
+                    errFlg = true;
+                }
+                break;
+            case 'T':
+                traceFile = optarg;
+                break;
+            case 'P':
+                perfInit(phaseNames, sizeof(phaseNames) / sizeof(phaseNames[0]));
+                break;
+            case 'S':
+                serveSocket = optarg;
+                break;
+            case 'J':
+                submitSocket = optarg;
+                break;
+            case 'C':
+                cacheFile = optarg;
+                break;
+            case 'V':
+                verifyCache = true;
+                break;
+            case 'W':
+                followFile = optarg;
+                break;
+            case 'X':
+                if(!parseStats(optarg, &statistics)) {
+                    fprintf(stderr, "%s: statistics must be a list of vowels, letters and lengths, or all!\n", basename(argv[0]));
+                    errFlg = true;
+                }
+                break;
+            case 'K':
+                if(atoi(optarg) <= 0) {
+                    fprintf(stderr, "%s: number of most frequent words must be a positive integer!\n", basename(argv[0]));
+                    errFlg = true;
+                }
+                topWords = (int) atoi(optarg);
+                break;
+            case 'l':
+                if(!addPathList(&files, optarg)) { // list of files or directory trees, one per line
+                    fprintf(stderr, "%s: can not read the paths listed in %s: %s\n", basename(argv[0]), optarg, strerror(errno));
+                    errFlg = true;
                 }
                 break;
             case '?': 
@@ -120,31 +273,111 @@ int main(int argc, char *argv[]) {
         fprintf (stderr, "%s: invalid format\n", basename (argv[0]));
         return EXIT_FAILURE;
     }
+    nFiles = files.count;
+    bool compressed = false;
+    for(int i = 0; i < nFiles; i++) compressed = compressed || gzipIsCompressed(files.names[i]);
+    if(((statistics != STAT_VOWELS) || (topWords > 0)) &&
+       ((serveSocket != NULL) || (submitSocket != NULL) || (cacheFile != NULL) || (followFile != NULL))) {
+        fprintf(stderr, "%s: letters, word lengths and top words are only gathered by a plain run (no --serve, --submit, "
+                "--cache, --follow)\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+    if(serveSocket != NULL) { // daemon mode: a warm pool counts the jobs sent over the socket, until SIGINT or SIGTERM
+        if(!serveJobs(serveSocket, nThreads, textSize)) {
+            fprintf(stderr, "%s: can not serve on %s: %s\n", basename(argv[0]), serveSocket, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    if((submitSocket != NULL) && compressed) {
+        fprintf(stderr, "%s: compressed files are only inflated by a plain run (no --submit)\n", basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+    if(submitSocket != NULL) { // the files are counted by a server, its answer is reported as usual
+        int nFailed;
+        if(!submitJob(submitSocket, files.names, nFiles, outputFormat, &nFailed)) {
+            fprintf(stderr, "%s: no answer from %s: %s\n", basename(argv[0]), submitSocket, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        return (nFailed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if((traceFile != NULL) && !traceOpen(traceFile, basename(argv[0]), 0)) {
+        fprintf(stderr, "Error on allocating space to the trace.\n");
+        return EXIT_FAILURE;
+    }
+    traceThread("main", 0);
+    if((followFile != NULL) && !followLoad(followFile)) { // files are counted from where the last run stopped
+        fprintf(stderr, "%s: can not read the follow state %s: %s\n", basename(argv[0]), followFile, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if((cacheFile != NULL) && !cacheOpen(cacheFile, verifyCache)) { // counting goes on, every file is a miss
+        fprintf(stderr, "%s: result cache %s not used: %s\n", basename(argv[0]), cacheFile,
+                (errno == EWOULDBLOCK) ? "in use by another run" : strerror(errno));
+    }
+    if((queueDepth > 0) && (nReaders == 0)) nReaders = 1; // io_uring reads are issued by a reader
+    if(!compressed) nInflaters = 0; // nothing to inflate
+    else if(nInflaters == 0) nInflaters = (nThreads + WORKERSPERINFLATER - 1) / WORKERSPERINFLATER;
+    if(useMmap && (nReaders > 0)) {
+        fprintf (stderr, "%s: memory-mapped (-m) and pipeline (-p, -u) modes may not be combined\n", basename (argv[0]));
+        return EXIT_FAILURE;
+    }
+    if(!useMmap && !useStealing && (nReaders == 0) && (nInflaters == 0) && !traceOn && !perfOn && (cacheFile == NULL) &&
+       (followFile == NULL) && (statistics == STAT_VOWELS) && (topWords == 0)) {
+        return countFiles(files.names);
+    }
 
-    if((statusWorker = malloc (nThreads * sizeof (int))) == NULL) {
+    if(((statusWorker = malloc (nThreads * sizeof (int))) == NULL) ||
+       ((statusReader = malloc ((nReaders + 1) * sizeof (int))) == NULL) ||
+       ((statusInflater = malloc ((nInflaters + 1) * sizeof (int))) == NULL) ||
+       ((workerStats = calloc (nThreads, sizeof (struct workerStats))) == NULL) ||
+       ((topWords > 0) && !wordFreqInit(nThreads + nInflaters))) { // inflaters intern the words cut in the files they fold
         fprintf(stderr, "Error on allocating space to the return status arrays of worker threads.\n");
         exit(EXIT_FAILURE);
     }
 
-    pthread_t *tIdWorkers;
-    unsigned int *workers;                                                                                      /* counting variable */
+    pthread_t *tIdWorkers, *tIdReaders, *tIdInflaters;
+    unsigned int *workers, *readers, *inflaters;                                                                /* counting variable */
     int *pStatus;                                                                       /* pointer to execution status */
 
     /* initializing the application defined thread id arrays for the workers and the random number
         generator */
 
     if (((tIdWorkers = malloc(nThreads * sizeof (pthread_t))) == NULL) ||
-        ((workers = malloc(nThreads * sizeof (unsigned int))) == NULL)) {
+        ((workers = malloc(nThreads * sizeof (unsigned int))) == NULL) ||
+        ((tIdReaders = malloc((nReaders + 1) * sizeof (pthread_t))) == NULL) ||
+        ((readers = malloc((nReaders + 1) * sizeof (unsigned int))) == NULL) ||
+        ((tIdInflaters = malloc((nInflaters + 1) * sizeof (pthread_t))) == NULL) ||
+        ((inflaters = malloc((nInflaters + 1) * sizeof (unsigned int))) == NULL)) {
         fprintf(stderr, "error on allocating space to both internal / external worker id arrays\n");
         exit(EXIT_FAILURE);
     }
     for (int i = 0; i < nThreads; i++) workers[i] = i;
+    for (int i = 0; i < nReaders; i++) readers[i] = i;
+    for (int i = 0; i < nInflaters; i++) inflaters[i] = i;
 
     srandom ((unsigned int) getpid());
     (void) get_delta_time();
 
-    // store file names in shared memory
-    storeFileNames(files);
+    // pick the chunk size from the throughput of the first chunks, if asked to
+    if(textSize == 0) textSize = tuneChunkSize(files.names, nFiles, nThreads, CHUNKCOST);
+
+    // store file names in shared memory, files with no bytes are reported right away
+    reportBeginStats(outputFormat, statistics & STAT_LETTERS, statistics & STAT_LENGTHS);
+    storeFileNames(files.names);
+
+    // create reader threads (pipeline mode only)
+    for (int i = 0; i < nReaders; i++)
+    if(pthread_create (&tIdReaders[i], NULL, reader, &readers[i]) != 0) {
+        perror("Error on creating thread reader.");
+        exit(EXIT_FAILURE);
+    }
+
+    // create inflater threads (compressed files only)
+    for (int i = 0; i < nInflaters; i++)
+    if(pthread_create (&tIdInflaters[i], NULL, inflater, &inflaters[i]) != 0) {
+        perror("Error on creating thread inflater.");
+        exit(EXIT_FAILURE);
+    }
 
     // create worker threads
     for (int i = 0; i < nThreads; i++)
@@ -159,16 +392,59 @@ int main(int argc, char *argv[]) {
             perror("error on waiting for thread producer");
             exit(EXIT_FAILURE);
         }
-        printf("Thread worker, with id %u, has terminated: ", i);
-        printf("its status was %d\n", *pStatus);
+        if(outputFormat == FORMAT_TEXT) {
+            printf("Thread worker, with id %u, has terminated: ", i);
+            printf("its status was %d\n", *pStatus);
+        }
+    }
+
+    // wait for readers to finish
+    for (int i = 0; i < nReaders; i++) {
+        if (pthread_join(tIdReaders[i], (void *) &pStatus) != 0) {
+            perror("error on waiting for thread reader");
+            exit(EXIT_FAILURE);
+        }
+        if(outputFormat == FORMAT_TEXT) {
+            printf("Thread reader, with id %u, has terminated: ", i);
+            printf("its status was %d\n", *pStatus);
+        }
     }
 
-    // print results
-    printResults();
+    // wait for inflaters to finish
+    for (int i = 0; i < nInflaters; i++) {
+        if (pthread_join(tIdInflaters[i], (void *) &pStatus) != 0) {
+            perror("error on waiting for thread inflater");
+            exit(EXIT_FAILURE);
+        }
+        if(outputFormat == FORMAT_TEXT) {
+            printf("Thread inflater, with id %u, has terminated: ", i);
+            printf("its status was %d\n", *pStatus);
+        }
+    }
 
-    printf ("\nElapsed time = %.6f s\n", get_delta_time ());
+    // the word tables of the workers are merged by shard, with a thread per worker
+    if(topWords > 0) {
+        struct topWord * top;
+        int n = wordFreqTop(topWords, nThreads, &top);
+        if(n < 0) {
+            fprintf(stderr, "Error on allocating space to merge the words.\n");
+            exit(EXIT_FAILURE);
+        }
+        reportTop(outputFormat, top, n);
+        free(top);
+    }
 
-    return 0;
+    // results were reported by the workers as each file was done, only the run is left
+    reportRun(outputFormat, workerStats, nThreads, get_delta_time ());
+    if(!traceClose()) fprintf(stderr, "Error on writing trace file %s: %s\n", traceFile, strerror(errno));
+    perfReport();
+    cacheClose();
+    if(!followSave()) {
+        fprintf(stderr, "Error on writing follow state %s: %s\n", followFile, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return filesFailed() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 /**
@@ -183,76 +459,188 @@ static void *worker(void *args) {
     // Worker ID
     unsigned int id = *((unsigned int *) args);
 
-    // Allocate memory for text chunk
-    unsigned char * chunk;
-    if((chunk = (unsigned char *)malloc(MAXTEXTSIZE * sizeof(unsigned char))) == NULL) {
-        perror("Error on allocating memory.");
-        statusWorker[id] = EXIT_FAILURE;
-        pthread_exit(&statusWorker[id]);
-    }
-
     bool quit = false;
+    double born = wallClock();
+    traceThread("worker", id);
+    perfThreadStart("worker", id);
 
     while(true) {
         // Worker fetches new text chunk
+        unsigned char * chunk;
         int chunkSize;
-        quit = readFromFile(id, chunk, &chunkSize);
+        double since = wallClock(), spanStart = traceNow();
+        struct perfSample sample;
+        perfBegin(&sample);
+        quit = readFromFile(id, &chunk, &chunkSize);
+        perfEnd(PHASE_READ, &sample);
+        traceSpan((nReaders > 0) ? "fetch" : "read", "io", spanStart);
 
         if(quit) break;
-
-        // Process text chunk, count vowel occurence in words and word count
-        unsigned int wordCountPartial = 0;
-        unsigned int vowelCountPartial[VOWELNUM];
-        bool firstOccur[VOWELNUM];
-        for(int i = 0; i < VOWELNUM; i++) {
-            vowelCountPartial[i] = 0;
-            firstOccur[i] = false;
-        }
-        bool inWord = false;
-        unsigned int letterCount = 0;
-        for(int i = 0; i < chunkSize; i++) {
-            letterCount++;
-            unsigned char byte = chunk[i];
-            unsigned char letter[4] = {byte, 0, 0, 0};
-            int size = getLetterSize(byte);
-            for(int j = 1; j < size; j++) letter[j] = chunk[++i];
-
-            if(inWord) {
-                if(isSeparator(letter, size)) inWord = false;
-                else {
-                    unsigned char character = isVowel(letter, size);
-                    for(int j = 0; j < VOWELNUM; j++) {
-                        if(character == vowels[j] && !firstOccur[j]) {
-                            vowelCountPartial[j]++;
-                            firstOccur[j] = true;
-                        }
-                    }
-                }
-            }
-            else {
-                if(isAlpha(letter, size) || ((letter[0] == 0x5F) && (size = 1))) {
-                    wordCountPartial++;
-                    inWord = true;
-                    unsigned char character = isVowel(letter, size);
-                    for(int j = 0; j < VOWELNUM; j++) {
-                        firstOccur[j] = false;
-                        if(character == vowels[j]) {
-                            vowelCountPartial[j]++;
-                            firstOccur[j] = true;
-                        }
-                    }
-                }
-            }
+        if(nReaders > 0) since = wallClock(); // chunk was read by a reader, the worker was only waiting for it
+
+        // Process text chunk, summarize vowel occurence in words and word count (and the other statistics asked for)
+        struct chunkSummary summary;
+        struct chunkStats extra;
+        struct wordEdges edges;
+        spanStart = traceNow();
+        perfBegin(&sample);
+        summarizeChunkStats(chunk, chunkSize, statistics, &summary, &extra);
+        if((topWords > 0) && !wordFreqChunk(id, chunk, chunkSize, &edges)) { // the words are interned in the same phase
+            fprintf(stderr, "Error on allocating space to the words of worker %u.\n", id);
+            statusWorker[id] = EXIT_FAILURE;
+            pthread_exit(&statusWorker[id]);
         }
+        perfEnd(PHASE_CLASSIFY, &sample);
+        traceSpan("classify", "cpu", spanStart);
 
         // Update counting varibales with partial results
-        updateCounts(id, wordCountPartial, vowelCountPartial);
+        spanStart = traceNow();
+        perfBegin(&sample);
+        updateCounts(id, &summary, &extra, &edges);
+        perfEnd(PHASE_REDUCE, &sample);
+        traceSpan("update", "sync", spanStart);
+
+        workerStats[id].busy += wallClock() - since;
+        workerStats[id].chunks++;
+        workerStats[id].bytes += chunkSize;
     }
+    workerStats[id].idle = wallClock() - born - workerStats[id].busy;
+    perfThreadStop();
 
     statusWorker[id] = EXIT_SUCCESS;
     pthread_exit(&statusWorker[id]);
 }
 
+/**
+ * @brief Reader funtion.
+ * 
+ * Its role is to simulate the life cycle of a reader: filling buffers with text chunks ahead of the workers.
+ * 
+ * @param args pointer to application defined reader identification
+ * @return void* 
+ */
+static void *reader(void *args) {
+    // Reader ID
+    unsigned int id = *((unsigned int *) args);
+
+    traceThread("reader", id);
+    perfThreadStart("reader", id);
+
+    struct perfSample sample;
+    bool done = false;
+    if(queueDepth > 0) {
+        perfBegin(&sample);
+        fillBuffersAsync(id);
+        perfEnd(PHASE_READ, &sample);
+    }
+    else while(!done) {
+        perfBegin(&sample);
+        done = fillBuffer(id);
+        perfEnd(PHASE_READ, &sample);
+    }
+    perfThreadStop();
+
+    statusReader[id] = EXIT_SUCCESS;
+    pthread_exit(&statusReader[id]);
+}
+
+/**
+ * @brief Inflater funtion.
+ * 
+ * Its role is to simulate the life cycle of an inflater: filling buffers with the text of the compressed files
+ * ahead of the workers.
+ * 
+ * @param args pointer to application defined inflater identification
+ * @return void* 
+ */
+static void *inflater(void *args) {
+    // Inflater ID
+    unsigned int id = *((unsigned int *) args);
+
+    traceThread("inflater", id);
+    perfThreadStart("inflater", id);
+
+    struct perfSample sample;
+    bool done = false;
+    while(!done) {
+        perfBegin(&sample);
+        done = inflateRun(id);
+        perfEnd(PHASE_READ, &sample);
+    }
+    perfThreadStop();
+
+    statusInflater[id] = EXIT_SUCCESS;
+    pthread_exit(&statusInflater[id]);
+}
+
+/** \brief number of files of a plain run which could not be counted in full (files are reported one at a time) */
+static int nFailed = 0;
+
+/**
+ * @brief Report a file counted by the pool, as soon as it is done.
+ *
+ * @param index index of the file
+ * @param result counts of the file
+ * @param arg names of the files
+ */
+static void reportCounted(size_t index, const vc_result * result, void * arg) {
+    char ** names = (char **) arg;
+    unsigned long long vowels[VC_VOWELS];
+
+    if(result->error != 0) { // could not be opened, or read to its end
+        fprintf(stderr, "Error on counting file %s: %s\n", names[index], strerror(result->error));
+        nFailed++;
+    }
+    for(int j = 0; j < VC_VOWELS; j++) vowels[j] = result->vowels[j];
+    reportFile(outputFormat, names[index], (long long)result->bytes, result->seconds, result->words, vowels, result->error);
+}
+
+/**
+ * @brief Count the files of a plain run with a pool of libvowelcount, and report them as the monitor would.
+ *
+ * @param names names of the files
+ * @return int : status of operation
+ */
+static int countFiles(char ** names) {
+    vc_pool * pool;
+    vc_thread_stats * stats;
+
+    (void) get_delta_time();
+    if(textSize == 0) textSize = tuneChunkSize(names, nFiles, nThreads, CHUNKCOST);
+    if(((stats = malloc (nThreads * sizeof (vc_thread_stats))) == NULL) ||
+       ((workerStats = calloc (nThreads, sizeof (struct workerStats))) == NULL)) {
+        fprintf(stderr, "Error on allocating space to the statistics of worker threads.\n");
+        exit(EXIT_FAILURE);
+    }
+    if((pool = vc_pool_create(nThreads)) == NULL) {
+        perror("Error on creating thread worker.");
+        exit(EXIT_FAILURE);
+    }
+
+    reportBegin(outputFormat);
+    if(vc_count_files(pool, (const char * const *) names, nFiles, textSize, NULL, reportCounted, names) == -1) {
+        perror("Error on allocating space to the data transfer region.");
+        exit(EXIT_FAILURE);
+    }
+    vc_pool_stats(pool, stats, nThreads);
+    vc_pool_destroy(pool);
+
+    for (int i = 0; i < nThreads; i++) {
+        if(outputFormat == FORMAT_TEXT) {
+            printf("Thread worker, with id %u, has terminated: ", i);
+            printf("its status was %d\n", EXIT_SUCCESS);
+        }
+        workerStats[i].chunks = stats[i].chunks;
+        workerStats[i].bytes = stats[i].bytes;
+        workerStats[i].busy = stats[i].busy;
+        workerStats[i].idle = stats[i].idle;
+    }
+    reportRun(outputFormat, workerStats, nThreads, get_delta_time ());
+    free(stats);
+
+    return (nFailed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 /**
  *  \brief Get the process time that has elapsed since last call of this time.
  *
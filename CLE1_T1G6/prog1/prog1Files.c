@@ -0,0 +1,164 @@
+/**
+ * @file prog1Files.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Input file table, grown as paths are added.
+ *
+ * Paths may name files or directories, which are walked recursively (entries in name order, symbolic links to
+ * directories are not followed), or be read from a list file or the standard input, one per line. Shared by the
+ * pthread (CLE1) and MPI (CLE2) programs.
+ *
+ * Functions:
+ *     \li addPath
+ *     \li addPathList.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "prog1Files.h"
+
+/** \brief initial number of file names the table has room for */
+#define FILELISTCAPACITY 64
+
+/**
+ * @brief Append a file name to a file table, growing it geometrically.
+ * 
+ * @param list file table
+ * @param name file name, copied
+ * @return true on success, false if memory runs out
+ */
+static bool appendName(struct fileList * list, const char * name) {
+    if(list->count == list->capacity) {
+        int capacity = (list->capacity > 0) ? 2 * list->capacity : FILELISTCAPACITY;
+        char ** names;
+        if((names = (char **)realloc(list->names, capacity * sizeof(char *))) == NULL) return false;
+        list->names = names;
+        list->capacity = capacity;
+    }
+    if((list->names[list->count] = strdup(name)) == NULL) return false;
+    list->count++;
+    return true;
+}
+
+/**
+ * @brief Compare two strings through pointers to them, for qsort.
+ * 
+ * @param a pointer to the first string
+ * @param b pointer to the second string
+ * @return int : order of the strings
+ */
+static int compareNames(const void * a, const void * b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/**
+ * @brief Add the files of a directory tree to a file table, in name order.
+ *
+ * Subdirectories and entries which can not be read are reported on the standard error and skipped, the walk carries on
+ * with their siblings.
+ * 
+ * @param list file table
+ * @param dirName name of the directory
+ * @param top flag signaling if the directory is the one the walk started from
+ * @return true on success, false if memory runs out or the top directory can not be read
+ */
+static bool addDirectory(struct fileList * list, const char * dirName, bool top) {
+    DIR * dir;
+    struct dirent * entry;
+    char ** entries = NULL;
+    int nEntries = 0, capacity = 0;
+    bool ok = true;
+
+    if((dir = opendir(dirName)) == NULL) {
+        if(top) return false;
+        fprintf(stderr, "Skipping directory %s: %s\n", dirName, strerror(errno));
+        return true;
+    }
+    while(ok && ((entry = readdir(dir)) != NULL)) { // gather the entries first, so they can be sorted
+        if((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) continue;
+        if(nEntries == capacity) {
+            capacity = (capacity > 0) ? 2 * capacity : FILELISTCAPACITY;
+            char ** grown;
+            if((grown = (char **)realloc(entries, capacity * sizeof(char *))) == NULL) {
+                ok = false;
+                break;
+            }
+            entries = grown;
+        }
+        size_t size = strlen(dirName) + strlen(entry->d_name) + 2;
+        if((entries[nEntries] = (char *)malloc(size)) == NULL) {
+            ok = false;
+            break;
+        }
+        snprintf(entries[nEntries++], size, "%s/%s", dirName, entry->d_name);
+    }
+    closedir(dir);
+
+    if(ok) qsort(entries, nEntries, sizeof(char *), compareNames);
+    for(int i = 0; i < nEntries; i++) {
+        struct stat st;
+        if(ok && (lstat(entries[i], &st) != 0)) fprintf(stderr, "Skipping %s: %s\n", entries[i], strerror(errno));
+        else if(ok) {
+            if(S_ISDIR(st.st_mode)) ok = addDirectory(list, entries[i], false);
+            else if(S_ISREG(st.st_mode)) ok = appendName(list, entries[i]);
+            else if(S_ISLNK(st.st_mode) && (stat(entries[i], &st) == 0) && S_ISREG(st.st_mode)) ok = appendName(list, entries[i]);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return ok;
+}
+
+/**
+ * @brief Add a file, or the files of a directory tree, to a file table.
+ *
+ * Subdirectories of the tree which can not be read are skipped with a warning on the standard error.
+ * 
+ * @param list file table (zeroed before the first path is added)
+ * @param path name of the file or directory
+ * @return true on success, false if the path can not be read or memory runs out (errno is set)
+ */
+bool addPath(struct fileList * list, const char * path) {
+    struct stat st;
+
+    if((stat(path, &st) == 0) && S_ISDIR(st.st_mode)) return addDirectory(list, path, true);
+    return appendName(list, path); // files which can not be opened are reported when they are
+}
+
+/**
+ * @brief Add the paths listed in a file, one per line, to a file table.
+ * 
+ * @param list file table
+ * @param listName name of the list file, "-" for the standard input
+ * @return true on success, false if the list or one of its paths can not be read (errno is set)
+ */
+bool addPathList(struct fileList * list, const char * listName) {
+    FILE * fp = (strcmp(listName, "-") == 0) ? stdin : fopen(listName, "r");
+    char * line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    bool ok = true;
+
+    if(fp == NULL) return false;
+    while(ok && ((length = getline(&line, &size, fp)) != -1)) {
+        while((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r'))) line[--length] = '\0';
+        if(length > 0) ok = addPath(list, line); // blank lines are skipped
+    }
+    free(line);
+    if(fp != stdin) fclose(fp);
+    return ok;
+}
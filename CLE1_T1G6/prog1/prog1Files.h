@@ -0,0 +1,55 @@
+/**
+ * @file prog1Files.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Input file table, grown as paths are added.
+ *
+ * Paths may name files or directories, which are walked recursively (entries in name order, symbolic links to
+ * directories are not followed), or be read from a list file or the standard input, one per line. Shared by the
+ * pthread (CLE1) and MPI (CLE2) programs.
+ *
+ * Functions:
+ *     \li addPath
+ *     \li addPathList.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef PROG1_FILES_H
+#define PROG1_FILES_H
+
+#include <stdbool.h>
+
+/** \brief table of input file names. */
+struct fileList {
+    char ** names;      /**< file names, in the order they were added */
+    int count;          /**< number of file names */
+    int capacity;       /**< number of file names the table has room for */
+};
+
+/**
+ * @brief Add a file, or the files of a directory tree, to a file table.
+ *
+ * Subdirectories of the tree which can not be read are skipped with a warning on the standard error.
+ *
+ * @param list file table (zeroed before the first path is added)
+ * @param path name of the file or directory
+ * @return true on success, false if the path can not be read or memory runs out (errno is set)
+ */
+extern bool addPath(struct fileList * list, const char * path);
+
+/**
+ * @brief Add the paths listed in a file, one per line, to a file table.
+ *
+ * @param list file table
+ * @param listName name of the list file, "-" for the standard input
+ * @return true on success, false if the list or one of its paths can not be read (errno is set)
+ */
+extern bool addPathList(struct fileList * list, const char * listName);
+
+#endif
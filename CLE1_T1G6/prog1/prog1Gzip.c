@@ -0,0 +1,259 @@
+/**
+ * @file prog1Gzip.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Streaming inflation of gzip-compressed files with zlib (link with -lz), straight into the caller's buffers.
+ *
+ * A BGZF block is a gzip member whose extra field holds a BC subfield with the size of the block, minus one; its
+ * uncompressed size is the ISIZE field of its trailer. A file is only taken for BGZF if all of its members are such
+ * blocks, anything else is inflated as a single run, member after member.
+ *
+ * Functions:
+ *     \li gzipIsCompressed
+ *     \li gzipRuns
+ *     \li gzipOpen
+ *     \li gzipRead
+ *     \li gzipClose.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "prog1Gzip.h"
+
+/** \brief size, in bytes, of the compressed bytes read ahead by each stream */
+#define GZIPINPUT (256 * 1024)
+
+/** \brief size, in bytes, of the fixed part of a gzip member header */
+#define GZIPHEADER 12
+
+/** \brief size, in bytes, of a gzip member trailer (CRC32 and ISIZE) */
+#define GZIPTRAILER 8
+
+/** \brief size, in bytes, of the extra field read at most to find the BC subfield of a BGZF block */
+#define BGZFEXTRA 244
+
+/** \brief initial number of runs the table of a BGZF file has room for */
+#define RUNCAPACITY 16
+
+/**
+ * @brief Tell if a file is gzip-compressed, by its name.
+ *
+ * @param name name of the file
+ * @return true if the name ends with .gz
+ */
+bool gzipIsCompressed(const char * name) {
+    size_t length = strlen(name);
+    return (length > 3) && (strcmp(&name[length - 3], ".gz") == 0);
+}
+
+/**
+ * @brief Read bytes of a file at a given offset.
+ *
+ * @param fd file descriptor
+ * @param data output variable, bytes read
+ * @param size number of bytes to read
+ * @param offset file offset of the first byte
+ * @return true if all the bytes were read, false otherwise
+ */
+static bool readAt(int fd, unsigned char * data, size_t size, off_t offset) {
+    size_t bytesRead = 0;
+
+    while(bytesRead < size) { // pread may return less than requested
+        ssize_t n = pread(fd, data + bytesRead, size - bytesRead, offset + (off_t)bytesRead);
+        if(n <= 0) return false;
+        bytesRead += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Size a BGZF block from its header and trailer.
+ *
+ * @param fd file descriptor
+ * @param offset file offset of the block
+ * @param size size of the file, in bytes
+ * @param blockSize output variable, compressed size of the block, in bytes
+ * @param blockBytes output variable, uncompressed size of the block, in bytes
+ * @return true if a BGZF block lies at the offset, false otherwise
+ */
+static bool sizeBlock(int fd, off_t offset, off_t size, off_t * blockSize, long long * blockBytes) {
+    unsigned char header[GZIPHEADER + BGZFEXTRA], trailer[GZIPTRAILER];
+    unsigned int extraSize;
+
+    if((offset + GZIPHEADER > size) || !readAt(fd, header, GZIPHEADER, offset)) return false;
+    if((header[0] != 0x1f) || (header[1] != 0x8b) || (header[2] != Z_DEFLATED) || !(header[3] & 0x04)) return false; // FEXTRA
+    if(((extraSize = header[10] | (header[11] << 8)) > BGZFEXTRA) || (offset + GZIPHEADER + extraSize > size) ||
+       !readAt(fd, &header[GZIPHEADER], extraSize, offset + GZIPHEADER)) return false;
+
+    *blockSize = 0;
+    for(unsigned int i = GZIPHEADER; i + 4 <= GZIPHEADER + extraSize; ) { // subfields: SI1 SI2 SLEN data
+        unsigned int fieldSize = header[i + 2] | (header[i + 3] << 8);
+        if((header[i] == 'B') && (header[i + 1] == 'C') && (fieldSize == 2) && (i + 6 <= GZIPHEADER + extraSize)) {
+            *blockSize = (off_t)(header[i + 4] | (header[i + 5] << 8)) + 1;
+            break;
+        }
+        i += 4 + fieldSize;
+    }
+    if((*blockSize < GZIPHEADER + extraSize + GZIPTRAILER) || (offset + *blockSize > size) ||
+       !readAt(fd, trailer, GZIPTRAILER, offset + *blockSize - GZIPTRAILER)) return false;
+    *blockBytes = (long long)trailer[4] | ((long long)trailer[5] << 8) | ((long long)trailer[6] << 16) |
+                  ((long long)trailer[7] << 24);
+    return true;
+}
+
+/**
+ * @brief Cut a gzip-compressed file into runs of members to be inflated on their own.
+ *
+ * The blocks of a BGZF file are sized one after the other and grouped in order; the last run ends with the file.
+ *
+ * @param fd file descriptor
+ * @param size size of the file, in bytes
+ * @param target uncompressed size, in bytes, BGZF blocks are grouped into runs of, at least
+ * @param runs output variable, runs of the file in order (allocated, to be freed)
+ * @return int : number of runs (a single one of unknown size unless the file is BGZF), -1 if memory runs out
+ */
+int gzipRuns(int fd, off_t size, long long target, struct gzipRun ** runs) {
+    struct gzipRun * list = NULL;
+    int n = 0, capacity = 0;
+    struct gzipRun run = {0, 0, 0};
+    bool bgzf = true;
+
+    while(bgzf && (run.hi < size)) {
+        off_t blockSize;
+        long long blockBytes;
+        if(!(bgzf = sizeBlock(fd, run.hi, size, &blockSize, &blockBytes))) break;
+        run.hi += blockSize;
+        run.size += blockBytes;
+        if((run.size < target) && (run.hi < size)) continue;
+        if(n == capacity) { // grow the table geometrically
+            struct gzipRun * grown;
+            capacity = (capacity > 0) ? 2 * capacity : RUNCAPACITY;
+            if((grown = (struct gzipRun *)realloc(list, capacity * sizeof(struct gzipRun))) == NULL) {
+                free(list);
+                return -1;
+            }
+            list = grown;
+        }
+        list[n++] = run;
+        run.lo = run.hi;
+        run.size = 0;
+    }
+    if(bgzf && (n > 0)) {
+        *runs = list;
+        return n;
+    }
+
+    free(list); // members are found as they are inflated
+    if((*runs = (struct gzipRun *)malloc(sizeof(struct gzipRun))) == NULL) return -1;
+    (*runs)->lo = 0;
+    (*runs)->hi = size;
+    (*runs)->size = -1;
+    return 1;
+}
+
+/**
+ * @brief Start inflating a run of gzip members.
+ *
+ * @param stream output variable, inflation of the run
+ * @param fd file descriptor
+ * @param run run of members
+ * @return true on success, false if memory runs out
+ */
+bool gzipOpen(struct gzipStream * stream, int fd, const struct gzipRun * run) {
+    memset(stream, 0, sizeof(struct gzipStream));
+    stream->fd = fd;
+    stream->offset = run->lo;
+    stream->end = run->hi;
+    if((stream->in = (unsigned char *)malloc(GZIPINPUT)) == NULL) return false;
+    if(inflateInit2(&stream->z, 16 + MAX_WBITS) != Z_OK) { // gzip wrapper only
+        free(stream->in);
+        stream->in = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read the next compressed bytes of a run after those not inflated yet.
+ *
+ * @param stream inflation of the run
+ * @return true on success (or if the run was all read), false on a read error (stream->error is then set)
+ */
+static bool refill(struct gzipStream * stream) {
+    if(stream->offset >= stream->end) return true;
+    if(stream->z.avail_in > 0) memmove(stream->in, stream->z.next_in, stream->z.avail_in);
+    size_t room = GZIPINPUT - stream->z.avail_in;
+    if((off_t)room > stream->end - stream->offset) room = (size_t)(stream->end - stream->offset);
+
+    ssize_t n = pread(stream->fd, stream->in + stream->z.avail_in, room, stream->offset);
+    if(n < 0) {
+        stream->error = strerror(errno);
+        return false;
+    }
+    if(n == 0) stream->end = stream->offset; // file shrank meanwhile
+    stream->z.next_in = stream->in;
+    stream->z.avail_in += n;
+    stream->offset += n;
+    return true;
+}
+
+/**
+ * @brief Inflate the next bytes of a run.
+ *
+ * Bytes found past the last member (not starting another one) are ignored, as gzip does.
+ *
+ * @param stream inflation of the run
+ * @param data output variable, bytes inflated
+ * @param size number of bytes to inflate
+ * @return size_t : number of bytes inflated, fewer than asked for only at the end of the run or if the inflation
+ *         stopped early (stream->error is then set)
+ */
+size_t gzipRead(struct gzipStream * stream, unsigned char * data, size_t size) {
+    stream->z.next_out = data;
+    stream->z.avail_out = size;
+
+    while((stream->z.avail_out > 0) && (stream->error == NULL)) {
+        if((stream->z.avail_in < 2) && !refill(stream)) break; // a member's magic number needs two bytes
+        if(!stream->inMember) { // start the next member, if any
+            if((stream->z.avail_in < 2) || (stream->z.next_in[0] != 0x1f) || (stream->z.next_in[1] != 0x8b)) {
+                if((stream->members == 0) && (stream->z.avail_in > 0)) stream->error = "not in gzip format";
+                break;
+            }
+            inflateReset(&stream->z);
+            stream->inMember = true;
+            stream->members++;
+        }
+        int status = inflate(&stream->z, Z_NO_FLUSH);
+        if(status == Z_STREAM_END) stream->inMember = false;
+        else if((status == Z_BUF_ERROR) && (stream->z.avail_in == 0) && (stream->offset >= stream->end)) {
+            stream->error = "unexpected end of file";
+        }
+        else if((status != Z_OK) && (status != Z_BUF_ERROR)) {
+            stream->error = (stream->z.msg != NULL) ? stream->z.msg : "invalid compressed data";
+        }
+    }
+    return size - stream->z.avail_out;
+}
+
+/**
+ * @brief Stop inflating a run.
+ *
+ * @param stream inflation of the run
+ */
+void gzipClose(struct gzipStream * stream) {
+    if(stream->in == NULL) return;
+    inflateEnd(&stream->z);
+    free(stream->in);
+    stream->in = NULL;
+}
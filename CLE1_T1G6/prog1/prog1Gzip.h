@@ -0,0 +1,104 @@
+/**
+ * @file prog1Gzip.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Streaming inflation of gzip-compressed files with zlib (link with -lz), straight into the caller's buffers.
+ *
+ * A file is cut into runs of members inflated on their own. The members of a plain gzip file (one member, or
+ * several concatenated) are only found by inflating the ones before them, so the whole file is a single run of
+ * unknown size. BGZF files (bgzip, samtools) store the compressed size of each block in its header and the
+ * uncompressed size in its trailer, so their blocks are found with a few bytes read per block and grouped into runs
+ * of known size, which may be inflated in parallel.
+ *
+ * Functions:
+ *     \li gzipIsCompressed
+ *     \li gzipRuns
+ *     \li gzipOpen
+ *     \li gzipRead
+ *     \li gzipClose.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef PROG1_GZIP_H
+#define PROG1_GZIP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+/** \brief run of gzip members inflated on its own: the whole file, or consecutive BGZF blocks. */
+struct gzipRun {
+    off_t lo;               /**< file offset of the first member */
+    off_t hi;               /**< file offset past the last member */
+    long long size;         /**< uncompressed size, in bytes (-1 if unknown) */
+};
+
+/** \brief inflation of a run of gzip members. */
+struct gzipStream {
+    z_stream z;             /**< zlib state */
+    int fd;                 /**< file descriptor, read with pread */
+    off_t offset;           /**< file offset of the next bytes to read */
+    off_t end;              /**< file offset past the last member of the run */
+    unsigned char * in;     /**< compressed bytes read ahead */
+    bool inMember;          /**< a member was started and not ended yet */
+    int members;            /**< number of members started */
+    const char * error;     /**< reason the inflation stopped early, NULL if none */
+};
+
+/**
+ * @brief Tell if a file is gzip-compressed, by its name.
+ *
+ * @param name name of the file
+ * @return true if the name ends with .gz
+ */
+extern bool gzipIsCompressed(const char * name);
+
+/**
+ * @brief Cut a gzip-compressed file into runs of members to be inflated on their own.
+ *
+ * @param fd file descriptor
+ * @param size size of the file, in bytes
+ * @param target uncompressed size, in bytes, BGZF blocks are grouped into runs of, at least
+ * @param runs output variable, runs of the file in order (allocated, to be freed)
+ * @return int : number of runs (a single one of unknown size unless the file is BGZF), -1 if memory runs out
+ */
+extern int gzipRuns(int fd, off_t size, long long target, struct gzipRun ** runs);
+
+/**
+ * @brief Start inflating a run of gzip members.
+ *
+ * @param stream output variable, inflation of the run
+ * @param fd file descriptor
+ * @param run run of members
+ * @return true on success, false if memory runs out
+ */
+extern bool gzipOpen(struct gzipStream * stream, int fd, const struct gzipRun * run);
+
+/**
+ * @brief Inflate the next bytes of a run.
+ *
+ * Bytes found past the last member (not starting another one) are ignored, as gzip does.
+ *
+ * @param stream inflation of the run
+ * @param data output variable, bytes inflated
+ * @param size number of bytes to inflate
+ * @return size_t : number of bytes inflated, fewer than asked for only at the end of the run or if the inflation
+ *         stopped early (stream->error is then set)
+ */
+extern size_t gzipRead(struct gzipStream * stream, unsigned char * data, size_t size);
+
+/**
+ * @brief Stop inflating a run.
+ *
+ * @param stream inflation of the run
+ */
+extern void gzipClose(struct gzipStream * stream);
+
+#endif
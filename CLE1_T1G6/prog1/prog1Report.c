@@ -0,0 +1,335 @@
+/**
+ * @file prog1Report.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Output of the results, as text tables or in a machine-readable format (JSON or CSV).
+ *
+ * Files are reported one at a time, as they are done, followed by the run: per-worker chunks, bytes and busy/idle
+ * time, elapsed time and throughput. Shared by the pthread (CLE1) and MPI (CLE2) programs.
+ *
+ * Letters and word lengths, when gathered, follow the vowels of each file: a table each in the text format, a
+ * "letters" object and a "lengths" array in JSON, and a column per letter and per length in CSV.
+ *
+ * A file which could not be counted in full carries the reason in its "error" member (null otherwise) in JSON and in
+ * the last column of its row (empty otherwise) in CSV; the text format leaves it to the line on the standard error.
+ *
+ * Functions:
+ *     \li parseFormat
+ *     \li wallClock
+ *     \li reportBegin
+ *     \li reportBeginStats
+ *     \li reportFile
+ *     \li reportFileStats
+ *     \li reportTop
+ *     \li reportRun.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "prog1Report.h"
+
+/** \brief number of vowels reported for each file */
+#define REPORTVOWELS 6
+
+/** \brief names of the vowels reported for each file */
+static const char * const vowelNames[REPORTVOWELS] = {"a", "e", "i", "o", "u", "y"};
+
+/** \brief number of letters reported for each file, when gathered */
+#define REPORTLETTERS 26
+
+/** \brief number of bins of the word length histogram reported for each file, the last one open-ended */
+#define REPORTLENGTHS 32
+
+/** \brief flag signaling if the number of each letter is reported */
+static bool reportLetters = false;
+
+/** \brief flag signaling if the word length histogram is reported */
+static bool reportLengths = false;
+
+/** \brief number of files reported so far */
+static unsigned long long filesReported = 0;
+
+/** \brief flag signaling if the files were followed by other results (the JSON files array is closed) */
+static bool filesClosed = false;
+
+/**
+ * @brief Print bytes as a JSON string.
+ *
+ * @param bytes bytes to print
+ * @param length number of bytes
+ */
+static void printJsonBytes(const char * bytes, size_t length) {
+    putchar('"');
+    for(const unsigned char * c = (const unsigned char *)bytes; c < (const unsigned char *)bytes + length; c++) {
+        if((*c == '"') || (*c == '\\')) printf("\\%c", *c);
+        else if(*c < 0x20) printf("\\u%04x", *c);
+        else putchar(*c);
+    }
+    putchar('"');
+}
+
+/**
+ * @brief Print a file name as a JSON string.
+ *
+ * @param name file name
+ */
+static void printJsonString(const char * name) {
+    printJsonBytes(name, strlen(name));
+}
+
+/**
+ * @brief Print bytes as a CSV field, always quoted.
+ *
+ * @param bytes bytes to print
+ * @param length number of bytes
+ */
+static void printCsvBytes(const char * bytes, size_t length) {
+    putchar('"');
+    for(const char * c = bytes; c < bytes + length; c++) {
+        if(*c == '"') putchar('"');
+        putchar(*c);
+    }
+    putchar('"');
+}
+
+/**
+ * @brief Print a file name as a CSV field, always quoted.
+ *
+ * @param name file name
+ */
+static void printCsvString(const char * name) {
+    printCsvBytes(name, strlen(name));
+}
+
+/**
+ * @brief Parse an output format given on the command line.
+ *
+ * @param arg text, json or csv
+ * @param format output variable, FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV
+ * @return true if the format is known, false otherwise
+ */
+bool parseFormat(const char * arg, int * format) {
+    if(strcmp(arg, "text") == 0) *format = FORMAT_TEXT;
+    else if(strcmp(arg, "json") == 0) *format = FORMAT_JSON;
+    else if(strcmp(arg, "csv") == 0) *format = FORMAT_CSV;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return double : time, in seconds, from an arbitrary origin
+ */
+double wallClock(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1.0e-9 * (double)t.tv_nsec;
+}
+
+/**
+ * @brief Start a report, before the first file is reported.
+ *
+ * @param format output format
+ */
+void reportBegin(int format) {
+    reportBeginStats(format, false, false);
+}
+
+/**
+ * @brief Start a report of files with extra statistics, before the first file is reported.
+ *
+ * @param format output format
+ * @param letters true if the number of each letter is reported
+ * @param lengths true if the word length histogram is reported
+ */
+void reportBeginStats(int format, bool letters, bool lengths) {
+    filesReported = 0;
+    filesClosed = false;
+    reportLetters = letters;
+    reportLengths = lengths;
+    if(format == FORMAT_JSON) printf("{\"files\": [");
+    else if(format == FORMAT_CSV) {
+        printf("file,bytes,seconds,words,a,e,i,o,u,y");
+        if(letters) for(int l = 0; l < REPORTLETTERS; l++) printf(",letter_%c", 'a' + l);
+        if(lengths) for(int l = 1; l <= REPORTLENGTHS; l++) printf(",length_%d%s", l, (l == REPORTLENGTHS) ? "+" : "");
+        printf(",error\n");
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Report the counts of a file, flushing them so they may be read while the other files are processed.
+ *
+ * @param format output format
+ * @param name file name
+ * @param bytes size of the file, in bytes
+ * @param seconds time, in seconds, from the first chunk of the file being claimed to its counts being ready
+ * @param words number of words
+ * @param vowels number of words holding each vowel (a, e, i, o, u, y)
+ * @param error errno of the failure which left the file uncounted or cut short, 0 if none
+ */
+void reportFile(int format, const char * name, long long bytes, double seconds, unsigned long long words,
+                const unsigned long long * vowels, int error) {
+    reportFileStats(format, name, bytes, seconds, words, vowels, NULL, NULL, error);
+}
+
+/**
+ * @brief Report the counts and extra statistics of a file, flushing them like reportFile.
+ *
+ * @param format output format
+ * @param name file name
+ * @param bytes size of the file, in bytes
+ * @param seconds time, in seconds, from the first chunk of the file being claimed to its counts being ready
+ * @param words number of words
+ * @param vowels number of words holding each vowel (a, e, i, o, u, y)
+ * @param letters number of each letter, a to z (must be given if announced to reportBeginStats)
+ * @param lengths number of words of each length from 1 to 31 letters, then of 32 or more (likewise)
+ * @param error errno of the failure which left the file uncounted or cut short, 0 if none
+ */
+void reportFileStats(int format, const char * name, long long bytes, double seconds, unsigned long long words,
+                     const unsigned long long * vowels, const unsigned long long * letters,
+                     const unsigned long long * lengths, int error) {
+    bool withLetters = reportLetters && (letters != NULL), withLengths = reportLengths && (lengths != NULL);
+
+    switch(format) {
+        case FORMAT_JSON:
+            printf("%s\n  {\"name\": ", (filesReported > 0) ? "," : "");
+            printJsonString(name);
+            printf(", \"bytes\": %lld, \"seconds\": %.6f, \"words\": %llu, \"vowels\": {", bytes, seconds, words);
+            for(int j = 0; j < REPORTVOWELS; j++) printf("%s\"%s\": %llu", j ? ", " : "", vowelNames[j], vowels[j]);
+            printf("}");
+            if(withLetters) {
+                printf(", \"letters\": {");
+                for(int l = 0; l < REPORTLETTERS; l++) printf("%s\"%c\": %llu", l ? ", " : "", 'a' + l, letters[l]);
+                printf("}");
+            }
+            if(withLengths) {
+                printf(", \"lengths\": [");
+                for(int l = 0; l < REPORTLENGTHS; l++) printf("%s%llu", l ? ", " : "", lengths[l]);
+                printf("]");
+            }
+            printf(", \"error\": ");
+            if(error != 0) printJsonString(strerror(error));
+            else printf("null");
+            printf("}");
+            break;
+        case FORMAT_CSV:
+            printCsvString(name);
+            printf(",%lld,%.6f,%llu", bytes, seconds, words);
+            for(int j = 0; j < REPORTVOWELS; j++) printf(",%llu", vowels[j]);
+            if(withLetters) for(int l = 0; l < REPORTLETTERS; l++) printf(",%llu", letters[l]);
+            if(withLengths) for(int l = 0; l < REPORTLENGTHS; l++) printf(",%llu", lengths[l]);
+            printf(",");
+            if(error != 0) printCsvString(strerror(error));
+            printf("\n");
+            break;
+        default:
+            printf("File name: %s\n", name);
+            printf("Total number of words = %llu\n", words);
+            printf("N. of words with an\n");
+            printf("\tA\tE\tI\tO\tU\tY\n");
+            printf("\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n\n", vowels[0], vowels[1], vowels[2], vowels[3], vowels[4], vowels[5]);
+            if(withLetters) {
+                printf("N. of letters\n");
+                for(int l = 0; l < REPORTLETTERS; l++) printf("\t%c", 'A' + l);
+                printf("\n");
+                for(int l = 0; l < REPORTLETTERS; l++) printf("\t%llu", letters[l]);
+                printf("\n\n");
+            }
+            if(withLengths) {
+                printf("N. of words with length\n");
+                for(int l = 1; l <= REPORTLENGTHS; l++) printf("\t%d%s", l, (l == REPORTLENGTHS) ? "+" : "");
+                printf("\n");
+                for(int l = 0; l < REPORTLENGTHS; l++) printf("\t%llu", lengths[l]);
+                printf("\n\n");
+            }
+    }
+    filesReported++;
+    fflush(stdout);
+}
+
+/**
+ * @brief Report the most frequent words of all files, once every file was reported.
+ *
+ * @param format output format
+ * @param top most frequent words, most frequent first
+ * @param n number of words
+ */
+void reportTop(int format, const struct topWord * top, int n) {
+    switch(format) {
+        case FORMAT_JSON:
+            printf("%s],\n \"top\": [", (filesReported > 0) ? "\n" : "");
+            for(int i = 0; i < n; i++) {
+                printf("%s\n  {\"word\": ", i ? "," : "");
+                printJsonBytes(top[i].word, top[i].length);
+                printf(", \"count\": %llu}", top[i].count);
+            }
+            printf("%s", (n > 0) ? "\n" : "");
+            filesClosed = true;
+            break;
+        case FORMAT_CSV:
+            printf("\nrank,word,count\n");
+            for(int i = 0; i < n; i++) {
+                printf("%d,", i + 1);
+                printCsvBytes(top[i].word, top[i].length);
+                printf(",%llu\n", top[i].count);
+            }
+            break;
+        default:
+            printf("Most frequent words\n");
+            for(int i = 0; i < n; i++) printf("\t%d\t%.*s\t%llu\n", i + 1, (int)top[i].length, top[i].word, top[i].count);
+            printf("\n");
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief End a report with the run-level metrics, once every file was reported.
+ *
+ * The text format only gets the elapsed time.
+ *
+ * @param format output format
+ * @param workers work done by each worker
+ * @param nWorkers number of workers
+ * @param elapsed elapsed time of the run, in seconds
+ */
+void reportRun(int format, const struct workerStats * workers, int nWorkers, double elapsed) {
+    unsigned long long bytes = 0;
+    for(int i = 0; i < nWorkers; i++) bytes += workers[i].bytes;
+    double throughput = (elapsed > 0) ? (double)bytes / elapsed / 1.0e6 : 0;
+
+    switch(format) {
+        case FORMAT_JSON:
+            printf("%s],\n \"workers\": [", (!filesClosed && (filesReported > 0)) ? "\n" : "");
+            for(int i = 0; i < nWorkers; i++) {
+                printf("%s\n  {\"id\": %d, \"chunks\": %llu, \"bytes\": %llu, \"busy\": %.6f, \"idle\": %.6f}", i ? "," : "",
+                       i, workers[i].chunks, workers[i].bytes, workers[i].busy, workers[i].idle);
+            }
+            printf("%s],\n \"elapsed\": %.6f, \"bytes\": %llu, \"throughput\": %.3f}\n", (nWorkers > 0) ? "\n" : "",
+                   elapsed, bytes, throughput);
+            break;
+        case FORMAT_CSV:
+            printf("\nworker,chunks,bytes,busy,idle\n");
+            for(int i = 0; i < nWorkers; i++) {
+                printf("%d,%llu,%llu,%.6f,%.6f\n", i, workers[i].chunks, workers[i].bytes, workers[i].busy, workers[i].idle);
+            }
+            printf("\nelapsed,bytes,throughput\n%.6f,%llu,%.3f\n", elapsed, bytes, throughput);
+            break;
+        default:
+            printf("\nElapsed time = %.6f s\n", elapsed);
+    }
+    fflush(stdout);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file prog1Report.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Output of the results, as text tables or in a machine-readable format (JSON or CSV).
+ *
+ * Files are reported one at a time, as they are done, followed by the run: per-worker chunks, bytes and busy/idle
+ * time, elapsed time and throughput (MB/s, 10^6 bytes). A JSON report is a single object whose "files" array is
+ * written as files are done; a CSV report is a table of files, then a table of workers and a table of the run,
+ * separated by blank lines. Shared by the pthread (CLE1) and MPI (CLE2) programs.
+ *
+ * Files may also be reported with the number of each letter and a histogram of their word lengths, when gathered,
+ * and the run with the most frequent words of all files, before the run-level metrics.
+ *
+ * A file which could not be counted in full is still reported, with the reason as its "error" (JSON) or last column
+ * (CSV), so it is not mistaken for an empty one.
+ *
+ * Functions:
+ *     \li parseFormat
+ *     \li wallClock
+ *     \li reportBegin
+ *     \li reportBeginStats
+ *     \li reportFile
+ *     \li reportFileStats
+ *     \li reportTop
+ *     \li reportRun.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef PROG1_REPORT_H
+#define PROG1_REPORT_H
+
+#include <stdbool.h>
+
+#include "wordFreq.h"
+
+/** \brief output format: human-readable tables. */
+#define FORMAT_TEXT 0
+
+/** \brief output format: a JSON object. */
+#define FORMAT_JSON 1
+
+/** \brief output format: CSV tables. */
+#define FORMAT_CSV 2
+
+/** \brief work done by a worker during the run. */
+struct workerStats {
+    unsigned long long chunks;  /**< number of chunks processed */
+    unsigned long long bytes;   /**< number of bytes processed */
+    double busy;                /**< time, in seconds, spent reading and processing chunks */
+    double idle;                /**< time, in seconds, spent waiting for chunks */
+};
+
+/**
+ * @brief Parse an output format given on the command line.
+ *
+ * @param arg text, json or csv
+ * @param format output variable, FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV
+ * @return true if the format is known, false otherwise
+ */
+extern bool parseFormat(const char * arg, int * format);
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return double : time, in seconds, from an arbitrary origin
+ */
+extern double wallClock(void);
+
+/**
+ * @brief Start a report, before the first file is reported.
+ *
+ * @param format output format
+ */
+extern void reportBegin(int format);
+
+/**
+ * @brief Start a report of files with extra statistics, before the first file is reported.
+ *
+ * @param format output format
+ * @param letters true if the number of each letter is reported
+ * @param lengths true if the word length histogram is reported
+ */
+extern void reportBeginStats(int format, bool letters, bool lengths);
+
+/**
+ * @brief Report the counts of a file, flushing them so they may be read while the other files are processed.
+ *
+ * @param format output format
+ * @param name file name
+ * @param bytes size of the file, in bytes
+ * @param seconds time, in seconds, from the first chunk of the file being claimed to its counts being ready
+ * @param words number of words
+ * @param vowels number of words holding each vowel (a, e, i, o, u, y)
+ * @param error errno of the failure which left the file uncounted or cut short, 0 if none
+ */
+extern void reportFile(int format, const char * name, long long bytes, double seconds, unsigned long long words,
+                       const unsigned long long * vowels, int error);
+
+/**
+ * @brief Report the counts and extra statistics of a file, flushing them like reportFile.
+ *
+ * @param format output format
+ * @param name file name
+ * @param bytes size of the file, in bytes
+ * @param seconds time, in seconds, from the first chunk of the file being claimed to its counts being ready
+ * @param words number of words
+ * @param vowels number of words holding each vowel (a, e, i, o, u, y)
+ * @param letters number of each letter, a to z (must be given if announced to reportBeginStats)
+ * @param lengths number of words of each length from 1 to 31 letters, then of 32 or more (likewise)
+ * @param error errno of the failure which left the file uncounted or cut short, 0 if none
+ */
+extern void reportFileStats(int format, const char * name, long long bytes, double seconds, unsigned long long words,
+                            const unsigned long long * vowels, const unsigned long long * letters,
+                            const unsigned long long * lengths, int error);
+
+/**
+ * @brief Report the most frequent words of all files, once every file was reported.
+ *
+ * @param format output format
+ * @param top most frequent words, most frequent first
+ * @param n number of words
+ */
+extern void reportTop(int format, const struct topWord * top, int n);
+
+/**
+ * @brief End a report with the run-level metrics, once every file was reported.
+ *
+ * @param format output format
+ * @param workers work done by each worker
+ * @param nWorkers number of workers
+ * @param elapsed elapsed time of the run, in seconds
+ */
+extern void reportRun(int format, const struct workerStats * workers, int nWorkers, double elapsed);
+
+#endif
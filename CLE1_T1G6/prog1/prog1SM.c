@@ -9,12 +9,46 @@
  *  monitor of the Lampson / Redell type.
  *
  *  Data transfer region implemented as a monitor.
+ *  Workers do not enter the monitor: they claim byte ranges of the files with atomic operations, read them
+ *  outside of any lock and store a summary of each. Ranges are cut at arbitrary byte offsets; the worker storing the
+ *  last summary of a file folds them in order and prints the file's counts right away, inside the monitor. Files are
+ *  stat'ed once up front, each is only opened by the first thread claiming one of its ranges and closed once its last
+ *  range is summarized.
+ *
+ *  In pipeline mode reader threads claim the byte ranges instead and read them ahead of demand into a bounded ring
+ *  of buffers; workers pop filled buffers and give them back once processed, both inside the monitor. Readers may
+ *  keep several reads in flight with io_uring.
+ *
+ *  With the stealing scheduler, byte ranges are claimed from per-thread deques of tasks seeded from all files at
+ *  once, and idle threads steal tasks from the others instead of following a single file cursor.
+ *
+ *  With a result cache, files whose counts are found in it are reported as they are stat'ed and never claimed; the
+ *  counts of the others are stored once they are folded.
+ *
+ *  When letters or word lengths are gathered too, the statistics of each byte range are stored next to its summary,
+ *  and folded with it. When the most frequent words are asked for, the edges of each byte range are stored likewise,
+ *  and the worker done with a file's last range interns the words cut between its ranges.
+ *
+ *  In follow mode each file is only claimed from the offset the last run counted up to, and its summaries are folded
+ *  into the running counts saved at that offset.
+ *
+ *  Gzip-compressed files are never claimed: inflater threads take runs of their members in order and inflate them
+ *  into the pipeline buffers, handed to the workers as the readers' are (workers which read their own chunks pop them
+ *  once every byte range is claimed). Runs of known size (BGZF blocks) get their chunks laid out up front, and may be
+ *  inflated in parallel; otherwise chunks are laid out as they are inflated. The summaries of a compressed file are
+ *  kept apart from the others, and stored inside the monitor, since they may be moved as they grow.
+ *
+ *  The monitor and the task deques are entered and left through the wrappers of monitorProbe.h, which time them
+ *  when built with -DMONITOR_PROBE.
  *
  *  Definition of the operations carried out by the threads:
  *     \li (worker) readFromFile
  *     \li (worker) updateCounts
+ *     \li (reader) fillBuffer
+ *     \li (reader) fillBuffersAsync
+ *     \li (inflater) inflateRun
  *     \li (main) storeFileNames
- *     \li (main) printResults.
+ *     \li (main) filesFailed.
  *
  * @version 0.1
  * @date 2023-03-22
@@ -27,10 +61,24 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "prog1Utils.h"
+#include "prog1Uring.h"
+#include "prog1Report.h"
+#include "monitorProbe.h"
+#include "traceEvents.h"
+#include "resultCache.h"
+#include "followState.h"
+#include "wordFreq.h"
+#include "prog1Gzip.h"
 #include "probConst.h"
 
 /** \brief return status on monitor initialization */
@@ -42,36 +90,262 @@ extern int *statusWorker;
 /** \brief main/generator thread return status */
 extern int statusMain;
 
+/** \brief reader threads return status array */
+extern int *statusReader;
+
+/** \brief inflater threads return status array */
+extern int *statusInflater;
+
 /** \brief number of files input by the user */
 extern int nFiles;
 
 /** \brief number of threads input by the user */
 extern int nThreads;
 
+/** \brief flag signaling if input files are memory-mapped instead of read chunk by chunk */
+extern bool useMmap;
+
+/** \brief size, in bytes, of the text chunks the files are cut into */
+extern unsigned int textSize;
+
+/** \brief number of reader threads filling the buffers ahead of the workers (0 if workers read their own chunks) */
+extern int nReaders;
+
+/** \brief number of reads each reader keeps in flight with io_uring (0 for synchronous reads) */
+extern int queueDepth;
+
+/** \brief number of inflater threads filling the buffers with the text of the compressed files (0 if none is) */
+extern int nInflaters;
+
+/** \brief flag signaling if byte ranges are claimed from per-thread task deques with stealing, instead of in order */
+extern bool useStealing;
+
+/** \brief output format of the results (FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV) */
+extern int outputFormat;
+
+/** \brief statistics gathered (STAT_VOWELS, with STAT_LETTERS and/or STAT_LENGTHS) */
+extern int statistics;
+
+/** \brief number of most frequent words reported (0 if words are not interned) */
+extern int topWords;
+
+/** \brief state of a file: not opened yet */
+#define FILE_CLOSED 0
+
+/** \brief state of a file: being opened by the first thread claiming one of its byte ranges */
+#define FILE_OPENING 1
+
+/** \brief state of a file: open (or mapped) until its last byte range is summarized */
+#define FILE_OPEN 2
+
+/** \brief state of a file: could not be opened, its byte ranges are left empty */
+#define FILE_FAILED 3
+
+/** \brief size of a cache line, in bytes */
+#define CACHELINE 64
+
+/** \brief initial number of tasks each deque has room for */
+#define DEQUECAPACITY 16
+
+/** \brief alignment, in bytes, of the pipeline buffers */
+#define BUFFERALIGN 4096
+
+/** \brief number of pipeline buffers per thread (worker or reader) */
+#define BUFFERSPERTHREAD 2
+
+/** \brief number of chunk summaries kept at most, the chunk size is doubled until the files fit in them */
+#define MAXCHUNKS (1 << 22)
+
+/** \brief uncompressed size, in bytes, of the runs of BGZF blocks each inflater takes, at least */
+#define INFLATERUNSIZE (4 * 1024 * 1024)
+
+/** \brief initial number of chunks a compressed file of unknown size has room for */
+#define INFLATEDCHUNKS 64
+
+/** \brief window over a file, holding the text chunk a worker is processing and its surroundings */
+struct fileWindow {
+    unsigned char * data;   /**< bytes of the window */
+    size_t capacity;        /**< allocated size of data (0 if data is a view into a file mapping) */
+    int file;               /**< file the window belongs to, -1 if none */
+    off_t offset;           /**< file offset of the first byte of the window */
+    size_t size;            /**< number of valid bytes in the window */
+};
+
+/** \brief text chunk buffer of the pipeline, filled by a reader and processed by a worker */
+struct chunkBuffer {
+    unsigned char * data;   /**< bytes of the chunk, aligned to BUFFERALIGN */
+    int file;               /**< file the chunk belongs to */
+    size_t chunk;           /**< index of the chunk within its file */
+    int size;               /**< number of valid bytes in data */
+};
+
+/** \brief task of the stealing scheduler: a run of chunks of one file, or a batch of whole small files */
+struct chunkTask {
+    int firstFile;          /**< first file of the task */
+    int lastFile;           /**< last file of the task (a batch of whole files if not firstFile) */
+    size_t lo;              /**< first chunk of the task, within firstFile */
+    size_t hi;              /**< chunk past the last one of the task, within firstFile (only if a single file) */
+};
+
+/** \brief chunks of a compressed file, laid out apart from those of the other files */
+struct inflatedFile {
+    struct chunkSummary * summaries;    /**< summaries of the chunks */
+    struct chunkStats * statistics;     /**< letters and word lengths of the chunks (NULL if not gathered) */
+    struct wordEdges * edges;           /**< bytes around the words interned with the chunks (NULL if none) */
+    size_t capacity;                    /**< number of chunks the arrays have room for */
+    size_t nChunks;                     /**< number of chunks, counted as they are inflated unless the file is sized */
+    size_t stored;                      /**< number of summaries stored */
+    int runsLeft;                       /**< runs of members not inflated yet */
+    bool sized;                         /**< the uncompressed size of the runs is known, their chunks laid out up front */
+    off_t size;                         /**< size of the compressed file, in bytes, as stat'ed */
+};
+
+/** \brief run of members of a compressed file taken by an inflater */
+struct inflateTask {
+    int file;               /**< index of the file */
+    struct gzipRun run;     /**< run of members */
+    size_t firstChunk;      /**< index of the first chunk of the run, within its file */
+    size_t nChunks;         /**< number of chunks of the run (only if sized) */
+};
+
+/** \brief deque of tasks of a thread: the owner pushes and pops at the bottom, thieves steal from the top */
+struct taskDeque {
+    pthread_mutex_t lock;       /**< locking flag which warrants mutual exclusion on the deque */
+    struct chunkTask * tasks;   /**< ring of tasks */
+    int capacity;               /**< number of tasks the ring has room for */
+    int top;                    /**< position of the oldest task */
+    int count;                  /**< number of tasks */
+} __attribute__((aligned(CACHELINE)));
+
 // Shared memory
 /** \brief array of word counts for each file */
-static unsigned int * wordCount;
+static unsigned long long * wordCount;
 
 /** \brief 2D array of vowel count for each file and vowel */
-static unsigned int ** vowelCounts;
+static unsigned long long ** vowelCounts;
+
+/** \brief array of summaries of the byte ranges of all files, one run per file, only folded once all workers have quit */
+static struct chunkSummary * chunkSummaries;
+
+/** \brief array of the letters and word lengths of the byte ranges, laid out as the summaries (NULL if not gathered) */
+static struct chunkStats * chunkStatistics;
+
+/** \brief array of the bytes around the words interned with each byte range, laid out as the summaries (NULL if none) */
+static struct wordEdges * chunkEdges;
+
+/** \brief array of the index of the first summary of each file (and past the last one of the last file) */
+static size_t * firstChunk;
 
 /** \brief array of file name for each file */
 static char ** fileNames;
 
-/** \brief array of pointers signaling the bytes already processed for each file */
-static unsigned int * fileBuffer;
+/** \brief array of offsets up to which each file's bytes were already claimed by the workers */
+static _Atomic off_t * fileBuffer;
+
+/** \brief array of file descriptors of each file (-1 if the file is memory-mapped or could not be opened) */
+static int * fileDesc;
+
+/** \brief array of read-only mappings of each file (memory-mapped mode only) */
+static unsigned char ** fileMap;
+
+/** \brief array of file sizes, in bytes, as stat'ed before processing starts */
+static off_t * fileSize;
+
+/** \brief array of the state of each file (FILE_CLOSED, FILE_OPENING, FILE_OPEN or FILE_FAILED) */
+static atomic_int * fileState;
 
-/** \brief boolean array signaling if a file is done being processed */
-static bool * fileOver;
+/** \brief array of the errno of the first failure on each file (opening, reading or inflating it), 0 if none */
+static atomic_int * fileError;
+
+/** \brief array of the times at which each file was opened, when its first byte range was claimed */
+static double * fileStart;
+
+/** \brief array of the cache keys of each file, as stat'ed before processing starts (hashed once counted, if verifying) */
+static struct cacheKey * fileKeys;
+
+/** \brief array of flags signaling if a file's counts were found in the result cache, so it is never claimed */
+static bool * fileCached;
+
+/** \brief array of offsets each file is counted from, those counted up to by the last run in follow mode (0 otherwise) */
+static off_t * fileBase;
+
+/** \brief array of the running counts of each file at its base offset, unfinished */
+static struct wordTally * fileTally;
+
+/** \brief array of flags signaling if a file is gzip-compressed, so it is inflated instead of claimed */
+static bool * fileCompressed;
+
+/** \brief array of the chunks of each compressed file */
+static struct inflatedFile * inflatedFiles;
+
+/** \brief runs of members of the compressed files, in file order */
+static struct inflateTask * inflateTasks;
+
+/** \brief number of runs of members */
+static int nInflateTasks;
+
+/** \brief number of runs of members the table has room for */
+static int inflateTasksCapacity;
+
+/** \brief next run of members to be taken by an inflater */
+static atomic_int nextInflateTask;
+
+/** \brief array of the number of byte ranges of each file not summarized yet, the file is closed once none is left */
+static atomic_size_t * chunksPending;
 
 /** \brief file currently being processed */
-static int currFile;
+static atomic_int currFile;
 
 /** \brief array of pointers to the file each worker is processing */
 static int * currFileWorker;
 
-/** \brief flag signaling if the work is finished (all files processed) */
-static bool workFinished;
+/** \brief array of pointers to the byte range each worker is processing, within its file */
+static size_t * currChunkWorker;
+
+/** \brief array of windows holding the text chunk each worker is processing */
+static struct fileWindow * windows;
+
+/** \brief array of pipeline buffers */
+static struct chunkBuffer * buffers;
+
+/** \brief number of pipeline buffers */
+static int nBuffers;
+
+/** \brief stack of the indices of the buffers waiting to be filled */
+static int * freeBuffers;
+
+/** \brief number of buffers waiting to be filled */
+static int nFreeBuffers;
+
+/** \brief ring of the indices of the filled buffers, in the order they were filled */
+static int * fullBuffers;
+
+/** \brief position of the oldest filled buffer in the ring */
+static int fullHead;
+
+/** \brief number of filled buffers waiting for a worker */
+static int nFullBuffers;
+
+/** \brief number of readers which may still fill buffers */
+static int activeReaders;
+
+/** \brief array of pointers to the buffer each worker is processing (-1 if none) */
+static int * currBufferWorker;
+
+/** \brief array of task deques of the threads claiming byte ranges (workers, or readers in pipeline mode) */
+static struct taskDeque * deques;
+
+/** \brief number of task deques */
+static int nDeques;
+
+/** \brief number of chunks not claimed yet by the stealing scheduler */
+static atomic_long chunksLeft;
+
+/** \brief readers waiting for a buffer to fill */
+static pthread_cond_t bufferFreed;
+
+/** \brief workers waiting for a filled buffer */
+static pthread_cond_t bufferFilled;
 
 /** \brief locking flag which warrants mutual exclusion inside the monitor */
 static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
@@ -79,62 +353,431 @@ static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
 /** \brief flag which warrants that the data transfer region is initialized exactly once */
 static pthread_once_t init = PTHREAD_ONCE_INIT;
 
-// TODO: do we need init fileNames (already allocated on main)
 /**
  *  \brief Initialization of the data transfer region.
  *
  *  Internal monitor operation.
  */
 static void initialization(void) {
-    if(((wordCount = (unsigned int *)malloc(VOWELNUM * sizeof(unsigned int))) == NULL) ||
-       ((vowelCounts = (unsigned int **)malloc(nFiles * sizeof(unsigned int *))) == NULL) ||
-       ((fileBuffer = (unsigned int *)malloc(nFiles * sizeof(unsigned int))) == NULL) ||
-       ((fileOver = (bool *)malloc(nFiles * sizeof(bool))) == NULL) ||
-       ((fileNames = (char **)malloc(MAXFILECOUNT * sizeof(char *))) == NULL) ||
-       ((currFileWorker = (int *)malloc(nThreads * sizeof(int))) == NULL)) {
+    unsigned long long * counts;
+
+    if(((wordCount = (unsigned long long *)malloc(nFiles * sizeof(unsigned long long))) == NULL) ||
+       ((vowelCounts = (unsigned long long **)malloc(nFiles * sizeof(unsigned long long *))) == NULL) ||
+       ((counts = (unsigned long long *)malloc(nFiles * VOWELNUM * sizeof(unsigned long long))) == NULL) ||
+       ((firstChunk = (size_t *)malloc((nFiles + 1) * sizeof(size_t))) == NULL) ||
+       ((fileBuffer = (_Atomic off_t *)malloc(nFiles * sizeof(_Atomic off_t))) == NULL) ||
+       ((fileDesc = (int *)malloc(nFiles * sizeof(int))) == NULL) ||
+       ((fileMap = (unsigned char **)malloc(nFiles * sizeof(unsigned char *))) == NULL) ||
+       ((fileSize = (off_t *)malloc(nFiles * sizeof(off_t))) == NULL) ||
+       ((fileState = (atomic_int *)malloc(nFiles * sizeof(atomic_int))) == NULL) ||
+       ((fileError = (atomic_int *)malloc(nFiles * sizeof(atomic_int))) == NULL) ||
+       ((fileStart = (double *)malloc(nFiles * sizeof(double))) == NULL) ||
+       ((fileKeys = (struct cacheKey *)calloc(nFiles, sizeof(struct cacheKey))) == NULL) ||
+       ((fileCached = (bool *)calloc(nFiles, sizeof(bool))) == NULL) ||
+       ((fileBase = (off_t *)calloc(nFiles, sizeof(off_t))) == NULL) ||
+       ((fileTally = (struct wordTally *)calloc(nFiles, sizeof(struct wordTally))) == NULL) ||
+       ((fileCompressed = (bool *)calloc(nFiles, sizeof(bool))) == NULL) ||
+       ((inflatedFiles = (struct inflatedFile *)calloc(nFiles, sizeof(struct inflatedFile))) == NULL) ||
+       ((chunksPending = (atomic_size_t *)malloc(nFiles * sizeof(atomic_size_t))) == NULL) ||
+       ((currFileWorker = (int *)malloc(nThreads * sizeof(int))) == NULL) ||
+       ((currChunkWorker = (size_t *)malloc(nThreads * sizeof(size_t))) == NULL) ||
+       ((windows = (struct fileWindow *)malloc(nThreads * sizeof(struct fileWindow))) == NULL)) {
         fprintf (stderr, "Error on allocating space to the data transfer region!\n");
         statusInitMon = EXIT_FAILURE;
         pthread_exit (&statusInitMon);
     }
+    chunkSummaries = NULL; // allocated once the file sizes are known
+    chunkStatistics = NULL;
+    chunkEdges = NULL;
+
     for(int i = 0; i < nFiles; i++) {
-        if((vowelCounts[i] = (unsigned int *)malloc(VOWELNUM * sizeof(unsigned int))) == NULL) {
-            fprintf (stderr, "Error on allocating space to the data transfer region!\n");
-            statusInitMon = EXIT_FAILURE;
-            pthread_exit(&statusInitMon);
+        atomic_init(&fileBuffer[i], 0); // file processing starts at the beginning of the file, or at its base offset
+        fileDesc[i] = -1; // files are only opened once one of their byte ranges is claimed
+        fileMap[i] = NULL;
+        fileSize[i] = 0;
+        atomic_init(&fileState[i], FILE_CLOSED);
+        atomic_init(&fileError[i], 0);
+        fileStart[i] = 0;
+        atomic_init(&chunksPending[i], 0);
+        vowelCounts[i] = counts + i * VOWELNUM; // rows of a single block
+        wordCount[i] = 0; // initialize word and vowel counts
+        for(int j = 0; j < VOWELNUM; j++) {
+            vowelCounts[i][j] = 0;
         }
     }
-    for(int i = 0; i < MAXFILECOUNT; i++) {
-        if((fileNames[i] = (char *)malloc((MAXFILENAMELEN+1) * sizeof(char))) == NULL) {
+    for(int i = 0; i < nThreads; i++) { // initialize pointers from workers to files and their (empty) windows
+        currFileWorker[i] = 0;
+        currChunkWorker[i] = 0;
+        windows[i].data = NULL;
+        windows[i].capacity = 0;
+        windows[i].file = -1;
+        windows[i].offset = 0;
+        windows[i].size = 0;
+    }
+    atomic_init(&currFile, 0); // processing starts with file with index 0
+    inflateTasks = NULL; // runs are added as the compressed files are stat'ed
+    nInflateTasks = inflateTasksCapacity = 0;
+    atomic_init(&nextInflateTask, 0);
+}
+
+/**
+ *  \brief Allocate the pipeline buffers, once the chunk size is fixed.
+ *
+ *  Internal monitor operation, carried out by the main thread once the files were stat'ed.
+ */
+static void initBuffers(void) { // every buffer starts free
+    size_t capacity = (textSize + BUFFERALIGN - 1) / BUFFERALIGN * BUFFERALIGN;
+    nBuffers = BUFFERSPERTHREAD * (nThreads + nReaders + nInflaters) + queueDepth * nReaders; // room for the reads in flight
+    if(((buffers = (struct chunkBuffer *)malloc(nBuffers * sizeof(struct chunkBuffer))) == NULL) ||
+       ((freeBuffers = (int *)malloc(nBuffers * sizeof(int))) == NULL) ||
+       ((fullBuffers = (int *)malloc(nBuffers * sizeof(int))) == NULL) ||
+       ((currBufferWorker = (int *)malloc(nThreads * sizeof(int))) == NULL)) {
+        fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+        statusMain = EXIT_FAILURE;
+        pthread_exit(&statusMain);
+    }
+    for(int i = 0; i < nBuffers; i++) {
+        if((buffers[i].data = (unsigned char *)aligned_alloc(BUFFERALIGN, capacity)) == NULL) {
             fprintf (stderr, "Error on allocating space to the data transfer region!\n");
-            statusInitMon = EXIT_FAILURE;
-            pthread_exit(&statusInitMon);
+            statusMain = EXIT_FAILURE;
+            pthread_exit(&statusMain);
         }
+        freeBuffers[i] = i;
+    }
+    nFreeBuffers = nBuffers;
+    fullHead = 0;
+    nFullBuffers = 0;
+    activeReaders = nReaders + nInflaters; // inflaters fill buffers as readers do
+    for(int i = 0; i < nThreads; i++) currBufferWorker[i] = -1;
+    pthread_cond_init(&bufferFreed, NULL);
+    pthread_cond_init(&bufferFilled, NULL);
+}
+
+/**
+ *  \brief Record the first failure on a file, reported with its counts.
+ *
+ *  Internal operation, carried out by any thread without entering the monitor.
+ *
+ *  \param idx index of the file
+ *  \param error errno of the failure
+ */
+static void failFile(int idx, int error) {
+    int none = 0;
+    atomic_compare_exchange_strong(&fileError[idx], &none, error);
+}
+
+/**
+ *  \brief Locate the chunks of a file: in the arrays of all files, or in those of its own if it is compressed.
+ *
+ *  Internal operation.
+ *
+ *  \param idx index of the file
+ *  \param summaries output variable, summaries of the chunks
+ *  \param stats output variable, letters and word lengths of the chunks (NULL if not gathered)
+ *  \param edges output variable, bytes around the words interned with the chunks (NULL if none), may be NULL
+ *  \return number of chunks of the file
+ */
+static size_t chunksOf(int idx, struct chunkSummary ** summaries, struct chunkStats ** stats, struct wordEdges ** edges) {
+    if(fileCompressed[idx]) {
+        *summaries = inflatedFiles[idx].summaries;
+        *stats = inflatedFiles[idx].statistics;
+        if(edges != NULL) *edges = inflatedFiles[idx].edges;
+        return inflatedFiles[idx].nChunks;
     }
+    size_t first = firstChunk[idx], nChunks = firstChunk[idx + 1] - firstChunk[idx];
+    *summaries = (nChunks > 0) ? &chunkSummaries[first] : NULL;
+    *stats = ((nChunks > 0) && (chunkStatistics != NULL)) ? &chunkStatistics[first] : NULL;
+    if(edges != NULL) *edges = ((nChunks > 0) && (chunkEdges != NULL)) ? &chunkEdges[first] : NULL;
+    return nChunks;
+}
 
-    for(int i = 0; i < nFiles; i++) {
-        fileBuffer[i] = 0; // all file processing starts at the beginning of the file
-        fileOver[i] = false; // initially, no files are processed
-        for(int j = 0; j < VOWELNUM; j++) { // initialize word and vowel counts
-            vowelCounts[i][j] = 0;
-            wordCount[j] = 0;
+/**
+ *  \brief Fold the summaries of the byte ranges of a file, in order, into its word and vowel counts and report them.
+ *
+ *  Internal monitor operation, carried out once all the file's byte ranges were summarized. The output is flushed,
+ *  so whoever reads it may start on the file while the others are still being processed.
+ *
+ *  \param idx index of the file
+ */
+static void finishFile(int idx) {
+    struct wordTally tally = fileTally[idx]; // zeroed, unless following the file from where the last run stopped
+    struct statsTally extra;
+    struct chunkSummary * summaries;
+    struct chunkStats * stats;
+    size_t nChunks = chunksOf(idx, &summaries, &stats, NULL);
+
+    memset(&extra, 0, sizeof(struct statsTally));
+    for(size_t c = 0; c < nChunks; c++) {
+        foldChunkStats(&tally, &extra, &summaries[c], (stats != NULL) ? &stats[c] : NULL, statistics);
+    }
+    if(followOn && (atomic_load(&fileState[idx]) != FILE_FAILED) && !fileCached[idx] && !fileCompressed[idx] &&
+       !followUpdate(fileNames[idx], (dev_t)fileKeys[idx].dev, (ino_t)fileKeys[idx].ino, fileSize[idx], &tally)) {
+        fprintf(stderr, "Error on allocating space to the follow state of %s.\n", fileNames[idx]);
+    }
+    finishTallyStats(&tally, &extra, statistics);
+    wordCount[idx] = tally.words;
+    for(int j = 0; j < VOWELNUM; j++) {
+        vowelCounts[idx][j] = tally.vowels[j];
+    }
+
+    if(atomic_load(&fileState[idx]) != FILE_FAILED) cacheStore(&fileKeys[idx], wordCount[idx], vowelCounts[idx]);
+
+    double seconds = (fileStart[idx] > 0) ? wallClock() - fileStart[idx] : 0; // empty files are never claimed
+    off_t size = fileCompressed[idx] ? inflatedFiles[idx].size : fileSize[idx]; // as a cache hit would report it
+    reportFileStats(outputFormat, fileNames[idx], (long long)size, seconds, wordCount[idx], vowelCounts[idx], extra.letters,
+                    extra.lengths, atomic_load(&fileError[idx]));
+}
+
+/**
+ *  \brief Hash a file's content for its cache entry, once it was counted, if hits are to be verified.
+ *
+ *  Internal operation, carried out outside of the monitor by the worker summarizing the file's last byte range (by
+ *  the main thread for empty files). A file which can not be hashed is stored unhashed, a miss on the next run.
+ *
+ *  \param idx index of the file
+ */
+static void hashFile(int idx) {
+    if(!cacheVerify || (atomic_load(&fileState[idx]) == FILE_FAILED)) return;
+    if(!cacheHashFile(fileNames[idx], &fileKeys[idx].hash)) fileKeys[idx].hash = 0;
+}
+
+/**
+ *  \brief Open a file until its last byte range is summarized, mapping it to memory in memory-mapped mode.
+ *
+ *  Internal operation, carried out by the first thread claiming one of the file's byte ranges.
+ *
+ *  \param idx index of the file to be opened
+ *  \return true on success, false otherwise
+ */
+static bool openFile(int idx) {
+    int fd;
+
+    if((fd = open(fileNames[idx], O_RDONLY)) == -1) return false;
+    if(!useMmap || fileCompressed[idx]) { // byte ranges are read (or inflated) with pread, keep the descriptor
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // ranges are claimed in order, let the kernel read ahead
+        fileDesc[idx] = fd;
+        return true;
+    }
+    if(fileSize[idx] > 0) { // empty files can not be mapped, they are simply left with no view
+        void * map = mmap(NULL, (size_t)fileSize[idx], PROT_READ, MAP_PRIVATE, fd, (off_t)0);
+        if(map == MAP_FAILED) {
+            close(fd);
+            return false;
         }
+        madvise(map, (size_t)fileSize[idx], MADV_SEQUENTIAL); // byte ranges are claimed in order, let the kernel read ahead
+        fileMap[idx] = (unsigned char *)map;
     }
-    for(int i = 0; i < nThreads; i++) { // initialize pointers from workers to files
-        currFileWorker[i] = 0;
+    close(fd); // the mapping holds its own reference to the file
+    return true;
+}
+
+/**
+ *  \brief Make sure a file is open before one of its byte ranges is read.
+ *
+ *  Internal operation, carried out by the workers or the readers without entering the monitor.
+ *  The first thread to claim one of the file's byte ranges opens it, the others wait for it to be done, so each file
+ *  is opened exactly once and only while it is being processed. A file which can not be opened is reported once.
+ *
+ *  \param idx index of the file
+ *  \return true if the file is open, false if it could not be opened
+ */
+static bool ensureOpen(int idx) {
+    int state = atomic_load(&fileState[idx]);
+
+    if((state == FILE_CLOSED) && atomic_compare_exchange_strong(&fileState[idx], &state, FILE_OPENING)) {
+        fileStart[idx] = wallClock(); // the file's processing time starts with its first claim
+        bool opened = openFile(idx);
+        if(!opened) {
+            failFile(idx, errno);
+            fprintf(stderr, "Error on opening file %s: %s\n", fileNames[idx], strerror(atomic_load(&fileError[idx])));
+        }
+        atomic_store(&fileState[idx], opened ? FILE_OPEN : FILE_FAILED);
+        return opened;
+    }
+    while((state = atomic_load(&fileState[idx])) == FILE_OPENING) sched_yield(); // another thread is opening it
+    return state == FILE_OPEN;
+}
+
+/**
+ *  \brief Close a file, or unmap it in memory-mapped mode, once its last byte range was summarized.
+ *
+ *  Internal operation, carried out by the worker summarizing the file's last byte range.
+ *
+ *  \param idx index of the file
+ */
+static void closeFile(int idx) {
+    if(atomic_load(&fileState[idx]) != FILE_OPEN) return;
+    if(fileDesc[idx] >= 0) close(fileDesc[idx]);
+    if(fileMap[idx] != NULL) munmap(fileMap[idx], (size_t)fileSize[idx]);
+    fileDesc[idx] = -1;
+    fileMap[idx] = NULL;
+}
+
+/**
+ *  \brief Read the bytes of a file in a given range.
+ *
+ *  Internal operation, carried out by the workers or the readers outside of any lock.
+ *
+ *  \param file index of the file
+ *  \param data output variable, bytes read
+ *  \param lo file offset of the first byte
+ *  \param hi file offset past the last byte
+ *  \return number of bytes read (less than asked for if the file shrank meanwhile), -1 on error
+ */
+static ssize_t readRange(int file, unsigned char * data, off_t lo, off_t hi) {
+    size_t bytesRead = 0;
+
+    while(bytesRead < (size_t)(hi - lo)) { // pread may return less than requested
+        ssize_t n = pread(fileDesc[file], data + bytesRead, (size_t)(hi - lo) - bytesRead, lo + (off_t)bytesRead);
+        if(n < 0) return -1;
+        if(n == 0) break; // file shrank meanwhile
+        bytesRead += n;
+    }
+    return bytesRead;
+}
+
+/**
+ *  \brief Make sure a worker's window holds the bytes of a file in a given range.
+ *
+ *  Internal operation, carried out by the workers outside of any lock.
+ *  The range is clamped to the file size. In memory-mapped mode the window is the whole mapping.
+ *
+ *  \param workerID worker identification
+ *  \param file index of the file
+ *  \param lo file offset of the first byte needed
+ *  \param hi file offset past the last byte needed
+ */
+static void loadWindow(unsigned int workerID, int file, off_t lo, off_t hi) {
+    struct fileWindow * w = &windows[workerID];
+
+    if(hi > fileSize[file]) hi = fileSize[file];
+    if((w->file == file) && (lo >= w->offset) && (hi <= w->offset + (off_t)w->size)) return; // already there
+
+    if(lo >= hi) { // nothing to read
+        w->file = -1;
+        w->offset = lo;
+        w->size = 0;
+        return;
+    }
+    if(useMmap) {
+        w->data = fileMap[file];
+        w->file = file;
+        w->offset = 0;
+        w->size = fileSize[file];
+        return;
+    }
+
+    if((size_t)(hi - lo) > w->capacity) {
+        unsigned char * data;
+        if((data = (unsigned char *)realloc(w->data, (size_t)(hi - lo))) == NULL) {
+            perror("Error on allocating memory for the file window.");
+            statusWorker[workerID] = EXIT_FAILURE;
+            pthread_exit(&statusWorker[workerID]);
+        }
+        w->data = data;
+        w->capacity = (size_t)(hi - lo);
+    }
+    ssize_t bytesRead = readRange(file, w->data, lo, hi);
+    if(bytesRead < 0) { // the range is left empty, the file is reported as cut short
+        failFile(file, errno);
+        fprintf(stderr, "Error on reading file %s: %s\n", fileNames[file], strerror(atomic_load(&fileError[file])));
+        bytesRead = 0;
+    }
+    w->file = file;
+    w->offset = lo;
+    w->size = bytesRead;
+}
+
+/** \brief seed the task deques of the stealing scheduler */
+static void seedTasks(void);
+
+/**
+ *  \brief Add the runs of members of a compressed file to those the inflaters take.
+ *
+ *  Internal monitor operation, carried out by the main thread as the files are stat'ed. A file which can not be
+ *  opened is a single run, left to fail when an inflater opens it.
+ *
+ *  \param idx index of the file
+ *  \param size size of the file, in bytes
+ */
+static void addInflateTasks(int idx, off_t size) {
+    struct gzipRun * runs = NULL;
+    int fd, n = -1;
+
+    if((fd = open(fileNames[idx], O_RDONLY)) != -1) {
+        n = gzipRuns(fd, size, INFLATERUNSIZE, &runs);
+        close(fd);
+    }
+    else if((runs = (struct gzipRun *)malloc(sizeof(struct gzipRun))) != NULL) { // members are never found
+        runs[0].lo = runs[0].hi = 0;
+        runs[0].size = -1;
+        n = 1;
+    }
+    if(nInflateTasks + n > inflateTasksCapacity) { // grow the table geometrically
+        int capacity = (inflateTasksCapacity > 0) ? inflateTasksCapacity : DEQUECAPACITY;
+        while(capacity < nInflateTasks + n) capacity *= 2;
+        struct inflateTask * tasks = (struct inflateTask *)realloc(inflateTasks, capacity * sizeof(struct inflateTask));
+        if(tasks != NULL) {
+            inflateTasks = tasks;
+            inflateTasksCapacity = capacity;
+        }
+        else n = -1;
+    }
+    if(n < 0) {
+        fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+        statusMain = EXIT_FAILURE;
+        pthread_exit(&statusMain);
+    }
+    for(int r = 0; r < n; r++) {
+        struct inflateTask task = {idx, runs[r], 0, 0};
+        inflateTasks[nInflateTasks++] = task;
+    }
+    inflatedFiles[idx].size = size;
+    inflatedFiles[idx].runsLeft = n;
+    inflatedFiles[idx].sized = (runs[0].size >= 0);
+    free(runs);
+}
+
+/**
+ *  \brief Lay out the chunks of the compressed files, once the chunk size is fixed.
+ *
+ *  Internal monitor operation, carried out by the main thread. The runs of a sized file are cut into chunks of their
+ *  own, so each inflater knows where its chunks go; the arrays of the others are grown as they are inflated.
+ */
+static void layOutInflated(void) {
+    for(int t = 0; t < nInflateTasks; t++) {
+        struct inflatedFile * f = &inflatedFiles[inflateTasks[t].file];
+        if(!f->sized) continue;
+        inflateTasks[t].firstChunk = f->nChunks;
+        inflateTasks[t].nChunks = (inflateTasks[t].run.size + textSize - 1) / textSize;
+        f->nChunks += inflateTasks[t].nChunks;
+    }
+    for(int i = 0; i < nFiles; i++) {
+        struct inflatedFile * f = &inflatedFiles[i];
+        if(!fileCompressed[i]) continue;
+        f->capacity = f->sized ? f->nChunks + 1 : INFLATEDCHUNKS; // never empty
+        if(((f->summaries = (struct chunkSummary *)malloc(f->capacity * sizeof(struct chunkSummary))) == NULL) ||
+           ((statistics != STAT_VOWELS) &&
+            ((f->statistics = (struct chunkStats *)malloc(f->capacity * sizeof(struct chunkStats))) == NULL)) ||
+           ((topWords > 0) && ((f->edges = (struct wordEdges *)malloc(f->capacity * sizeof(struct wordEdges))) == NULL))) {
+            fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+            statusMain = EXIT_FAILURE;
+            pthread_exit(&statusMain);
+        }
     }
-    currFile = 0; // processing starts with file with index 0
-    workFinished = false;
 }
 
 /**
  * @brief Store file names in the data transfer region.
  * 
  * Operation carried out by the main thread after processing user input.
+ * Files are stat'ed and their summaries laid out; files found in the result cache and files with no bytes are
+ * reported right away, the others are left to the workers (compressed files to the inflaters).
  * 
  * @param names array of file names to be stored
  */
 void storeFileNames(char ** names) {
-    statusMain = pthread_mutex_lock(&accessCR);
+    statusMain = monitorLock("storeFileNames", &accessCR);
     if(statusMain) {
         errno = statusMain;
         perror("Error on main thread entering monitor (CF).");
@@ -144,7 +787,62 @@ void storeFileNames(char ** names) {
 
     fileNames = names;
 
-    statusMain = pthread_mutex_unlock(&accessCR);
+    // stat every file once, files are then only opened while their byte ranges are being processed
+    off_t totalSize = 0;
+    for(int i = 0; i < nFiles; i++) {
+        struct stat st;
+        if(stat(fileNames[i], &st) == -1) { // files which can not be stat'ed are left empty
+            failFile(i, errno);
+            fprintf(stderr, "Error on opening file %s: %s\n", fileNames[i], strerror(atomic_load(&fileError[i])));
+            atomic_store(&fileState[i], FILE_FAILED);
+            statusMain = EXIT_FAILURE;
+        }
+        else {
+            cacheKeyOf(&st, &fileKeys[i]);
+            if(cacheLookup(fileNames[i], &fileKeys[i], &wordCount[i], vowelCounts[i])) { // unchanged, never claimed
+                fileCached[i] = true;
+                reportFile(outputFormat, fileNames[i], (long long)st.st_size, 0, wordCount[i], vowelCounts[i], 0);
+            }
+            else if((nInflaters > 0) && gzipIsCompressed(fileNames[i])) { // never claimed, its size is only known inflated
+                fileCompressed[i] = true;
+                addInflateTasks(i, st.st_size);
+            }
+            else {
+                fileSize[i] = st.st_size;
+                followLookup(fileNames[i], &st, &fileBase[i], &fileTally[i]); // only the bytes appended are counted
+                atomic_store(&fileBuffer[i], fileBase[i]);
+            }
+        }
+        totalSize += fileSize[i] - fileBase[i];
+    }
+    while((textSize < CHUNKSIZE_MAX) && (totalSize / textSize > MAXCHUNKS)) textSize *= 2; // bound the summaries kept
+    if((nReaders > 0) || (nInflaters > 0)) initBuffers();
+    layOutInflated();
+
+    firstChunk[0] = 0;
+    for(int i = 0; i < nFiles; i++) {
+        size_t nChunks = (fileSize[i] - fileBase[i] + textSize - 1) / textSize;
+        atomic_store(&chunksPending[i], nChunks);
+        firstChunk[i + 1] = firstChunk[i] + nChunks;
+    }
+    if((firstChunk[nFiles] > 0) &&
+       (((chunkSummaries = (struct chunkSummary *)malloc(firstChunk[nFiles] * sizeof(struct chunkSummary))) == NULL) ||
+        ((statistics != STAT_VOWELS) &&
+         ((chunkStatistics = (struct chunkStats *)malloc(firstChunk[nFiles] * sizeof(struct chunkStats))) == NULL)) ||
+        ((topWords > 0) && ((chunkEdges = (struct wordEdges *)malloc(firstChunk[nFiles] * sizeof(struct wordEdges))) == NULL)))) {
+        fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+        statusMain = EXIT_FAILURE;
+        pthread_exit(&statusMain);
+    }
+    for(int i = 0; i < nFiles; i++) {
+        if((firstChunk[i + 1] == firstChunk[i]) && !fileCached[i] && !fileCompressed[i]) { // empty files are done already
+            hashFile(i);
+            finishFile(i);
+        }
+    }
+    if(useStealing) seedTasks();
+
+    statusMain = monitorUnlock("storeFileNames", &accessCR);
     if(statusMain) {
         errno = statusMain;
         perror("Error on main thread exiting monitor (CF).");
@@ -153,176 +851,827 @@ void storeFileNames(char ** names) {
 }
 
 /**
- * @brief Retrieve a chunk of file text.
- * 
- * Operation carried out by the workers.
- * 
- * @param workerID worker identification
- * @param chunk output variable, stores the text chunk from the file
- * @param chunkSize output variable, stores the size, in bytes, of the text chunk
- * @return true : the worker's work is finished signaling it should quit 
- * @return false : the worker should continue it's life cycle
+ * @brief Tell if a file could not be counted in full.
+ *
+ * Operation carried out by the main thread once the workers, readers and inflaters are done.
+ *
+ * @return true if a file could not be opened, read or inflated, false otherwise
+ */
+bool filesFailed(void) {
+    for(int i = 0; i < nFiles; i++) {
+        if(atomic_load(&fileError[i]) != 0) return true;
+    }
+    return false;
+}
+
+/**
+ *  \brief Push a task at the bottom of a deque.
+ *
+ *  Internal operation, the deque's lock must be held (or the deque not shared yet).
+ *
+ *  \param deque task deque
+ *  \param task task to push
+ *  \return true on success, false if the deque could not grow
  */
-bool readFromFile(unsigned int workerID, unsigned char * chunk, int * chunkSize) { // worker
-    statusWorker[workerID] = pthread_mutex_lock(&accessCR);
+static bool pushTask(struct taskDeque * deque, struct chunkTask task) {
+    if(deque->count == deque->capacity) { // grow the ring, unwrapping it
+        struct chunkTask * tasks;
+        if((tasks = (struct chunkTask *)malloc(2 * deque->capacity * sizeof(struct chunkTask))) == NULL) return false;
+        for(int i = 0; i < deque->count; i++) tasks[i] = deque->tasks[(deque->top + i) % deque->capacity];
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity *= 2;
+        deque->top = 0;
+    }
+    deque->tasks[(deque->top + deque->count) % deque->capacity] = task;
+    deque->count++;
+    return true;
+}
+
+/**
+ *  \brief Seed the task deques from all files at once.
+ *
+ *  Internal monitor operation, carried out by the main thread once the files are open.
+ *  Each file larger than a chunk is a task of its own, runs of smaller files are batched into tasks of about a chunk.
+ *  Tasks are dealt to the deques in turn.
+ */
+static void seedTasks(void) {
+    nDeques = (nReaders > 0) ? nReaders : nThreads;
+    if((deques = (struct taskDeque *)aligned_alloc(CACHELINE, nDeques * sizeof(struct taskDeque))) == NULL) {
+        fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+        statusMain = EXIT_FAILURE;
+        pthread_exit(&statusMain);
+    }
+    for(int d = 0; d < nDeques; d++) {
+        pthread_mutex_init(&deques[d].lock, NULL);
+        deques[d].capacity = DEQUECAPACITY;
+        deques[d].top = 0;
+        deques[d].count = 0;
+        if((deques[d].tasks = (struct chunkTask *)malloc(DEQUECAPACITY * sizeof(struct chunkTask))) == NULL) {
+            fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+            statusMain = EXIT_FAILURE;
+            pthread_exit(&statusMain);
+        }
+    }
+
+    long chunks = 0;
+    int next = 0;
+    size_t batchSize = 0;
+    struct chunkTask batch = {-1, -1, 0, 1};
+    for(int i = 0; i <= nFiles; i++) {
+        off_t length = (i < nFiles) ? fileSize[i] - fileBase[i] : 0;
+        bool small = (i < nFiles) && (length <= textSize);
+        if((batch.firstFile >= 0) && (!small || (batchSize + length > textSize))) { // close the batch
+            if(!pushTask(&deques[next], batch)) {
+                fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+                statusMain = EXIT_FAILURE;
+                pthread_exit(&statusMain);
+            }
+            next = (next + 1) % nDeques;
+            batch.firstFile = -1;
+            batchSize = 0;
+        }
+        if((i == nFiles) || (length == 0)) continue; // empty files have no chunks
+        if(small) { // join the batch of small files
+            if(batch.firstFile < 0) batch.firstFile = i;
+            batch.lastFile = i;
+            batchSize += length;
+            chunks++;
+            continue;
+        }
+        struct chunkTask task = {i, i, 0, (length + textSize - 1) / textSize};
+        if(!pushTask(&deques[next], task)) {
+            fprintf (stderr, "Error on allocating space to the data transfer region!\n");
+            statusMain = EXIT_FAILURE;
+            pthread_exit(&statusMain);
+        }
+        next = (next + 1) % nDeques;
+        chunks += task.hi;
+    }
+    atomic_init(&chunksLeft, chunks);
+}
+
+/**
+ *  \brief Take a task from a deque: from the bottom if it is the thread's own, from the top otherwise.
+ *
+ *  Internal operation, carried out by the threads claiming byte ranges.
+ *
+ *  \param deque task deque
+ *  \param own true if the deque belongs to the calling thread
+ *  \param task output variable, task taken
+ *  \param status return status of the calling thread
+ *  \return true if a task was taken, false if the deque is empty
+ */
+static bool takeTask(struct taskDeque * deque, bool own, struct chunkTask * task, int * status) {
+    bool taken = false;
+
+    if((*status = monitorLock("claimTask", &deque->lock)) != 0) {
+        errno = *status;
+        perror("Error on locking task deque.");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+    if(deque->count > 0) {
+        if(own) *task = deque->tasks[(deque->top + deque->count - 1) % deque->capacity];
+        else {
+            *task = deque->tasks[deque->top];
+            deque->top = (deque->top + 1) % deque->capacity;
+        }
+        deque->count--;
+        taken = true;
+    }
+    if((*status = monitorUnlock("claimTask", &deque->lock)) != 0) {
+        errno = *status;
+        perror("Error on unlocking task deque.");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+    return taken;
+}
+
+/**
+ *  \brief Claim the next chunk with the stealing scheduler.
+ *
+ *  Internal operation, carried out by the workers or the readers.
+ *  A task is taken from the thread's own deque, or stolen from the others. It is split lazily: the second half of a
+ *  run of chunks, or the files of a batch but the first, go back to the bottom of the thread's deque, until a single
+ *  chunk is left. Threads only quit once every chunk was claimed, since a thread splitting a task may still push
+ *  work to steal.
+ *
+ *  \param claimerID identification of the calling thread
+ *  \param file output variable, index of the file
+ *  \param start output variable, file offset of the first byte of the chunk
+ *  \param end output variable, file offset past the last byte of the chunk
+ *  \return true if a chunk was claimed, false if every chunk was
+ */
+static bool claimTask(unsigned int claimerID, int * file, off_t * start, off_t * end) {
+    int * status = (nReaders > 0) ? &statusReader[claimerID] : &statusWorker[claimerID];
+    struct taskDeque * own = &deques[claimerID];
+    struct chunkTask task;
+
+    while(true) {
+        if(takeTask(own, true, &task, status)) break;
+        bool stolen = false;
+        for(int v = 1; !stolen && (v < nDeques); v++) { // steal from the others, starting with the next thread
+            stolen = takeTask(&deques[(claimerID + v) % nDeques], false, &task, status);
+        }
+        if(stolen) break;
+        if(atomic_load(&chunksLeft) == 0) return false;
+        sched_yield(); // chunks are still being split, try again
+    }
+
+    if((*status = monitorLock("claimTask", &own->lock)) != 0) {
+        errno = *status;
+        perror("Error on locking task deque.");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+    bool pushed = true;
+    if(task.firstFile != task.lastFile) { // batch: keep the first file, give back the others
+        struct chunkTask rest = {task.firstFile + 1, task.lastFile, 0, 1};
+        while((rest.firstFile <= rest.lastFile) && (fileSize[rest.firstFile] == fileBase[rest.firstFile])) rest.firstFile++; // no chunks
+        if(rest.firstFile <= rest.lastFile) pushed = pushTask(own, rest);
+        task.lastFile = task.firstFile;
+    }
+    while(pushed && (task.hi - task.lo > 1)) { // run of chunks: give back the second half, until one chunk is left
+        struct chunkTask half = {task.firstFile, task.lastFile, task.lo + (task.hi - task.lo) / 2, task.hi};
+        pushed = pushTask(own, half);
+        task.hi = half.lo;
+    }
+    if((*status = monitorUnlock("claimTask", &own->lock)) != 0) {
+        errno = *status;
+        perror("Error on unlocking task deque.");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+    if(!pushed) {
+        perror("Error on allocating memory for the task deque.");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    atomic_fetch_sub(&chunksLeft, 1);
+    *file = task.firstFile;
+    *start = fileBase[*file] + (off_t)task.lo * textSize;
+    *end = (*start + textSize < fileSize[*file]) ? *start + textSize : fileSize[*file];
+    if(!ensureOpen(*file)) *end = *start; // left empty, its summary is still stored
+    return true;
+}
+
+/**
+ *  \brief Claim the next byte range of the files.
+ *
+ *  Internal operation, carried out by the workers or the readers without entering the monitor.
+ *  A byte range of the current file is claimed with an atomic fetch-add on its offset, the current file is advanced
+ *  atomically once its bytes are all claimed, so files are done, and reported, in the order they were given. With the
+ *  stealing scheduler, files are all claimed at once instead. The file is opened by the first thread claiming one of
+ *  its ranges.
+ *
+ *  \param claimerID identification of the calling thread (worker, or reader in pipeline mode)
+ *  \param file output variable, index of the file
+ *  \param start output variable, file offset of the first byte of the range
+ *  \param end output variable, file offset past the last byte of the range
+ *  \return true if a range was claimed, false if the files were all claimed
+ */
+static bool claimRange(unsigned int claimerID, int * file, off_t * start, off_t * end) {
+    if(useStealing) return claimTask(claimerID, file, start, end);
+    while(true) {
+        *file = atomic_load(&currFile);
+        if(*file >= nFiles) return false;
+        *start = atomic_fetch_add(&fileBuffer[*file], textSize);
+        if(*start < fileSize[*file]) break;
+        atomic_compare_exchange_strong(&currFile, file, *file + 1); // file is fully claimed, move on to next file
+    }
+    *end = (*start + textSize < fileSize[*file]) ? *start + textSize : fileSize[*file];
+    if(!ensureOpen(*file)) *end = *start; // left empty, its summary is still stored
+    return true;
+}
+
+/**
+ *  \brief Hand a filled buffer to a worker, taking back the one it processed before.
+ *
+ *  Internal monitor operation, carried out by the workers in pipeline mode.
+ *
+ *  \param workerID worker identification
+ *  \param chunk output variable, points to the text chunk
+ *  \param chunkSize output variable, stores the size, in bytes, of the text chunk
+ *  \return true if the readers are done and every buffer was processed, false otherwise
+ */
+static bool popBuffer(unsigned int workerID, unsigned char ** chunk, int * chunkSize) {
+    statusWorker[workerID] = monitorLock("readFromFile", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
-        perror("Error on entering monitor (CF).");
+        perror("Error on worker thread entering monitor (CF).");
         statusWorker[workerID] = EXIT_FAILURE;
         pthread_exit(&statusWorker[workerID]);
     }
 
-    if(workFinished) { // files were all processed, move on and die
-        statusWorker[workerID] = pthread_mutex_unlock(&accessCR); // leave monitor
-        if(statusWorker[workerID]) {
+    if(currBufferWorker[workerID] >= 0) { // give back the buffer processed before
+        freeBuffers[nFreeBuffers++] = currBufferWorker[workerID];
+        currBufferWorker[workerID] = -1;
+        if((statusWorker[workerID] = pthread_cond_signal(&bufferFreed)) != 0) {
             errno = statusWorker[workerID];
-            perror("Error on leaving monitor (CF).");
+            perror("Error on signal in bufferFreed");
             statusWorker[workerID] = EXIT_FAILURE;
             pthread_exit(&statusWorker[workerID]);
         }
-        return true;
-    } 
+    }
 
-    // store worker's current file
-    currFileWorker[workerID] = currFile;
-    int currFileInit = currFile;
+    while((nFullBuffers == 0) && (activeReaders > 0)) { // wait for a reader to fill a buffer
+        if((statusWorker[workerID] = monitorWait("readFromFile", &bufferFilled, &accessCR)) != 0) {
+            errno = statusWorker[workerID];
+            perror("Error on waiting in bufferFilled");
+            statusWorker[workerID] = EXIT_FAILURE;
+            pthread_exit(&statusWorker[workerID]);
+        }
+    }
 
-    // open file
-    FILE * fp = fopen(fileNames[currFile], "r");
+    bool done = (nFullBuffers == 0);
+    if(!done) { // take the oldest filled buffer
+        int idx = fullBuffers[fullHead];
+        fullHead = (fullHead + 1) % nBuffers;
+        nFullBuffers--;
+        currBufferWorker[workerID] = idx;
+        currFileWorker[workerID] = buffers[idx].file;
+        currChunkWorker[workerID] = buffers[idx].chunk;
+        *chunk = buffers[idx].data;
+        *chunkSize = buffers[idx].size;
+    }
 
-    // skip content already processed
-    if((statusWorker[workerID] = fseek(fp, fileBuffer[currFile], SEEK_SET)) != 0) {
-        fclose(fp);
+    statusWorker[workerID] = monitorUnlock("readFromFile", &accessCR);
+    if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
-        perror("Error repositioning file buffer.");
+        perror("Error on worker thread exiting monitor (CF).");
         statusWorker[workerID] = EXIT_FAILURE;
         pthread_exit(&statusWorker[workerID]);
     }
 
-    // read chunk of text
-    size_t bytesRead = fread(chunk, 1, MAXTEXTSIZE, fp);
+    return done;
+}
+
+/**
+ *  \brief Double the room of the arrays of a compressed file of unknown size.
+ *
+ *  Internal monitor operation, carried out by the inflaters.
+ *
+ *  \param f chunks of the file
+ *  \return true on success, false if memory runs out
+ */
+static bool growInflated(struct inflatedFile * f) {
+    size_t capacity = 2 * f->capacity;
+    void * grown;
+
+    if((grown = realloc(f->summaries, capacity * sizeof(struct chunkSummary))) == NULL) return false;
+    f->summaries = (struct chunkSummary *)grown;
+    if(f->statistics != NULL) {
+        if((grown = realloc(f->statistics, capacity * sizeof(struct chunkStats))) == NULL) return false;
+        f->statistics = (struct chunkStats *)grown;
+    }
+    if(f->edges != NULL) {
+        if((grown = realloc(f->edges, capacity * sizeof(struct wordEdges))) == NULL) return false;
+        f->edges = (struct wordEdges *)grown;
+    }
+    f->capacity = capacity;
+    return true;
+}
+
+/**
+ *  \brief Take a buffer to fill.
+ *
+ *  Internal monitor operation, carried out by the readers in pipeline mode, and by the inflaters.
+ *
+ *  \param status return status of the calling thread
+ *  \param wait true to wait for a worker to give back a buffer if none is free
+ *  \return index of the buffer, -1 if none is free and not waiting
+ */
+static int takeFreeBuffer(int * status, bool wait) {
+    int idx = -1;
 
-    // verify if text contains only full words
-    if(bytesRead < MAXTEXTSIZE) { // read captured the file until its end, so nothing was cut
-        fileOver[currFile] = true;
-        fileBuffer[currFile] += bytesRead;
-        *chunkSize = bytesRead;
+    *status = monitorLock("fillBuffer", &accessCR);
+    if(*status) {
+        errno = *status;
+        perror("Error on thread entering monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
     }
-    else { // check if word/letter was cut in half
-        // look forward, is it a separator character?
-        unsigned char letter[4];
-        fread(letter, 1, 4, fp);
-        bool somethingCut = true;
-        if((letter[0] & 0xC0) != 0x80) { // it's the start of an ASCII char, we didn't cut a character in half
-            int size = getLetterSize(letter[0]);
-            somethingCut = !isSeparator(letter, size); // but is it a separator? if not we might've cut a word in half
+
+    while(wait && (nFreeBuffers == 0)) { // wait for a worker to give back a buffer
+        if((*status = monitorWait("fillBuffer", &bufferFreed, &accessCR)) != 0) {
+            errno = *status;
+            perror("Error on waiting in bufferFreed");
+            *status = EXIT_FAILURE;
+            pthread_exit(status);
         }
-        if(somethingCut) { // we cut something, time to uncut it (find the first separator inside the captured text chunk)
-            int actualBytesRead;
-            for(actualBytesRead = (int)bytesRead; actualBytesRead >= 0; actualBytesRead--) { // walking backwards
-                if((chunk[actualBytesRead] & 0xC0) == 0x80) continue; // not the start of a letter, continue
-                else {
-                    int size = getLetterSize(chunk[actualBytesRead]);
-                    for(int i = 0; i < size; i++) letter[i] = chunk[actualBytesRead + i]; 
-                    int isSep = isSeparator(letter, size);
-                    if(isSep) break; // found a separator, cut text chunk here
-                }
+    }
+    if(nFreeBuffers > 0) idx = freeBuffers[--nFreeBuffers];
+
+    *status = monitorUnlock("fillBuffer", &accessCR);
+    if(*status) {
+        errno = *status;
+        perror("Error on thread exiting monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    return idx;
+}
+
+/**
+ *  \brief Hand a filled buffer to the workers.
+ *
+ *  Internal monitor operation, carried out by the readers in pipeline mode, and by the inflaters.
+ *  Chunks of a compressed file of unknown size are counted as they are handed out, its arrays grown to hold them.
+ *
+ *  \param status return status of the calling thread
+ *  \param idx index of the buffer
+ */
+static void pushFullBuffer(int * status, int idx) {
+    *status = monitorLock("fillBuffer", &accessCR);
+    if(*status) {
+        errno = *status;
+        perror("Error on thread entering monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    int file = buffers[idx].file;
+    struct inflatedFile * f = &inflatedFiles[file];
+    if(fileCompressed[file] && !f->sized && (f->nChunks++ == f->capacity) && !growInflated(f)) {
+        fprintf(stderr, "Error on allocating space to the chunks of %s.\n", fileNames[file]);
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+    fullBuffers[(fullHead + nFullBuffers) % nBuffers] = idx;
+    nFullBuffers++;
+    if((*status = pthread_cond_signal(&bufferFilled)) != 0) {
+        errno = *status;
+        perror("Error on signal in bufferFilled");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    *status = monitorUnlock("fillBuffer", &accessCR);
+    if(*status) {
+        errno = *status;
+        perror("Error on thread exiting monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+}
+
+/**
+ *  \brief Signal a reader has no more buffers to fill, the last one wakes up the workers waiting for buffers.
+ *
+ *  Internal monitor operation, carried out by the readers in pipeline mode, and by the inflaters.
+ *
+ *  \param status return status of the calling thread
+ */
+static void quitReading(int * status) {
+    *status = monitorLock("fillBuffer", &accessCR);
+    if(*status) {
+        errno = *status;
+        perror("Error on thread entering monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    activeReaders--;
+    if((activeReaders == 0) && ((*status = pthread_cond_broadcast(&bufferFilled)) != 0)) {
+        errno = *status;
+        perror("Error on broadcasting bufferFilled");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    *status = monitorUnlock("fillBuffer", &accessCR);
+    if(*status) {
+        errno = *status;
+        perror("Error on thread exiting monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+}
+
+/**
+ *  \brief Read synchronously the part of a buffer's byte range not read yet.
+ *
+ *  Internal operation, carried out by the readers outside of any lock.
+ *  A failed read is reported, the buffer then keeps the bytes read so far so the workers do not wait for it forever.
+ *
+ *  \param readerID reader identification
+ *  \param idx index of the buffer, whose file, chunk and size (bytes asked for) are set
+ *  \param done number of bytes of the range already read
+ */
+static void finishBuffer(unsigned int readerID, int idx, int done) {
+    off_t start = fileBase[buffers[idx].file] + (off_t)buffers[idx].chunk * textSize;
+    ssize_t bytesRead = 0;
+
+    if(done < buffers[idx].size) {
+        bytesRead = readRange(buffers[idx].file, buffers[idx].data + done, start + done, start + buffers[idx].size);
+        if(bytesRead < 0) {
+            int file = buffers[idx].file;
+            failFile(file, errno);
+            fprintf(stderr, "Error on reading file %s: %s\n", fileNames[file], strerror(atomic_load(&fileError[file])));
+            statusReader[readerID] = EXIT_FAILURE;
+            bytesRead = 0;
+        }
+    }
+    buffers[idx].size = done + bytesRead;
+}
+
+/**
+ * @brief Read the next byte range of the files into a free buffer.
+ * 
+ * Operation carried out by the readers in pipeline mode.
+ * 
+ * The range is claimed as the workers would, a free buffer is taken inside the monitor (waiting for one if need
+ * be), filled outside of it and handed to the workers. The kernel is told to fetch the ranges to be claimed next.
+ * 
+ * @param readerID reader identification
+ * @return true : the files were all read, signaling the reader should quit
+ * @return false : the reader should continue it's life cycle
+ */
+bool fillBuffer(unsigned int readerID) {
+    int file, idx;
+    off_t start, end;
+
+    if(!claimRange(readerID, &file, &start, &end)) {
+        quitReading(&statusReader[readerID]);
+        return true;
+    }
+    idx = takeFreeBuffer(&statusReader[readerID], true);
+
+    // read the range outside of the monitor, while the kernel fetches the next ones
+    posix_fadvise(fileDesc[file], end, (off_t)textSize * nReaders, POSIX_FADV_WILLNEED);
+    buffers[idx].file = file;
+    buffers[idx].chunk = (start - fileBase[file]) / textSize;
+    buffers[idx].size = end - start;
+    double since = traceNow();
+    finishBuffer(readerID, idx, 0);
+    traceSpan("read", "io", since);
+
+    pushFullBuffer(&statusReader[readerID], idx);
+    return false;
+}
+
+/**
+ * @brief Read all the byte ranges left with io_uring, keeping several reads in flight, until the files were all read.
+ * 
+ * Operation carried out by the readers in io_uring mode.
+ * 
+ * Ranges are claimed as the workers would and read into free buffers, with up to queueDepth reads in flight; each
+ * completed read is handed to the workers right away. Falls back to fillBuffer if io_uring is not available, and to
+ * synchronous reads for the rest of a range the kernel could not read.
+ * 
+ * @param readerID reader identification
+ */
+void fillBuffersAsync(unsigned int readerID) {
+    struct uring ring;
+    int * inFlight;
+    int nInFlight = 0;
+
+    if(!uringInit(&ring, queueDepth) || ((inFlight = (int *)malloc(queueDepth * sizeof(int))) == NULL)) {
+        perror("io_uring is not available, reading synchronously");
+        uringExit(&ring);
+        while(!fillBuffer(readerID));
+        return;
+    }
+
+    int file;
+    off_t start, end;
+    bool claimed = false, allClaimed = false;
+    while(true) {
+        while(!allClaimed && (nInFlight < queueDepth)) { // queue reads while there are buffers to fill
+            if(!claimed && !(claimed = claimRange(readerID, &file, &start, &end))) {
+                allClaimed = true;
+                break;
+            }
+            int idx = takeFreeBuffer(&statusReader[readerID], nInFlight == 0); // only wait if no read may complete meanwhile
+            if(idx < 0) break;
+            buffers[idx].file = file;
+            buffers[idx].chunk = (start - fileBase[file]) / textSize;
+            buffers[idx].size = end - start;
+            uringQueueRead(&ring, fileDesc[file], buffers[idx].data, end - start, start, idx); // never full, as deep as inFlight
+            inFlight[nInFlight++] = idx;
+            claimed = false;
+        }
+        if(nInFlight == 0) break; // files were all read
+
+        double since = traceNow();
+        bool submitted = uringSubmit(&ring, 1);
+        traceSpan("read (io_uring)", "io", since);
+        if(!submitted) { // read the buffers in flight synchronously, then go on without io_uring
+            perror("Error on submitting reads to io_uring, reading synchronously");
+            uringExit(&ring);
+            for(int i = 0; i < nInFlight; i++) {
+                finishBuffer(readerID, inFlight[i], 0);
+                pushFullBuffer(&statusReader[readerID], inFlight[i]);
             }
-            // update variables for progress tracking
-            fileBuffer[currFile] += actualBytesRead;
-            *chunkSize = actualBytesRead;
+            free(inFlight);
+            while(!fillBuffer(readerID));
+            return;
         }
-        else { // nothing was cut, update variables for progress tracking
-            fileBuffer[currFile] += bytesRead;
-            *chunkSize = bytesRead;
+
+        unsigned long long tag;
+        int result;
+        while(uringReap(&ring, &tag, &result)) { // hand completed reads to the workers
+            int idx = (int)tag;
+            finishBuffer(readerID, idx, (result > 0) ? result : 0); // short or failed reads are finished with pread
+            pushFullBuffer(&statusReader[readerID], idx);
+            for(int i = 0; i < nInFlight; i++) {
+                if(inFlight[i] == idx) {
+                    inFlight[i] = inFlight[--nInFlight];
+                    break;
+                }
+            }
         }
     }
 
-    if(fileOver[currFile]) { // if this file ended, move on to next file
-        currFile++;
-        if(currFile >= nFiles) { // no more files to process, work is done
-            workFinished = true;    
-        } 
+    uringExit(&ring);
+    free(inFlight);
+    quitReading(&statusReader[readerID]);
+}
+
+/**
+ *  \brief Signal a run of members of a compressed file was inflated.
+ *
+ *  Internal monitor operation, carried out by the inflaters.
+ *
+ *  \param status return status of the calling thread
+ *  \param file index of the file
+ *  \return true if the file is done, its chunks all inflated and summarized, false otherwise
+ */
+static bool endInflating(int * status, int file) {
+    struct inflatedFile * f = &inflatedFiles[file];
+
+    if((*status = monitorLock("inflateRun", &accessCR)) != 0) {
+        errno = *status;
+        perror("Error on inflater thread entering monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+
+    f->runsLeft--;
+    bool done = (f->runsLeft == 0) && (f->stored == f->nChunks);
+
+    if((*status = monitorUnlock("inflateRun", &accessCR)) != 0) {
+        errno = *status;
+        perror("Error on inflater thread exiting monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
     }
+    return done;
+}
 
-    fclose(fp);
+/** \brief fold the summaries of a file once they were all stored */
+static void completeFile(int file, int tableID, int * status);
 
-    statusWorker[workerID] = pthread_mutex_unlock(&accessCR);
-    if(statusWorker[workerID]) {
-        // undo changes
-        currFile = currFileInit;
-        workFinished = false;
-        fileBuffer[currFile] -= bytesRead;
-        fileOver[currFile] = false;
-        errno = statusWorker[workerID];
-        perror("Error on leaving monitor (CF).");
-        statusWorker[workerID] = EXIT_FAILURE;
-        pthread_exit(&statusWorker[workerID]);
+/**
+ * @brief Inflate the next run of members of the compressed files into free buffers.
+ * 
+ * Operation carried out by the inflaters.
+ * 
+ * Runs are taken in order with an atomic fetch-add. Each chunk is inflated straight into a free buffer, taken
+ * inside the monitor (waiting for one if need be), and handed to the workers as a reader's. A run of known size is
+ * cut into the chunks laid out for it, those past an inflation error left empty; a run of unknown size ends with its
+ * first short chunk. The inflater ending the last run of a file whose chunks were all summarized folds it.
+ * 
+ * @param inflaterID inflater identification
+ * @return true : the runs were all inflated, signaling the inflater should quit
+ * @return false : the inflater should continue it's life cycle
+ */
+bool inflateRun(unsigned int inflaterID) {
+    int * status = &statusInflater[inflaterID];
+    int t = atomic_fetch_add(&nextInflateTask, 1);
+
+    if(t >= nInflateTasks) {
+        quitReading(status);
+        return true;
+    }
+    const struct inflateTask * task = &inflateTasks[t];
+    int file = task->file;
+    bool sized = (task->run.size >= 0);
+    long long left = task->run.size;
+    struct gzipStream stream;
+
+    memset(&stream, 0, sizeof(struct gzipStream));
+    bool open = ensureOpen(file);
+    if(open && !gzipOpen(&stream, fileDesc[file], &task->run)) {
+        fprintf(stderr, "Error on allocating space to inflate %s.\n", fileNames[file]);
+        failFile(file, ENOMEM);
+        *status = EXIT_FAILURE;
+        open = false;
+    }
+    for(size_t c = 0; !sized || (c < task->nChunks); c++) {
+        int idx = takeFreeBuffer(status, true);
+        size_t wanted = (sized && (left < textSize)) ? (size_t)left : textSize;
+
+        // inflate outside of the monitor, straight into the buffer
+        double since = traceNow();
+        size_t size = open ? gzipRead(&stream, buffers[idx].data, wanted) : 0;
+        traceSpan("inflate", "cpu", since);
+        buffers[idx].file = file;
+        buffers[idx].chunk = task->firstChunk + c;
+        buffers[idx].size = (int)size;
+        left -= wanted;
+
+        pushFullBuffer(status, idx);
+        if(!sized && (size < wanted)) break; // end of the file
     }
+    if(stream.error != NULL) {
+        fprintf(stderr, "Error on inflating file %s: %s\n", fileNames[file], stream.error);
+        failFile(file, EBADMSG); // the text inflated so far is counted
+        *status = EXIT_FAILURE;
+    }
+    gzipClose(&stream);
 
+    if(endInflating(status, file)) completeFile(file, nThreads + inflaterID, status);
     return false;
 }
 
 /**
- * @brief Update word and vowel count for processed file.
+ * @brief Retrieve a chunk of file text.
+ * 
+ * Operation carried out by the workers, without entering the monitor (unless in pipeline mode).
  * 
- * Operation carried out by the consumers after processing a chunk.
+ * A byte range of the files is claimed atomically, or in pipeline mode a buffer filled by a reader is popped
+ * instead. The range is cut at arbitrary byte offsets, words and letters it cuts
+ * are mended when the summaries of the ranges are folded. In memory-mapped mode the chunk is a view into the file
+ * mapping. Once every range is claimed, workers pop the buffers filled by the inflaters, if any.
  * 
  * @param workerID worker identification
- * @param wordCountPartial word count for processed text chunk
- * @param vowelCountsPartial vowel counts for processed text chunk
+ * @param chunk output variable, points to the text chunk
+ * @param chunkSize output variable, stores the size, in bytes, of the text chunk
+ * @return true : the worker's work is finished signaling it should quit 
+ * @return false : the worker should continue it's life cycle
+ */
+bool readFromFile(unsigned int workerID, unsigned char ** chunk, int * chunkSize) { // worker
+    int file;
+    off_t start, end;
+
+    if(nReaders > 0) return popBuffer(workerID, chunk, chunkSize); // pipeline mode, readers fill the buffers
+    if(!claimRange(workerID, &file, &start, &end)) { // files were all processed, move on to the compressed ones or die
+        return (nInflaters > 0) ? popBuffer(workerID, chunk, chunkSize) : true;
+    }
+
+    // store worker's current file and byte range
+    currFileWorker[workerID] = file;
+    currChunkWorker[workerID] = (start - fileBase[file]) / textSize;
+
+    // read the claimed range
+    loadWindow(workerID, file, start, end);
+    *chunk = (end > start) ? windows[workerID].data + (start - windows[workerID].offset) : NULL;
+    *chunkSize = end - start;
+
+    return false;
+}
+
+/**
+ *  \brief Store the summary of a chunk of a compressed file.
+ *
+ *  Internal monitor operation, carried out by the workers: the arrays of the file may be moved by an inflater
+ *  growing them.
+ *
+ *  \param workerID worker identification
+ *  \param summary summary of the processed text chunk
+ *  \param extra letters and word lengths of the processed text chunk (ignored if not gathered)
+ *  \param edges bytes around the words interned with the processed text chunk (ignored if words are not interned)
+ *  \return true if the file is done, its chunks all inflated and summarized, false otherwise
  */
-void updateCounts(unsigned int workerID, unsigned int wordCountPartial, unsigned int * vowelCountsPartial) {
-    statusWorker[workerID] = pthread_mutex_lock(&accessCR);
+static bool storeInflated(unsigned int workerID, const struct chunkSummary * summary, const struct chunkStats * extra,
+                          const struct wordEdges * edges) {
+    struct inflatedFile * f = &inflatedFiles[currFileWorker[workerID]];
+    size_t chunk = currChunkWorker[workerID];
+
+    statusWorker[workerID] = monitorLock("updateCounts", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
-        perror("Error on entering monitor (CF).");
+        perror("Error on worker thread entering monitor (CF).");
         statusWorker[workerID] = EXIT_FAILURE;
         pthread_exit(&statusWorker[workerID]);
     }
 
-    // update counts for the file
-    wordCount[currFileWorker[workerID]] += wordCountPartial;
-    for(int i = 0; i < VOWELNUM; i++) {
-        vowelCounts[currFileWorker[workerID]][i] += vowelCountsPartial[i]; 
-    }
+    f->summaries[chunk] = *summary;
+    if(f->statistics != NULL) f->statistics[chunk] = *extra;
+    if(f->edges != NULL) f->edges[chunk] = *edges;
+    f->stored++;
+    bool done = (f->runsLeft == 0) && (f->stored == f->nChunks);
 
-    statusWorker[workerID] = pthread_mutex_unlock(&accessCR);
+    statusWorker[workerID] = monitorUnlock("updateCounts", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
-        perror("Error on entering monitor (CF).");
+        perror("Error on worker thread exiting monitor (CF).");
         statusWorker[workerID] = EXIT_FAILURE;
         pthread_exit(&statusWorker[workerID]);
     }
+    return done;
 }
 
 /**
- * @brief Print the current word and vowel counts.
- * 
- * Operation carried out by main thread after all workers have quit.
- * 
+ *  \brief Close a file whose summaries were all stored, intern the words cut between its chunks, then fold them.
+ *
+ *  Internal operation, carried out by the worker storing the file's last summary (or the inflater inflating its last
+ *  run); the summaries are folded inside the monitor.
+ *
+ *  \param file index of the file
+ *  \param tableID word table of the calling thread
+ *  \param status return status of the calling thread
  */
-void printResults() {
-    statusMain = pthread_mutex_lock(&accessCR);
-    if(statusMain) {
-        errno = statusMain;
-        perror("Error on main thread entering monitor (CF).");
-        statusMain = EXIT_FAILURE;
+static void completeFile(int file, int tableID, int * status) {
+    struct chunkSummary * summaries;
+    struct chunkStats * stats;
+    struct wordEdges * edges;
+    size_t nChunks = chunksOf(file, &summaries, &stats, &edges);
+
+    closeFile(file);
+    hashFile(file);
+    if((topWords > 0) && !wordFreqStitch(tableID, edges, nChunks)) {
+        fprintf(stderr, "Error on allocating space to the words of %s.\n", fileNames[file]);
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
+    }
+    if((*status = monitorLock("updateCounts", &accessCR)) != 0) {
+        errno = *status;
+        perror("Error on thread entering monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
     }
-    pthread_once(&init, initialization);
 
-    for(int i = 0; i < nFiles; i++) {
-        printf("File name: %s\n", fileNames[i]);
-        printf("Total number of words = %i\n", wordCount[i]);
-        printf("N. of words with an\n");
-        printf("\tA\tE\tI\tO\tU\tY\n");
-        printf("\t%i\t%i\t%i\t%i\t%i\t%i\n\n", vowelCounts[i][0], vowelCounts[i][1], vowelCounts[i][2], vowelCounts[i][3], vowelCounts[i][4], vowelCounts[i][5]);
+    finishFile(file);
+
+    if((*status = monitorUnlock("updateCounts", &accessCR)) != 0) {
+        errno = *status;
+        perror("Error on thread exiting monitor (CF).");
+        *status = EXIT_FAILURE;
+        pthread_exit(status);
     }
+}
 
-    statusMain = pthread_mutex_unlock(&accessCR);
-    if(statusMain) {
-        errno = statusMain;
-        perror("Error on main thread exiting monitor (CF).");
-        statusMain = EXIT_FAILURE;
+/**
+ * @brief Update word and vowel count for processed file.
+ * 
+ * Operation carried out by the workers after processing a chunk, without entering the monitor.
+ * The summary of the chunk is stored in the slot of its byte range, no two workers ever write to the same slot (the
+ * summaries of compressed files are stored inside the monitor). The worker storing the last summary of a file
+ * closes it, then enters the monitor to fold the file's summaries and print its counts.
+ * 
+ * @param workerID worker identification
+ * @param summary summary of the processed text chunk
+ * @param extra letters and word lengths of the processed text chunk (ignored if not gathered)
+ * @param edges bytes around the words interned with the processed text chunk (ignored if words are not interned)
+ */
+void updateCounts(unsigned int workerID, const struct chunkSummary * summary, const struct chunkStats * extra,
+                  const struct wordEdges * edges) {
+    int file = currFileWorker[workerID];
+
+    if(fileCompressed[file]) {
+        if(storeInflated(workerID, summary, extra, edges)) completeFile(file, workerID, &statusWorker[workerID]);
+        return;
     }
+    chunkSummaries[firstChunk[file] + currChunkWorker[workerID]] = *summary;
+    if(chunkStatistics != NULL) chunkStatistics[firstChunk[file] + currChunkWorker[workerID]] = *extra;
+    if(chunkEdges != NULL) chunkEdges[firstChunk[file] + currChunkWorker[workerID]] = *edges;
+    if(atomic_fetch_sub(&chunksPending[file], 1) != 1) return; // other byte ranges of the file are still out
+
+    completeFile(file, workerID, &statusWorker[workerID]);
 }
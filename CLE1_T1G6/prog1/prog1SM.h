@@ -9,12 +9,28 @@
  *  monitor of the Lampson / Redell type.
  *
  *  Data transfer region implemented as a monitor.
+ *  Workers do not enter the monitor: they claim byte ranges of the files with atomic operations, read them
+ *  outside of any lock and store a summary of each. Ranges are cut at arbitrary byte offsets; the worker storing the
+ *  last summary of a file folds them in order and prints the file's counts right away.
+ *
+ *  In pipeline mode reader threads claim the byte ranges instead and read them ahead of demand into a bounded ring
+ *  of buffers; workers pop filled buffers and give them back once processed, both inside the monitor. Readers may
+ *  keep several reads in flight with io_uring.
+ *
+ *  With the stealing scheduler, byte ranges are claimed from per-thread deques of tasks seeded from all files at
+ *  once, and idle threads steal tasks from the others instead of following a single file cursor.
+ *
+ *  Gzip-compressed files are inflated by inflater threads into the same buffers, in runs of members which are
+ *  inflated in parallel when their sizes are known (BGZF).
  *
  *  Definition of the operations carried out by the threads:
  *     \li (worker) readFromFile
  *     \li (worker) updateCounts
+ *     \li (reader) fillBuffer
+ *     \li (reader) fillBuffersAsync
+ *     \li (inflater) inflateRun
  *     \li (main) storeFileNames
- *     \li (main) printResults.
+ *     \li (main) filesFailed.
  * 
  * @version 0.1
  * @date 2023-03-22
@@ -27,29 +43,70 @@
 
 #include <stdbool.h>
 
+#include "prog1Utils.h"
+#include "wordFreq.h"
+
 /**
  * @brief Retrieve a chunk of file text.
  * 
- * Operation carried out by the workers.
+ * Operation carried out by the workers, without entering the monitor (unless in pipeline mode).
+ * 
+ * A byte range of the current file is claimed atomically, cut at arbitrary byte offsets. In memory-mapped mode the
+ * chunk is a view into the file mapping, in pipeline mode it is a buffer filled by a reader.
  * 
  * @param workerID worker identification
- * @param chunk output variable, stores the text chunk from the file
+ * @param chunk output variable, points to the text chunk
  * @param chunkSize output variable, stores the size, in bytes, of the text chunk
  * @return true : the worker's work is finished signaling it should quit 
  * @return false : the worker should continue it's life cycle
  */
-extern bool readFromFile(unsigned int workerID, unsigned char * chunk, int * chunkSize);
+extern bool readFromFile(unsigned int workerID, unsigned char ** chunk, int * chunkSize);
 
 /**
  * @brief Update word and vowel count for processed file.
  * 
- * Operation carried out by the consumers after processing a chunk.
+ * Operation carried out by the workers after processing a chunk, without entering the monitor.
+ * The summary of the chunk is stored in the slot of its byte range. Once a file's last range is summarized, its
+ * summaries are folded and its counts printed, inside the monitor.
  * 
  * @param workerID worker identification
- * @param wordCountPartial word count for processed text chunk
- * @param vowelCountsPartial vowel counts for processed text chunk
+ * @param summary summary of the processed text chunk
+ * @param extra letters and word lengths of the processed text chunk (ignored if not gathered)
+ * @param edges bytes around the words interned with the processed text chunk (ignored if words are not interned)
+ */
+extern void updateCounts(unsigned int workerID, const struct chunkSummary * summary, const struct chunkStats * extra,
+                         const struct wordEdges * edges);
+
+/**
+ * @brief Read the next byte range of the files into a free buffer.
+ * 
+ * Operation carried out by the readers in pipeline mode.
+ * 
+ * @param readerID reader identification
+ * @return true : the files were all read, signaling the reader should quit
+ * @return false : the reader should continue it's life cycle
+ */
+extern bool fillBuffer(unsigned int readerID);
+
+/**
+ * @brief Read all the byte ranges left with io_uring, keeping several reads in flight, until the files were all read.
+ * 
+ * Operation carried out by the readers in io_uring mode. Falls back to fillBuffer if io_uring is not available.
+ * 
+ * @param readerID reader identification
+ */
+extern void fillBuffersAsync(unsigned int readerID);
+
+/**
+ * @brief Inflate the next run of members of the compressed files into free buffers.
+ * 
+ * Operation carried out by the inflaters.
+ * 
+ * @param inflaterID inflater identification
+ * @return true : the runs were all inflated, signaling the inflater should quit
+ * @return false : the inflater should continue it's life cycle
  */
-extern void updateCounts(unsigned int workerID, unsigned int wordCountPartial, unsigned int * vowelCountPartial);
+extern bool inflateRun(unsigned int inflaterID);
 
 /**
  * @brief Store file names in the data transfer region.
@@ -61,11 +118,12 @@ extern void updateCounts(unsigned int workerID, unsigned int wordCountPartial, u
 extern void storeFileNames(char ** names);
 
 /**
- * @brief Print the current word and vowel counts.
- * 
- * Operation carried out by main thread after all workers have quit.
- * 
+ * @brief Tell if a file could not be counted in full.
+ *
+ * Operation carried out by the main thread once the workers, readers and inflaters are done.
+ *
+ * @return true if a file could not be opened, read or inflated, false otherwise
  */
-extern void printResults();
+extern bool filesFailed(void);
 
 #endif
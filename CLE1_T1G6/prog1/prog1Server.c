@@ -0,0 +1,467 @@
+/**
+ * @file prog1Server.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Daemon mode: a warm pool of counting threads serving jobs over a Unix domain socket, and the client submitting them.
+ *
+ * The server blocks SIGINT and SIGTERM in every thread but while the main thread waits for connections with ppoll,
+ * so a signal never gets lost between two connections. Once stopping, the connections still open are shut down for
+ * reading: each answers the job it was given and quits, then the pool is stopped.
+ *
+ * Functions:
+ *     \li serveJobs
+ *     \li submitJob.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "prog1Server.h"
+#include "prog1Files.h"
+#include "prog1Report.h"
+#include "vowelCount.h"
+
+/** \brief connection of a client to the server */
+struct connection {
+    vc_pool * pool;             /**< pool counting the jobs */
+    int fd;                     /**< socket of the connection */
+    unsigned int chunkSize;     /**< size, in bytes, of the chunks files are cut into */
+};
+
+/** \brief path of a file as sent to the server, absolute, with the index of the name it was given as */
+struct sentPath {
+    char * path;                /**< absolute path */
+    int idx;                    /**< index of the file in the names given */
+};
+
+/** \brief answer to a job, written as its files are done */
+struct jobAnswer {
+    FILE * out;                 /**< stream to the client */
+    char ** names;              /**< names of the files of the job */
+};
+
+/** \brief flag set by SIGINT or SIGTERM */
+static volatile sig_atomic_t stopping = 0;
+
+/** \brief locking flag which warrants mutual exclusion on the table of open connections */
+static pthread_mutex_t connectionsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief main thread waiting for the open connections to quit */
+static pthread_cond_t connectionsClosed = PTHREAD_COND_INITIALIZER;
+
+/** \brief sockets of the open connections */
+static int * openSockets = NULL;
+
+/** \brief number of open connections */
+static int nOpenSockets = 0;
+
+/** \brief number of connections the table has room for */
+static int openCapacity = 0;
+
+/**
+ * @brief Signal handler: stop serving.
+ *
+ * @param sig signal number
+ */
+static void stopServing(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+/**
+ * @brief Write the answer line of a file.
+ *
+ * @param out stream to the client
+ * @param name file name
+ * @param result counts of the file
+ */
+static void writeResult(FILE * out, const char * name, const vc_result * result) {
+    fprintf(out, "%llu\t%.6f\t%llu", (unsigned long long)result->bytes, result->seconds, (unsigned long long)result->words);
+    for(int j = 0; j < VC_VOWELS; j++) fprintf(out, "\t%llu", (unsigned long long)result->vowels[j]);
+    fprintf(out, "\t%d\t%s\n", result->error, name);
+}
+
+/**
+ * @brief Answer a file of a job, called by the pool as it is done.
+ *
+ * @param index index of the file in the job
+ * @param result counts of the file
+ * @param arg answer to the job
+ */
+static void answerFile(size_t index, const vc_result * result, void * arg) {
+    struct jobAnswer * answer = (struct jobAnswer *)arg;
+    writeResult(answer->out, answer->names[index], result);
+}
+
+/**
+ * @brief Remove a connection from the table of open connections.
+ *
+ * @param fd socket of the connection
+ */
+static void forgetConnection(int fd) {
+    pthread_mutex_lock(&connectionsLock);
+    for(int i = 0; i < nOpenSockets; i++) {
+        if(openSockets[i] != fd) continue;
+        openSockets[i] = openSockets[--nOpenSockets];
+        break;
+    }
+    if(nOpenSockets == 0) pthread_cond_signal(&connectionsClosed);
+    pthread_mutex_unlock(&connectionsLock);
+}
+
+/**
+ * @brief Life cycle of a connection: read jobs, count them on the pool and answer them, until the client hangs up.
+ *
+ * @param args the connection, freed on return
+ * @return void* : NULL
+ */
+static void * serveConnection(void * args) {
+    struct connection conn = *(struct connection *)args;
+    struct fileList job = {NULL, 0, 0};
+    FILE * in = NULL, * out = NULL;
+    char * line = NULL;
+    size_t lineCapacity = 0;
+    bool open = true, pending = false;
+    int outFd;
+
+    free(args);
+    if(((outFd = dup(conn.fd)) == -1) || ((out = fdopen(outFd, "w")) == NULL) || ((in = fdopen(conn.fd, "r")) == NULL)) {
+        if(out != NULL) fclose(out);
+        else if(outFd != -1) close(outFd);
+        forgetConnection(conn.fd);
+        close(conn.fd);
+        return NULL;
+    }
+
+    while(open) {
+        ssize_t length = getline(&line, &lineCapacity, in);
+        open = (length != -1);
+        if(open && (length > 0) && (line[length - 1] == '\n')) line[--length] = '\0';
+        if(open && (length > 0)) { // a path of the job, directory trees are walked here
+            if(!addPath(&job, line)) {
+                vc_result failed = {0};
+                failed.error = errno;
+                writeResult(out, line, &failed);
+            }
+            pending = true;
+            continue;
+        }
+        if(!open && !pending) break; // hung up between jobs
+
+        // end of the job: an empty line or the client's side shut down
+        struct jobAnswer answer = {out, job.names};
+        if((job.count > 0) &&
+           (vc_count_files(conn.pool, (const char * const *)job.names, job.count, conn.chunkSize, NULL, answerFile, &answer) == -1)) {
+            vc_result failed = {0};
+            failed.error = errno;
+            for(int i = 0; i < job.count; i++) writeResult(out, job.names[i], &failed);
+        }
+        fputc('\n', out);
+        fflush(out);
+        for(int i = 0; i < job.count; i++) free(job.names[i]);
+        job.count = 0;
+        pending = false;
+    }
+
+    free(line);
+    free(job.names);
+    forgetConnection(conn.fd);
+    fclose(out);
+    fclose(in);
+    return NULL;
+}
+
+/**
+ * @brief Add a connection to the table of open connections.
+ *
+ * @param fd socket of the connection
+ * @return true on success, false if memory runs out
+ */
+static bool rememberConnection(int fd) {
+    bool stored = true;
+
+    pthread_mutex_lock(&connectionsLock);
+    if(nOpenSockets == openCapacity) {
+        int capacity = (openCapacity > 0) ? 2 * openCapacity : 16;
+        int * sockets = (int *)realloc(openSockets, capacity * sizeof(int));
+        if(sockets != NULL) {
+            openSockets = sockets;
+            openCapacity = capacity;
+        }
+        else stored = false;
+    }
+    if(stored) openSockets[nOpenSockets++] = fd;
+    pthread_mutex_unlock(&connectionsLock);
+    return stored;
+}
+
+/**
+ * @brief Start a thread serving a new connection.
+ *
+ * @param pool pool counting the jobs
+ * @param fd socket of the connection, closed if no thread could be started
+ * @param chunkSize size, in bytes, of the chunks files are cut into
+ */
+static void startConnection(vc_pool * pool, int fd, unsigned int chunkSize) {
+    struct connection * conn;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if(((conn = (struct connection *)malloc(sizeof(struct connection))) == NULL) || !rememberConnection(fd)) {
+        free(conn);
+        close(fd);
+        return;
+    }
+    conn->pool = pool;
+    conn->fd = fd;
+    conn->chunkSize = chunkSize;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if(pthread_create(&thread, &attr, serveConnection, conn) != 0) {
+        fprintf(stderr, "Error on creating a thread for a connection.\n");
+        forgetConnection(fd);
+        free(conn);
+        close(fd);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/**
+ * @brief Serve jobs on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @param socketPath path of the socket (a stale socket left there is replaced)
+ * @param nThreads number of counting threads kept warm
+ * @param chunkSize size, in bytes, of the chunks files are cut into (0 for the library's default)
+ * @return true if the server stopped on a signal, false if it could not start (errno is set)
+ */
+bool serveJobs(const char * socketPath, int nThreads, unsigned int chunkSize) {
+    struct sockaddr_un addr;
+    struct sigaction action, oldInt, oldTerm, oldPipe;
+    sigset_t stopSignals, oldMask;
+    struct stat st;
+    vc_pool * pool;
+    int fd;
+
+    if(strlen(socketPath) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    // the pool and the connection threads inherit a mask blocking the signals which stop the server
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &oldMask);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServing;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &oldInt);
+    sigaction(SIGTERM, &action, &oldTerm);
+    action.sa_handler = SIG_IGN; // a client hanging up before its answer is written must not kill the server
+    sigaction(SIGPIPE, &action, &oldPipe);
+
+    if((pool = vc_pool_create(nThreads)) == NULL) {
+        pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+        return false;
+    }
+    if((lstat(socketPath, &st) == 0) && S_ISSOCK(st.st_mode)) unlink(socketPath); // left by a server which died
+    if(((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) ||
+       (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) || (listen(fd, SOMAXCONN) == -1)) {
+        int error = errno;
+        if(fd != -1) close(fd);
+        vc_pool_destroy(pool);
+        pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+        errno = error;
+        return false;
+    }
+
+    sigset_t waitMask = oldMask; // the stop signals are only delivered while waiting for a connection
+    sigdelset(&waitMask, SIGINT);
+    sigdelset(&waitMask, SIGTERM);
+    while(!stopping) {
+        struct pollfd listener = {fd, POLLIN, 0};
+        if(ppoll(&listener, 1, NULL, &waitMask) <= 0) continue; // interrupted by a signal
+        int conn = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if(conn != -1) startConnection(pool, conn, chunkSize);
+    }
+    close(fd);
+    unlink(socketPath);
+
+    // connections answer the job they were given and quit, then the pool may stop
+    pthread_mutex_lock(&connectionsLock);
+    for(int i = 0; i < nOpenSockets; i++) shutdown(openSockets[i], SHUT_RD);
+    while(nOpenSockets > 0) pthread_cond_wait(&connectionsClosed, &connectionsLock);
+    pthread_mutex_unlock(&connectionsLock);
+    vc_pool_destroy(pool);
+
+    sigaction(SIGINT, &oldInt, NULL);
+    sigaction(SIGTERM, &oldTerm, NULL);
+    sigaction(SIGPIPE, &oldPipe, NULL);
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+    return true;
+}
+
+/**
+ * @brief Make a path absolute, so the server does not resolve it against its own working directory.
+ *
+ * A path which can not be resolved (the file is missing) is joined to the working directory, so the server reports
+ * why it can not be read.
+ *
+ * @param name path, as given
+ * @return char* : absolute path, to be freed, NULL if memory runs out (errno is set)
+ */
+static char * absolutePath(const char * name) {
+    char * path, * cwd;
+
+    if((path = realpath(name, NULL)) != NULL) return path;
+    if(name[0] == '/') return strdup(name);
+    if((cwd = getcwd(NULL, 0)) == NULL) return NULL;
+    if((path = (char *)malloc(strlen(cwd) + strlen(name) + 2)) != NULL) sprintf(path, "%s/%s", cwd, name);
+    free(cwd);
+    return path;
+}
+
+/**
+ * @brief Order the paths sent by name, for the answers to be matched to the names given.
+ *
+ * @param a first path
+ * @param b second path
+ * @return int : negative, zero or positive as the first name sorts before, with or after the second
+ */
+static int comparePaths(const void * a, const void * b) {
+    return strcmp(((const struct sentPath *)a)->path, ((const struct sentPath *)b)->path);
+}
+
+/**
+ * @brief Free the paths sent.
+ *
+ * @param sent paths sent
+ * @param nSent number of paths
+ */
+static void freePaths(struct sentPath * sent, int nSent) {
+    for(int i = 0; i < nSent; i++) free(sent[i].path);
+    free(sent);
+}
+
+/**
+ * @brief Submit a job to a server and report its answer, as the counts of the files in the given format.
+ *
+ * The paths are sent absolute and the files reported by the names given. The run is reported as done by a single
+ * worker, the server, over the time from connecting to the last answer.
+ *
+ * @param socketPath path of the server's socket
+ * @param names names of the files
+ * @param nFiles number of files
+ * @param format output format (FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV)
+ * @param nFailed output variable, number of files the server could not count
+ * @return true on success, false if the server could not be reached or hung up (errno is set)
+ */
+bool submitJob(const char * socketPath, char ** names, int nFiles, int format, int * nFailed) {
+    struct sockaddr_un addr;
+    struct workerStats server = {0, 0, 0, 0};
+    double start = wallClock();
+    FILE * in, * out;
+    char * line = NULL;
+    size_t lineCapacity = 0;
+    bool answered = false;
+    struct sentPath * sent;
+    int fd;
+
+    *nFailed = 0;
+    if(strlen(socketPath) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    if((sent = (struct sentPath *)malloc((nFiles + 1) * sizeof(struct sentPath))) == NULL) return false;
+    for(int i = 0; i < nFiles; i++) {
+        if((sent[i].path = absolutePath(names[i])) == NULL) {
+            int error = errno;
+            freePaths(sent, i);
+            errno = error;
+            return false;
+        }
+        sent[i].idx = i;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+        int error = errno;
+        freePaths(sent, nFiles);
+        errno = error;
+        return false;
+    }
+    if((connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) || ((out = fdopen(fd, "w")) == NULL)) {
+        int error = errno;
+        close(fd);
+        freePaths(sent, nFiles);
+        errno = error;
+        return false;
+    }
+
+    for(int i = 0; i < nFiles; i++) fprintf(out, "%s\n", sent[i].path);
+    fputc('\n', out);
+    if((fflush(out) == EOF) || (shutdown(fd, SHUT_WR) == -1) || ((in = fdopen(dup(fd), "r")) == NULL)) {
+        int error = errno;
+        fclose(out);
+        freePaths(sent, nFiles);
+        errno = error;
+        return false;
+    }
+    qsort(sent, nFiles, sizeof(struct sentPath), comparePaths); // answers come as files are done, found by path
+
+    reportBegin(format);
+    while(getline(&line, &lineCapacity, in) != -1) {
+        unsigned long long bytes, words, vowels[VC_VOWELS];
+        double seconds;
+        int error, name;
+        if(line[0] == '\n') { // end of the answer
+            answered = true;
+            break;
+        }
+        line[strcspn(line, "\n")] = '\0';
+        if(sscanf(line, "%llu\t%lf\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%d\t%n", &bytes, &seconds, &words,
+                  &vowels[0], &vowels[1], &vowels[2], &vowels[3], &vowels[4], &vowels[5], &error, &name) != 10) continue;
+        struct sentPath key = {&line[name], 0};
+        struct sentPath * match = (struct sentPath *)bsearch(&key, sent, nFiles, sizeof(struct sentPath), comparePaths);
+        const char * reported = (match != NULL) ? names[match->idx] : &line[name]; // files of a tree walked by the server
+        if(error != 0) { // reported all the same, with its error
+            fprintf(stderr, "Error on counting file %s: %s\n", reported, strerror(error));
+            (*nFailed)++;
+        }
+        reportFile(format, reported, (long long)bytes, seconds, words, vowels, error);
+        server.chunks++;
+        server.bytes += bytes;
+    }
+    server.busy = wallClock() - start;
+    reportRun(format, &server, 1, server.busy);
+
+    free(line);
+    freePaths(sent, nFiles);
+    fclose(in);
+    fclose(out);
+    if(!answered) errno = ECONNRESET;
+    return answered;
+}
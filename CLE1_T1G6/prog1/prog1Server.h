@@ -0,0 +1,57 @@
+/**
+ * @file prog1Server.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Daemon mode: a warm pool of counting threads serving jobs over a Unix domain socket, and the client submitting them.
+ *
+ * The server keeps a libvowelcount pool, with its threads and chunk buffers, alive from job to job; each connection
+ * is served by a thread of its own and its jobs are queued on the shared pool. A job is a list of paths, files or
+ * directory trees, one per line, ended by an empty line or by the client shutting down its side; a connection may
+ * carry several jobs. The answer holds a line per file, as each is done, ended by an empty line:
+ *
+ *     bytes \\t seconds \\t words \\t a \\t e \\t i \\t o \\t u \\t y \\t errno \\t name
+ *
+ * errno is 0 unless the file could not be read. Paths may not hold newlines; relative paths are resolved against the
+ * server's working directory, so the client sends them absolute. SIGINT and SIGTERM stop the server once
+ * the jobs going on are answered.
+ *
+ * Functions:
+ *     \li serveJobs
+ *     \li submitJob.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef PROG1_SERVER_H
+#define PROG1_SERVER_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Serve jobs on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @param socketPath path of the socket (a stale socket left there is replaced)
+ * @param nThreads number of counting threads kept warm
+ * @param chunkSize size, in bytes, of the chunks files are cut into (0 for the library's default)
+ * @return true if the server stopped on a signal, false if it could not start (errno is set)
+ */
+extern bool serveJobs(const char * socketPath, int nThreads, unsigned int chunkSize);
+
+/**
+ * @brief Submit a job to a server and report its answer, as the counts of the files in the given format.
+ *
+ * @param socketPath path of the server's socket
+ * @param names names of the files
+ * @param nFiles number of files
+ * @param format output format (FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV)
+ * @param nFailed output variable, number of files the server could not count
+ * @return true on success, false if the server could not be reached or hung up (errno is set)
+ */
+extern bool submitJob(const char * socketPath, char ** names, int nFiles, int format, int * nFailed);
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * @file prog1Uring.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Minimal io_uring interface for asynchronous file reads, on top of the raw system calls (no liburing needed).
+ *
+ * The submission and completion rings are shared with the kernel: tails are published with release stores and
+ * heads read with acquire loads, as the kernel expects.
+ *
+ * Functions:
+ *     \li uringInit
+ *     \li uringQueueRead
+ *     \li uringSubmit
+ *     \li uringReap
+ *     \li uringExit.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "prog1Uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+/**
+ * @brief Set up an io_uring instance.
+ * 
+ * @param ring output variable, io_uring instance
+ * @param depth number of entries of the submission ring
+ * @return true on success, false if io_uring is not available
+ */
+bool uringInit(struct uring * ring, unsigned int depth) {
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(struct uring));
+    memset(&params, 0, sizeof(params));
+    if((ring->fd = (int)syscall(__NR_io_uring_setup, depth, &params)) < 0) {
+        ring->fd = -1;
+        return false;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) { // both rings share one mapping
+        if(ring->cqRingSize > ring->sqRingSize) ring->sqRingSize = ring->cqRingSize;
+        ring->cqRingSize = ring->sqRingSize;
+    }
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if(ring->sqRing == MAP_FAILED) {
+        close(ring->fd);
+        ring->fd = -1;
+        return false;
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP) ring->cqRing = ring->sqRing;
+    else {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if(ring->cqRing == MAP_FAILED) {
+            munmap(ring->sqRing, ring->sqRingSize);
+            close(ring->fd);
+            ring->fd = -1;
+            return false;
+        }
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if(ring->sqes == MAP_FAILED) {
+        if(ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(ring->fd);
+        ring->fd = -1;
+        return false;
+    }
+
+    unsigned char * sq = (unsigned char *)ring->sqRing, * cq = (unsigned char *)ring->cqRing;
+    ring->sqHead = (unsigned int *)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned int *)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned int *)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned int *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned int *)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    ring->cqes = cq + params.cq_off.cqes;
+    ring->toSubmit = 0;
+    return true;
+}
+
+/**
+ * @brief Queue a read of a file range, to be submitted by uringSubmit.
+ * 
+ * @param ring io_uring instance
+ * @param fd file descriptor
+ * @param data output variable, bytes read
+ * @param size number of bytes to read
+ * @param offset file offset of the first byte
+ * @param tag value handed back with the completion
+ * @return true on success, false if the submission ring is full
+ */
+bool uringQueueRead(struct uring * ring, int fd, void * data, unsigned int size, unsigned long long offset,
+                    unsigned long long tag) {
+    unsigned int tail = *ring->sqTail;
+    unsigned int head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+    if(tail - head > *ring->sqMask) return false; // ring full
+    unsigned int idx = tail & *ring->sqMask;
+    struct io_uring_sqe * sqe = &((struct io_uring_sqe *)ring->sqes)[idx];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (unsigned long long)(unsigned long)data;
+    sqe->len = size;
+    sqe->user_data = tag;
+    ring->sqArray[idx] = idx;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->toSubmit++;
+    return true;
+}
+
+/**
+ * @brief Submit the queued reads and wait for some reads to complete.
+ * 
+ * @param ring io_uring instance
+ * @param minComplete number of completions to wait for
+ * @return true on success, false otherwise (errno is set)
+ */
+bool uringSubmit(struct uring * ring, unsigned int minComplete) {
+    while(true) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->toSubmit, minComplete,
+                                 (minComplete > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if(submitted >= 0) {
+            ring->toSubmit -= (unsigned int)submitted;
+            return true;
+        }
+        if(errno != EINTR) return false;
+    }
+}
+
+/**
+ * @brief Take a completed read, if any.
+ * 
+ * @param ring io_uring instance
+ * @param tag output variable, value given when the read was queued
+ * @param result output variable, number of bytes read or minus the error number
+ * @return true if a completion was taken, false if none is ready
+ */
+bool uringReap(struct uring * ring, unsigned long long * tag, int * result) {
+    unsigned int head = *ring->cqHead;
+
+    if(head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) return false;
+    struct io_uring_cqe * cqe = &((struct io_uring_cqe *)ring->cqes)[head & *ring->cqMask];
+    *tag = cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Tear down an io_uring instance.
+ * 
+ * @param ring io_uring instance
+ */
+void uringExit(struct uring * ring) {
+    if(ring->fd < 0) return;
+    munmap(ring->sqes, ring->sqesSize);
+    if(ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+#else
+
+bool uringInit(struct uring * ring, unsigned int depth) {
+    (void)depth;
+    memset(ring, 0, sizeof(struct uring));
+    ring->fd = -1;
+    errno = ENOSYS;
+    return false;
+}
+
+bool uringQueueRead(struct uring * ring, int fd, void * data, unsigned int size, unsigned long long offset,
+                    unsigned long long tag) {
+    (void)ring; (void)fd; (void)data; (void)size; (void)offset; (void)tag;
+    return false;
+}
+
+bool uringSubmit(struct uring * ring, unsigned int minComplete) {
+    (void)ring; (void)minComplete;
+    errno = ENOSYS;
+    return false;
+}
+
+bool uringReap(struct uring * ring, unsigned long long * tag, int * result) {
+    (void)ring; (void)tag; (void)result;
+    return false;
+}
+
+void uringExit(struct uring * ring) {
+    (void)ring;
+}
+
+#endif
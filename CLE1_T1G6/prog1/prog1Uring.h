@@ -0,0 +1,100 @@
+/**
+ * @file prog1Uring.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Minimal io_uring interface for asynchronous file reads, on top of the raw system calls (no liburing needed).
+ *
+ * When the kernel headers lack io_uring, or the kernel refuses to set it up, uringInit fails and callers fall back
+ * to synchronous reads.
+ *
+ * Functions:
+ *     \li uringInit
+ *     \li uringQueueRead
+ *     \li uringSubmit
+ *     \li uringReap
+ *     \li uringExit.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef PROG1_URING_H
+#define PROG1_URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** \brief io_uring instance, with its submission and completion rings mapped to memory. */
+struct uring {
+    int fd;                     /**< io_uring file descriptor, -1 if not set up */
+    unsigned int * sqHead;      /**< submission ring head, moved by the kernel */
+    unsigned int * sqTail;      /**< submission ring tail, moved by us */
+    unsigned int * sqMask;      /**< submission ring index mask */
+    unsigned int * sqArray;     /**< submission ring, indices into sqes */
+    void * sqes;                /**< submission queue entries */
+    unsigned int * cqHead;      /**< completion ring head, moved by us */
+    unsigned int * cqTail;      /**< completion ring tail, moved by the kernel */
+    unsigned int * cqMask;      /**< completion ring index mask */
+    void * cqes;                /**< completion queue entries */
+    unsigned int toSubmit;      /**< entries queued but not yet submitted */
+    void * sqRing;              /**< mapping of the submission ring */
+    size_t sqRingSize;          /**< size of the mapping of the submission ring */
+    void * cqRing;              /**< mapping of the completion ring (same as sqRing on recent kernels) */
+    size_t cqRingSize;          /**< size of the mapping of the completion ring */
+    size_t sqesSize;            /**< size of the mapping of the submission queue entries */
+};
+
+/**
+ * @brief Set up an io_uring instance.
+ *
+ * @param ring output variable, io_uring instance
+ * @param depth number of entries of the submission ring
+ * @return true on success, false if io_uring is not available
+ */
+extern bool uringInit(struct uring * ring, unsigned int depth);
+
+/**
+ * @brief Queue a read of a file range, to be submitted by uringSubmit.
+ *
+ * @param ring io_uring instance
+ * @param fd file descriptor
+ * @param data output variable, bytes read
+ * @param size number of bytes to read
+ * @param offset file offset of the first byte
+ * @param tag value handed back with the completion
+ * @return true on success, false if the submission ring is full
+ */
+extern bool uringQueueRead(struct uring * ring, int fd, void * data, unsigned int size, unsigned long long offset,
+                           unsigned long long tag);
+
+/**
+ * @brief Submit the queued reads and wait for some reads to complete.
+ *
+ * @param ring io_uring instance
+ * @param minComplete number of completions to wait for
+ * @return true on success, false otherwise (errno is set)
+ */
+extern bool uringSubmit(struct uring * ring, unsigned int minComplete);
+
+/**
+ * @brief Take a completed read, if any.
+ *
+ * @param ring io_uring instance
+ * @param tag output variable, value given when the read was queued
+ * @param result output variable, number of bytes read or minus the error number
+ * @return true if a completion was taken, false if none is ready
+ */
+extern bool uringReap(struct uring * ring, unsigned long long * tag, int * result);
+
+/**
+ * @brief Tear down an io_uring instance.
+ *
+ * @param ring io_uring instance
+ */
+extern void uringExit(struct uring * ring);
+
+#endif
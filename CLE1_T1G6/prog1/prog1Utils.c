@@ -6,11 +6,32 @@
  * 
  * Utility functions for UTF8 text processing.
  * 
+ * Letters are classified in a single step by precomputed lookup tables, which give the letter size, whether it is a
+ * separator or starts a word and the vowel it folds to. Shared by the pthread (CLE1) and MPI (CLE2) programs.
+ * 
+ * Words are counted 32 bytes at a time on blocks of plain ASCII text, with AVX2 or SSE4.2 picked at run time, and
+ * letter by letter on any other block or CPU.
+ * 
+ * Text may also be cut at any byte offset: each chunk is then summarized on its own and the summaries are folded in
+ * order, which gives the same counts as scanning the whole text at once. Malformed UTF8 too, as a character always
+ * ends at the first byte which is not a continuation byte, whichever chunk holds it.
+ * 
+ * The letters of the text and the lengths of its words are gathered, when asked for, in the same pass as the vowels,
+ * letter by letter, by an instance of the kernel specialized for the statistics asked for.
+ * 
  * Functions:
- *     \li getLetterSize
- *     \li isAlpha
- *     \li isSeparator
- *     \li isVowel.
+ *     \li classifyLetter
+ *     \li useKernels
+ *     \li countWords
+ *     \li summarizeChunk
+ *     \li foldChunk
+ *     \li finishTally
+ *     \li summarizeChunkStats
+ *     \li foldChunkStats
+ *     \li finishTallyStats
+ *     \li parseStats
+ *     \li parseChunkSize
+ *     \li tuneChunkSize.
  * 
  * @version 0.1
  * @date 2023-03-22
@@ -19,127 +40,1085 @@
  * 
  */
 
+#include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "prog1Utils.h"
+
+/** \brief number of vowels told apart by the letter classes */
+#define VOWELS LETTER_VOWELNUM
+
+/** \brief bytes read from the first file to measure the throughput when tuning the chunk size */
+#define TUNEPROBESIZE (4 * 1024 * 1024)
+
+/** \brief bytes per chunk scanned while measuring the throughput */
+#define TUNEPROBECHUNK (256 * 1024)
+
+/** \brief share of the time of a chunk which may go to handing it out */
+#define TUNEOVERHEAD 0.01
+
+/** \brief chunks each worker should get at least, so the last ones balance the load */
+#define TUNECHUNKSPERWORKER 8
+
+/** \brief files stat'ed at most to estimate the total size of a long file list when tuning the chunk size */
+#define TUNESAMPLEFILES 1024
+
+/** \brief size, in bytes, of an UTF8 character announced by its first byte (continuation and invalid bytes count as one). */
+const unsigned char letterSize[256] = {
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x00
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x10
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x20
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x30
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x40
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x50
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x60
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x70
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x80
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0x90
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0xA0
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0xB0
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, // 0xC0
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, // 0xD0
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, // 0xE0
+    0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, // 0xF0
+};
 
 /**
- * @brief Get the size in bytes of UTF8 character.
+ * \brief class of one byte characters indexed by the byte (0 for the first byte of longer characters).
+ *
+ * Word starts are 0x41 to 0x90 and a to z, so '[' and ']' start a word when found outside of one and end it otherwise.
+ */
+const unsigned char oneByteClass[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x00, 0x00, 0x80, 0x00, 0x00, // 0x00
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x10
+    0x80, 0x80, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x00, 0x00, 0x80, 0x80, 0x80, 0x00, // 0x20
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x00, 0x00, 0x00, 0x80, // 0x30
+    0x00, 0x41, 0x40, 0x40, 0x40, 0x42, 0x40, 0x40, 0x40, 0x44, 0x40, 0x40, 0x40, 0x40, 0x40, 0x48, // 0x40
+    0x40, 0x40, 0x40, 0x40, 0x40, 0x50, 0x40, 0x40, 0x40, 0x60, 0x40, 0xC0, 0x40, 0xC0, 0x40, 0x40, // 0x50
+    0x40, 0x41, 0x40, 0x40, 0x40, 0x42, 0x40, 0x40, 0x40, 0x44, 0x40, 0x40, 0x40, 0x40, 0x40, 0x48, // 0x60
+    0x40, 0x40, 0x40, 0x40, 0x40, 0x50, 0x40, 0x40, 0x40, 0x60, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, // 0x70
+    0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, // 0x80
+    0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x90
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xA0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xB0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xC0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xD0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xE0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xF0
+};
+
+/** \brief class of two byte characters starting by 0xC3 (Latin-1 letters) indexed by the low bits of their second byte. */
+const unsigned char latinClass[64] = {
+    0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x40, 0x42, 0x42, 0x42, 0x42, 0x44, 0x44, 0x44, 0x44, // 0xC3 0x80
+    0x40, 0x40, 0x48, 0x48, 0x48, 0x48, 0x48, 0x00, 0x48, 0x50, 0x50, 0x50, 0x50, 0x60, 0x40, 0x40, // 0xC3 0x90
+    0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x40, 0x42, 0x42, 0x42, 0x42, 0x44, 0x44, 0x44, 0x44, // 0xC3 0xA0
+    0x48, 0x40, 0x48, 0x48, 0x48, 0x48, 0x48, 0x00, 0x48, 0x50, 0x50, 0x50, 0x50, 0x60, 0x40, 0x60, // 0xC3 0xB0
+};
+
+/** \brief class of three byte characters starting by 0xE2 0x80 (punctuation) indexed by the low bits of their third byte. */
+const unsigned char punctuationClass[64] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xE2 0x80 0x80
+    0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x00, 0x00, // 0xE2 0x80 0x90
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xE2 0x80 0xA0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0xE2 0x80 0xB0
+};
+
+/** \brief letter (a to z, 0 if none) two byte characters starting by 0xC3 fold to, indexed by the low bits of their second byte. */
+const unsigned char latinLetter[64] = {
+    'a', 'a', 'a', 'a', 'a', 'a', 'a', 'c', 'e', 'e', 'e', 'e', 'i', 'i', 'i', 'i', // 0xC3 0x80
+    'd', 'n', 'o', 'o', 'o', 'o', 'o', 0,   'o', 'u', 'u', 'u', 'u', 'y', 0,   's', // 0xC3 0x90
+    'a', 'a', 'a', 'a', 'a', 'a', 'a', 'c', 'e', 'e', 'e', 'e', 'i', 'i', 'i', 'i', // 0xC3 0xA0
+    'd', 'n', 'o', 'o', 'o', 'o', 'o', 0,   'o', 'u', 'u', 'u', 'u', 'y', 0,   'y', // 0xC3 0xB0
+};
+
+/** \brief masks of the bytes of a block of text, one bit per byte */
+struct blockMasks {
+    uint32_t separators;        /**< bytes which are separators */
+    uint32_t wordStarts;        /**< bytes which start a word when found outside of one */
+    uint32_t vowels[VOWELS];    /**< bytes which fold to each vowel */
+};
+
+/** \brief bytes per block of text classified at once by the vector kernels */
+#define BLOCKSIZE 32
+
+/**
+ * @brief Get the letter an UTF8 character folds to, accents and case removed.
+ * 
+ * @param bytes bytes of the UTF8 character
+ * @param size size of the UTF8 character
+ * @return int : index of the letter (0 for a, 25 for z), -1 if the character is not a letter
+ */
+static inline int foldLetter(const unsigned char * bytes, unsigned int size) {
+    if(size == 1) {
+        unsigned char lower = bytes[0] | 0x20;
+        return ((lower >= 'a') && (lower <= 'z')) ? lower - 'a' : -1;
+    }
+    if((size == 2) && (bytes[0] == 0xC3) && ((bytes[1] & 0xC0) == 0x80) && latinLetter[bytes[1] & 0x3F]) {
+        return latinLetter[bytes[1] & 0x3F] - 'a';
+    }
+    return -1;
+}
+
+/**
+ * @brief Get the bin of the word length histogram a word falls in.
  * 
- * @param byte first byte of the character
- * @return unsigned int : size in bytes of the whole character
+ * @param length letters of the word (at least one)
+ * @return int : bin of the word
  */
-unsigned int getLetterSize(unsigned char byte) {
-    unsigned int size = 1;
-    if((byte & 0xF8) == 0xF0) size = 4;
-    else if((byte & 0xF0) == 0xE0) size = 3;
-    else if((byte & 0xE0) == 0xC0) size = 2;
-    else if((byte & 0x80) == 0x00) size = 1;
-    return size;
+static inline int lengthBin(unsigned int length) {
+    return ((length < WORDLENGTH_BINS) ? (int)length : WORDLENGTH_BINS) - 1;
 }
 
 /**
- * @brief Check if UTF8 character is alpha.
+ * @brief Scan the letters of a text chunk one at a time, gathering a set of statistics.
  * 
- * @param bytes array of bytes of UTF8 character
- * @param size size of UTF8 character
- * @return true : UTF8 character is alpha
- * @return false : UTF8 character is not alpha
+ * Instantiated for each set of statistics, which must be a constant, so the tests on it are resolved at compile time.
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops (the last letter scanned may go past it)
+ * @param size size, in bytes, of the text chunk
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ * @param letterCounts output variable, incremented by the number of each letter (STAT_LETTERS only)
+ * @param lengthCounts output variable, incremented by the number of words ended of each length (STAT_LENGTHS only)
+ * @param stats statistics to gather besides the vowels
+ * @return int : position right after the last letter scanned
  */
-bool isAlpha(unsigned char bytes[4], int size) {
-    bool ret = false;
-    if(size == 1) { // a-z and A-Z
-        if(((bytes[0] >= 0x41) && (bytes[0] <= 0x90)) ||
-           ((bytes[0] >= 0x61) && (bytes[0] <= 0x7A))) ret = true;
+static inline __attribute__((always_inline)) int scanLettersWith(const unsigned char * text, int pos, int end, int size,
+        struct wordScan * scan, unsigned int * wordCount, unsigned int * vowelCounts, unsigned int * letterCounts,
+        unsigned int * lengthCounts, const int stats) {
+    unsigned char letter[4];
+    unsigned int step;
+
+    for(; pos < end; pos += step) {
+        const unsigned char * bytes = &text[pos];
+        if(pos + 4 > size) { // letter may be cut by the end of the chunk, do not read past it
+            for(int j = 0; j < 4; j++) letter[j] = (pos + j < size) ? text[pos + j] : 0;
+            bytes = letter;
+        }
+        unsigned char cls = classifyLetter(bytes, &step);
+        if(stats & STAT_LETTERS) {
+            int folded = foldLetter(bytes, step);
+            if(folded >= 0) letterCounts[folded]++;
+        }
+
+        if(scan->inWord) {
+            if(cls & LETTER_SEPARATOR) {
+                scan->inWord = false;
+                if(stats & STAT_LENGTHS) lengthCounts[lengthBin(scan->length)]++;
+                continue;
+            }
+        }
+        else {
+            if(!(cls & LETTER_WORDSTART)) continue;
+            (*wordCount)++;
+            scan->inWord = true;
+            scan->seenVowels = 0;
+            if(stats & STAT_LENGTHS) scan->length = 0;
+        }
+        if(stats & STAT_LENGTHS) scan->length++;
+        unsigned char newVowel = cls & LETTER_VOWELS & ~scan->seenVowels; // a letter folds to one vowel at most
+        if(newVowel) {
+            vowelCounts[__builtin_ctz(newVowel)]++;
+            scan->seenVowels |= newVowel;
+        }
     }
-    else if(size == 2) { // acentos
-        if(bytes[0] == 0xC3) {
-            if(((bytes[1] <= 0xB6) && (bytes[1] >= 0x98)) || 
-            ((bytes[1] <= 0x96) && (bytes[1] >= 0x80)) || 
-            ((bytes[1] <= 0xBF) && (bytes[1] >= 0xB8))) ret = true; 
+    return pos;
+}
+
+/**
+ * @brief Scan the letters of a text chunk one at a time, from a given position until another.
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops (the last letter scanned may go past it)
+ * @param size size, in bytes, of the text chunk
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ * @return int : position right after the last letter scanned
+ */
+static inline int scanLetters(const unsigned char * text, int pos, int end, int size, struct wordScan * scan,
+                              unsigned int * wordCount, unsigned int * vowelCounts) {
+    return scanLettersWith(text, pos, end, size, scan, wordCount, vowelCounts, NULL, NULL, 0);
+}
+
+/**
+ * @brief Scan the word going on at the start of a text, until the separator which ends it.
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops
+ * @param size size, in bytes, of the text chunk
+ * @param scan state of the word scan, inside a word: left outside of it if it ends, its vowels are added to seenVowels
+ * @return int : position right after the separator ending the word (or end, if the word goes on)
+ */
+static int scanWordEnd(const unsigned char * text, int pos, int end, int size, struct wordScan * scan) {
+    unsigned char letter[4];
+    unsigned int step;
+
+    for(; pos < end; pos += step) {
+        unsigned char cls;
+        if(pos + 4 <= size) cls = classifyLetter(&text[pos], &step);
+        else {
+            for(int j = 0; j < 4; j++) letter[j] = (pos + j < size) ? text[pos + j] : 0;
+            cls = classifyLetter(letter, &step);
         }
+        if(cls & LETTER_SEPARATOR) {
+            scan->inWord = false;
+            return pos + step;
+        }
+        scan->seenVowels |= cls & LETTER_VOWELS;
     }
-    return ret;
+    return pos;
 }
 
 /**
- * @brief Check if UTF8 character is a separator.
+ * @brief Mask, in each run of set bits, the bits from the first marked one until the end of the run.
+ * 
+ * Adding the marks makes the carry run from the first mark of each run until its end, which the xor recovers.
  * 
- * @param bytes array of bytes of UTF8 character
- * @param size size of UTF8 character
- * @return true : UTF8 character is separator
- * @return false : UTF8 character is not separator
+ * @param runs runs of set bits
+ * @param marks marked bits (must be a subset of runs)
+ * @return uint32_t : bits of each run from its first mark on
  */
-bool isSeparator(unsigned char bytes[4], int size) {
-    bool ret = false;
-    if(size == 1) {
-        if((bytes[0] == 0x9)  || (bytes[0] == 0xD)  || 
-           (bytes[0] == 0xA)  || (bytes[0] == 0x20) ||
-           (bytes[0] == 0x22) || (bytes[0] == '!')  ||
-           (bytes[0] == '-')  || (bytes[0] == '[')  ||
-           (bytes[0] == ']')  || (bytes[0] == '(')  ||
-           (bytes[0] == ')')  || (bytes[0] == '.')  ||
-           (bytes[0] == ',')  || (bytes[0] == ':')  ||
-           (bytes[0] == ';')  || (bytes[0] == '?')  ) ret = true;
+static inline uint32_t fillFromMark(uint32_t runs, uint32_t marks) {
+    return (uint32_t)((((uint64_t)runs + marks) ^ runs) | marks) & runs;
+}
+
+/**
+ * @brief Scan a block of ASCII text from its byte masks.
+ * 
+ * The bytes of words are the bytes from a word start until the next separator, so words and the vowels they hold
+ * are counted from carries and population counts, with no branch per byte.
+ * 
+ * @param masks masks of the block (no byte may be both a separator and a word start)
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ */
+static inline void scanBlock(const struct blockMasks * masks, struct wordScan * scan, unsigned int * wordCount,
+                             unsigned int * vowelCounts) {
+    uint32_t notSeparators = ~masks->separators;
+    uint32_t carried = scan->inWord ? (notSeparators & 1) : 0; // word going on from the previous block
+    uint32_t words = fillFromMark(notSeparators, masks->wordStarts | carried);
+    uint32_t firstRun = masks->separators ? (masks->separators & -masks->separators) - 1 : ~(uint32_t)0;
+    uint32_t lastRun = masks->separators ? ~(uint32_t)0 << (31 - __builtin_clz(masks->separators)) << 1 : ~(uint32_t)0;
+    bool stillInWord = (words & 0x80000000u) != 0;
+    unsigned char seenVowels = 0;
+
+    *wordCount += __builtin_popcount(words & ~((words << 1) | carried));
+    for(int k = 0; k < VOWELS; k++) {
+        uint32_t vowels = masks->vowels[k];
+        if(!vowels) {
+            if(carried && !masks->separators) seenVowels |= scan->seenVowels & (1 << k); // the word spans the block
+            continue;
+        }
+        uint32_t fromVowel = fillFromMark(words, vowels);
+        unsigned int found = __builtin_popcount(fromVowel & ~(fromVowel << 1));
+        if(carried && (scan->seenVowels & (1 << k)) && (vowels & firstRun)) found--; // already counted for the word
+        vowelCounts[k] += found;
+        if(stillInWord && ((vowels & lastRun) || (carried && !masks->separators && (scan->seenVowels & (1 << k))))) {
+            seenVowels |= 1 << k;
+        }
     }
-    else if(size == 3) {
-        if((bytes[0] == 0xE2) & (bytes[1] == 0x80)) {
-            if((bytes[2] == 0x9C) || (bytes[2] == 0x9D) ||
-               (bytes[2] == 0x93) || (bytes[2] == 0xA6)) ret = true;
+    scan->inWord = stillInWord;
+    scan->seenVowels = seenVowels;
+}
+
+/** \brief kernel scanning a text from a given word state */
+typedef void (*scanKernel)(const unsigned char *, int, struct wordScan *, unsigned int *, unsigned int *);
+
+/** \brief kernel scanning the word going on at the start of a text, until the separator which ends it */
+typedef int (*wordEndKernel)(const unsigned char *, int, int, struct wordScan *);
+
+/** \brief kernels of a CPU feature level */
+struct textKernels {
+    scanKernel scan;            /**< scans a text from a given word state */
+    wordEndKernel wordEnd;      /**< scans the word going on at the start of a text */
+};
+
+/**
+ * @brief Scan a text, one block at a time when possible.
+ * 
+ * Blocks holding only ASCII bytes which are not '[' nor ']' (the only bytes whose meaning depends on the word state)
+ * are scanned from their masks, the others letter by letter.
+ * 
+ * @param text text, starting at a letter boundary
+ * @param size size, in bytes, of the text
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ * @param blockMasksOf function computing the masks of a block, returns false if the block must be scanned letter by letter
+ */
+static inline __attribute__((always_inline)) void scanBlocks(const unsigned char * text, int size, struct wordScan * scan,
+        unsigned int * wordCount, unsigned int * vowelCounts, bool (*blockMasksOf)(const unsigned char *, struct blockMasks *)) {
+    struct blockMasks masks;
+    int pos = 0;
+
+    while(pos + BLOCKSIZE <= size) {
+        if(blockMasksOf(&text[pos], &masks)) {
+            scanBlock(&masks, scan, wordCount, vowelCounts);
+            pos += BLOCKSIZE;
         }
+        else pos = scanLetters(text, pos, pos + BLOCKSIZE, size, scan, wordCount, vowelCounts);
     }
-    return ret;
+    scanLetters(text, pos, size, size, scan, wordCount, vowelCounts);
 }
 
 /**
- * @brief Check if UTF8 character is a vowel, if so, return the vowel without accentuation and lowercase
+ * @brief Scan the word going on at the start of a text, one block at a time when possible.
  * 
- * @param bytes array of bytes of UTF8 character
- * @param size size of UTF8 character
- * @return unsigned char : 'x' if not a vowel, otherwise, vowel with no accentuation and lower-case 
+ * Inside a word every separator ends it, '[' and ']' included, so the word ends at the first separator of the
+ * first block holding one. Blocks which are not plain ASCII are scanned letter by letter.
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops, and size of the text
+ * @param scan state of the word scan, inside a word: left outside of it if it ends, its vowels are added to seenVowels
+ * @param blockMasksOf function computing the masks of a block, returns false if the block must be scanned letter by letter
+ * @return int : position right after the separator ending the word (or end, if the word goes on)
  */
-unsigned char isVowel(unsigned char bytes[4], int size) {
-    char res = 'x'; // x means not a vowel, something else
-    if(size == 1) {
-        if((bytes[0] == 'a') || (bytes[0] == 'e') || 
-           (bytes[0] == 'i') || (bytes[0] == 'o') ||
-           (bytes[0] == 'u') || (bytes[0] == 'y') ) res = bytes[0];
-        else {
-            switch(bytes[0]) {
-                case 'A':
-                    res = 'a';
-                    break;
-                case 'E':
-                    res = 'e';
-                    break;
-                case 'I':
-                    res = 'i';
-                    break;
-                case 'O':
-                    res = 'o';
-                    break;
-                case 'U':
-                    res = 'u';
-                    break;
-                case 'Y':
-                    res = 'y';
-                    break;
-            }
+static inline __attribute__((always_inline)) int wordEndBlocks(const unsigned char * text, int pos, int end,
+        struct wordScan * scan, bool (*blockMasksOf)(const unsigned char *, struct blockMasks *)) {
+    struct blockMasks masks;
+
+    while(pos + BLOCKSIZE <= end) {
+        if(!blockMasksOf(&text[pos], &masks)) {
+            pos = scanWordEnd(text, pos, pos + BLOCKSIZE, end, scan);
+            if(!scan->inWord) return pos;
+            continue;
         }
+        uint32_t inWord = masks.separators ? (masks.separators & -masks.separators) - 1 : ~(uint32_t)0;
+        for(int k = 0; k < VOWELS; k++) if(masks.vowels[k] & inWord) scan->seenVowels |= 1 << k;
+        if(masks.separators) {
+            scan->inWord = false;
+            return pos + __builtin_ctz(masks.separators) + 1;
+        }
+        pos += BLOCKSIZE;
     }
-    else if(size == 2) {
-        if(bytes[0] == 0xC3) {
-            if(((bytes[1] <= 0xA6) && (bytes[1] >= 0xA0)) || 
-            ((bytes[1] <= 0x86) && (bytes[1] >= 0x80))) res = 'a'; 
-            else if(((bytes[1] <= 0xAB) && (bytes[1] >= 0xA8)) || 
-            ((bytes[1] <= 0x8B) && (bytes[1] >= 0x88))) res = 'e';
-            else if(((bytes[1] <= 0xAF) && (bytes[1] >= 0xAC)) || 
-            ((bytes[1] <= 0x8F) && (bytes[1] >= 0x8C))) res = 'i';
-            else if(((bytes[1] <= 0xB6) && (bytes[1] >= 0xB2)) ||
-            ((bytes[1] <= 0x96) && (bytes[1] >= 0x92)) || (bytes[1] == 0xB8) || 
-            (bytes[1] == 0xB0) || (bytes[1] == 0x98)) res = 'o';
-            else if(((bytes[1] <= 0xBC) && (bytes[1] >= 0xB9)) || 
-            ((bytes[1] <= 0x99) && (bytes[1] >= 0x9C))) res = 'u';
-            else if((bytes[1] == 0xBF) || (bytes[1] == 0xBD) || (bytes[1] == 0x9D)) res = 'y';
+    return scanWordEnd(text, pos, end, end, scan);
+}
+
+/**
+ * @brief Scan a text letter by letter (fallback for any CPU).
+ * 
+ * @param text text, starting at a letter boundary
+ * @param size size, in bytes, of the text
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ */
+static void scanScalar(const unsigned char * text, int size, struct wordScan * scan, unsigned int * wordCount,
+                       unsigned int * vowelCounts) {
+    scanLetters(text, 0, size, size, scan, wordCount, vowelCounts);
+}
+
+/**
+ * @brief Scan the word going on at the start of a text letter by letter (fallback for any CPU).
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops, and size of the text
+ * @param scan state of the word scan, inside a word
+ * @return int : position right after the separator ending the word (or end, if the word goes on)
+ */
+static int wordEndScalar(const unsigned char * text, int pos, int end, struct wordScan * scan) {
+    return scanWordEnd(text, pos, end, end, scan);
+}
+
+/** \brief kernels scanning letter by letter */
+static const struct textKernels scalarKernels = {scanScalar, wordEndScalar};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/** \brief separator lookup by low nibble: bit set for each high nibble group (0x0, 0x2, 0x3, 0x5) with a separator */
+#define SEPARATOR_LOW_NIBBLES 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x05, 0x0C, 0x02, 0x0B, 0x02, 0x04
+
+/** \brief separator lookup by high nibble: group bit of the high nibble (0 if no separator has it) */
+#define SEPARATOR_HIGH_NIBBLES 0x01, 0x00, 0x02, 0x04, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+/**
+ * @brief Compute the masks of a block of text with AVX2.
+ * 
+ * @param text block of text
+ * @param masks output variable, masks of the block
+ * @return true : the block is plain ASCII and can be scanned from its masks
+ * @return false : the block must be scanned letter by letter
+ */
+__attribute__((target("avx2"))) static inline bool blockMasksAvx2(const unsigned char * text, struct blockMasks * masks) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)text);
+    if(_mm256_movemask_epi8(bytes)) return false; // not ASCII
+
+    const __m256i lowTable = _mm256_setr_epi8(SEPARATOR_LOW_NIBBLES, SEPARATOR_LOW_NIBBLES);
+    const __m256i highTable = _mm256_setr_epi8(SEPARATOR_HIGH_NIBBLES, SEPARATOR_HIGH_NIBBLES);
+    __m256i low = _mm256_and_si256(bytes, _mm256_set1_epi8(0x0F));
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+    __m256i groups = _mm256_and_si256(_mm256_shuffle_epi8(lowTable, low), _mm256_shuffle_epi8(highTable, high));
+    masks->separators = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(groups, _mm256_setzero_si256()));
+    masks->wordStarts = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(0x40)));
+    if(masks->separators & masks->wordStarts) return false; // '[' or ']'
+
+    __m256i folded = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+    static const char vowelLetters[VOWELS] = {'a', 'e', 'i', 'o', 'u', 'y'};
+    for(int k = 0; k < VOWELS; k++) {
+        masks->vowels[k] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8(vowelLetters[k])));
+    }
+    return true;
+}
+
+/**
+ * @brief Compute the masks of a block of text with SSE4.2, 16 bytes at a time.
+ * 
+ * @param text block of text
+ * @param masks output variable, masks of the block
+ * @return true : the block is plain ASCII and can be scanned from its masks
+ * @return false : the block must be scanned letter by letter
+ */
+__attribute__((target("sse4.2"))) static inline bool blockMasksSse42(const unsigned char * text, struct blockMasks * masks) {
+    __m128i bytes[2] = {_mm_loadu_si128((const __m128i *)text), _mm_loadu_si128((const __m128i *)(text + 16))};
+    if(_mm_movemask_epi8(_mm_or_si128(bytes[0], bytes[1]))) return false; // not ASCII
+
+    const __m128i lowTable = _mm_setr_epi8(SEPARATOR_LOW_NIBBLES);
+    const __m128i highTable = _mm_setr_epi8(SEPARATOR_HIGH_NIBBLES);
+    static const char vowelLetters[VOWELS] = {'a', 'e', 'i', 'o', 'u', 'y'};
+    masks->separators = 0;
+    masks->wordStarts = 0;
+    for(int k = 0; k < VOWELS; k++) masks->vowels[k] = 0;
+    for(int h = 0; h < 2; h++) {
+        __m128i low = _mm_and_si128(bytes[h], _mm_set1_epi8(0x0F));
+        __m128i high = _mm_and_si128(_mm_srli_epi16(bytes[h], 4), _mm_set1_epi8(0x0F));
+        __m128i groups = _mm_and_si128(_mm_shuffle_epi8(lowTable, low), _mm_shuffle_epi8(highTable, high));
+        masks->separators |= (uint32_t)(~_mm_movemask_epi8(_mm_cmpeq_epi8(groups, _mm_setzero_si128())) & 0xFFFF) << (16 * h);
+        masks->wordStarts |= (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(bytes[h], _mm_set1_epi8(0x40))) << (16 * h);
+        __m128i folded = _mm_or_si128(bytes[h], _mm_set1_epi8(0x20));
+        for(int k = 0; k < VOWELS; k++) {
+            masks->vowels[k] |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, _mm_set1_epi8(vowelLetters[k]))) << (16 * h);
         }
     }
-    return res;
+    return !(masks->separators & masks->wordStarts); // '[' or ']' must be scanned letter by letter
+}
+
+/**
+ * @brief Scan a text with the AVX2 block kernel.
+ * 
+ * @param text text, starting at a letter boundary
+ * @param size size, in bytes, of the text
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ */
+__attribute__((target("avx2"))) static void scanAvx2(const unsigned char * text, int size, struct wordScan * scan,
+                                                     unsigned int * wordCount, unsigned int * vowelCounts) {
+    scanBlocks(text, size, scan, wordCount, vowelCounts, blockMasksAvx2);
+}
+
+/**
+ * @brief Scan the word going on at the start of a text with the AVX2 block kernel.
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops, and size of the text
+ * @param scan state of the word scan, inside a word
+ * @return int : position right after the separator ending the word (or end, if the word goes on)
+ */
+__attribute__((target("avx2"))) static int wordEndAvx2(const unsigned char * text, int pos, int end, struct wordScan * scan) {
+    return wordEndBlocks(text, pos, end, scan, blockMasksAvx2);
+}
+
+/** \brief kernels of CPUs with AVX2 */
+static const struct textKernels avx2Kernels = {scanAvx2, wordEndAvx2};
+
+/**
+ * @brief Scan a text with the SSE4.2 block kernel.
+ * 
+ * @param text text, starting at a letter boundary
+ * @param size size, in bytes, of the text
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ */
+__attribute__((target("sse4.2"))) static void scanSse42(const unsigned char * text, int size, struct wordScan * scan,
+                                                        unsigned int * wordCount, unsigned int * vowelCounts) {
+    scanBlocks(text, size, scan, wordCount, vowelCounts, blockMasksSse42);
+}
+
+/**
+ * @brief Scan the word going on at the start of a text with the SSE4.2 block kernel.
+ * 
+ * @param text text chunk
+ * @param pos position of the first letter to scan
+ * @param end position at which scanning stops, and size of the text
+ * @param scan state of the word scan, inside a word
+ * @return int : position right after the separator ending the word (or end, if the word goes on)
+ */
+__attribute__((target("sse4.2"))) static int wordEndSse42(const unsigned char * text, int pos, int end, struct wordScan * scan) {
+    return wordEndBlocks(text, pos, end, scan, blockMasksSse42);
+}
+
+/** \brief kernels of CPUs with SSE4.2 */
+static const struct textKernels sse42Kernels = {scanSse42, wordEndSse42};
+
+#endif
+
+/**
+ * @brief Get the kernels of a CPU feature level, if the CPU supports it.
+ * 
+ * @param name scalar, sse4.2 or avx2
+ * @return kernels scanning a text, NULL if the name is unknown or the CPU lacks the features
+ */
+static const struct textKernels * namedKernels(const char * name) {
+    if(strcmp(name, "scalar") == 0) return &scalarKernels;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if((strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")) return &avx2Kernels;
+    if((strcmp(name, "sse4.2") == 0) && __builtin_cpu_supports("sse4.2")) return &sse42Kernels;
+#endif
+    return NULL;
+}
+
+/**
+ * @brief Pick the fastest kernels supported by the CPU.
+ * 
+ * @return kernels scanning a text
+ */
+static const struct textKernels * selectKernels(void) {
+    char * forced = getenv("PROG1_KERNEL"); // scalar, sse4.2 or avx2, to compare kernels
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(((forced == NULL) || (strcmp(forced, "avx2") == 0)) && __builtin_cpu_supports("avx2")) return &avx2Kernels;
+    if(((forced == NULL) || (strcmp(forced, "avx2") == 0) || (strcmp(forced, "sse4.2") == 0)) && __builtin_cpu_supports("sse4.2")) {
+        return &sse42Kernels;
+    }
+#else
+    (void)forced;
+#endif
+    return &scalarKernels;
+}
+
+/** \brief kernels in use, picked at the first call of textKernels unless set by useKernels */
+static _Atomic(const struct textKernels *) pickedKernels = NULL;
+
+/**
+ * @brief Get the fastest kernels, picked once, at the first call, from the CPU features.
+ * 
+ * @return kernels scanning a text
+ */
+static const struct textKernels * textKernels(void) {
+    const struct textKernels * kernels = pickedKernels;
+
+    if(kernels == NULL) pickedKernels = kernels = selectKernels(); // every thread picks the same ones, so racing is harmless
+    return kernels;
+}
+
+/**
+ * @brief Use the kernels of a given CPU feature level from now on, to compare them.
+ * 
+ * Not meant to be called while other threads scan text.
+ * 
+ * @param name scalar, sse4.2 or avx2
+ * @return true if the kernels are in use, false if the name is unknown or the CPU lacks the features
+ */
+bool useKernels(const char * name) {
+    const struct textKernels * kernels = namedKernels(name);
+
+    if(kernels == NULL) return false;
+    pickedKernels = kernels;
+    return true;
+}
+
+/**
+ * @brief Scan a text with the fastest kernel, picked once, at the first call, from the CPU features.
+ * 
+ * @param text text, starting at a letter boundary
+ * @param size size, in bytes, of the text
+ * @param scan state of the word scan
+ * @param wordCount output variable, incremented by the number of words started
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel
+ */
+static void scanText(const unsigned char * text, int size, struct wordScan * scan, unsigned int * wordCount,
+                     unsigned int * vowelCounts) {
+    textKernels()->scan(text, size, scan, wordCount, vowelCounts);
+}
+
+/**
+ * @brief Count the words of a text chunk and, for each vowel, the words holding it.
+ * 
+ * The kernel is picked once, at the first call, from the CPU features: AVX2, SSE4.2 or letter by letter.
+ * 
+ * @param text text chunk, starting outside of a word
+ * @param size size, in bytes, of the text chunk
+ * @param wordCount output variable, incremented by the number of words in the text chunk
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel (a, e, i, o, u, y)
+ */
+void countWords(const unsigned char * text, int size, unsigned int * wordCount, unsigned int * vowelCounts) {
+    struct wordScan scan = {false, 0, 0};
+    scanText(text, size, &scan, wordCount, vowelCounts);
+}
+
+/**
+ * @brief Set aside the letters cut by either end of a chunk.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk, zeroed but for its cut letters
+ * @param pos output variable, position of the first letter of the chunk
+ * @param end output variable, position of the letter cut by the chunk end (size if none)
+ */
+static void cutLetters(const unsigned char * text, int size, struct chunkSummary * summary, int * pos, int * end) {
+    memset(summary, 0, sizeof(struct chunkSummary));
+    *pos = 0;
+    *end = size;
+    while((*pos < size) && (*pos < 3) && ((text[*pos] & 0xC0) == 0x80)) { // end of the letter cut by the chunk start
+        summary->head[summary->headSize++] = text[(*pos)++];
+    }
+    summary->hasLetters = (*pos < size);
+    for(int last = size - 1; (last >= *pos) && (last >= size - 3); last--) { // start of the letter cut by the chunk end
+        if((text[last] & 0xC0) == 0x80) continue;
+        if(last + letterSize[text[last]] > size) {
+            *end = last;
+            summary->tailSize = size - last;
+            memcpy(summary->tail, &text[last], summary->tailSize);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Summarize a chunk of text cut at arbitrary byte offsets.
+ * 
+ * The chunk is scanned as if it started both outside and inside of a word. Both scans meet at the first separator
+ * (a bracket may delay it, it only ends words), from there on a single scan serves both cases. The letters cut by
+ * either end of the chunk are kept aside, to be scanned when the chunks are folded.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk
+ */
+void summarizeChunk(const unsigned char * text, int size, struct chunkSummary * summary) {
+    int pos, end;
+
+    cutLetters(text, size, summary, &pos, &end);
+    struct wordScan fresh = {false, 0, 0}, continued = {true, 0, 0};
+    int meet = textKernels()->wordEnd(text, pos, end, &continued);
+    summary->continuedVowels = continued.seenVowels;
+    summary->continuedThrough = continued.inWord;
+    if(!continued.inWord) continued.seenVowels = 0;
+    scanText(&text[pos], meet - pos, &fresh, &summary->words[0], summary->vowels[0]); // meet is a letter boundary
+    for(pos = meet; (pos < end) && ((fresh.inWord != continued.inWord) || (fresh.inWord && (fresh.seenVowels != continued.seenVowels)));) {
+        int next = scanLetters(text, pos, pos + 1, end, &fresh, &summary->words[0], summary->vowels[0]);
+        scanLetters(text, pos, pos + 1, end, &continued, &summary->words[1], summary->vowels[1]);
+        pos = next;
+    }
+
+    if(pos < end) { // both scans met, the rest of the chunk is scanned once
+        unsigned int words = 0, vowels[VOWELS] = {0};
+        scanText(&text[pos], end - pos, &fresh, &words, vowels);
+        continued = fresh;
+        for(int b = 0; b < 2; b++) {
+            summary->words[b] += words;
+            for(int k = 0; k < VOWELS; k++) summary->vowels[b][k] += vowels[k];
+        }
+    }
+    summary->exitInWord[0] = fresh.inWord;
+    summary->exitVowels[0] = fresh.inWord ? fresh.seenVowels : 0; // kernels may leave the vowels of an ended word
+    summary->exitInWord[1] = continued.inWord;
+    summary->exitVowels[1] = continued.inWord ? continued.seenVowels : 0;
+}
+
+/**
+ * @brief Summarize a chunk of text cut at arbitrary byte offsets, gathering a set of statistics letter by letter.
+ * 
+ * Same scans as summarizeChunk's. The word going on at the chunk start is scanned on its own, so its length is kept
+ * apart from those of the words ended in the chunk; letters are only counted by the scan starting outside of a word.
+ * Instantiated for each set of statistics, which must be a constant.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk
+ * @param extra output variable, letters and word lengths of the text chunk
+ * @param stats statistics to gather besides the vowels
+ */
+static inline __attribute__((always_inline)) void summarizeChunkWith(const unsigned char * text, int size,
+        struct chunkSummary * summary, struct chunkStats * extra, const int stats) {
+    int pos, end;
+    unsigned int ignoredWords = 0, ignoredVowels[VOWELS] = {0};
+
+    cutLetters(text, size, summary, &pos, &end);
+    memset(extra, 0, sizeof(struct chunkStats));
+    struct wordScan fresh = {false, 0, 0}, continued = {true, 0, 0};
+    int meet = pos;
+    while((meet < end) && continued.inWord) { // the word going on, its vowels and letters are not new
+        meet = scanLettersWith(text, meet, meet + 1, end, &continued, &ignoredWords, ignoredVowels, NULL, NULL, 0);
+        if(continued.inWord) continued.length++;
+    }
+    summary->continuedVowels = continued.seenVowels;
+    summary->continuedThrough = continued.inWord;
+    extra->continuedLength = continued.length;
+    if(!continued.inWord) continued.seenVowels = 0;
+    scanLettersWith(text, pos, meet, end, &fresh, &summary->words[0], summary->vowels[0], extra->letters,
+                    extra->lengths[0], stats);
+    for(pos = meet; (pos < end) && ((fresh.inWord != continued.inWord) || (fresh.inWord &&
+        ((fresh.seenVowels != continued.seenVowels) || ((stats & STAT_LENGTHS) && (fresh.length != continued.length)))));) {
+        int next = scanLettersWith(text, pos, pos + 1, end, &fresh, &summary->words[0], summary->vowels[0],
+                                   extra->letters, extra->lengths[0], stats);
+        scanLettersWith(text, pos, pos + 1, end, &continued, &summary->words[1], summary->vowels[1], NULL,
+                        extra->lengths[1], stats & STAT_LENGTHS);
+        pos = next;
+    }
+
+    if(pos < end) { // both scans met, the rest of the chunk is scanned once
+        unsigned int words = 0, vowels[VOWELS] = {0}, lengths[WORDLENGTH_BINS] = {0};
+        scanLettersWith(text, pos, end, end, &fresh, &words, vowels, extra->letters, lengths, stats);
+        continued = fresh;
+        for(int b = 0; b < 2; b++) {
+            summary->words[b] += words;
+            for(int k = 0; k < VOWELS; k++) summary->vowels[b][k] += vowels[k];
+            if(stats & STAT_LENGTHS) for(int l = 0; l < WORDLENGTH_BINS; l++) extra->lengths[b][l] += lengths[l];
+        }
+    }
+    summary->exitInWord[0] = fresh.inWord;
+    summary->exitVowels[0] = fresh.inWord ? fresh.seenVowels : 0; // kernels may leave the vowels of an ended word
+    summary->exitInWord[1] = continued.inWord;
+    summary->exitVowels[1] = continued.inWord ? continued.seenVowels : 0;
+    extra->exitLength[0] = fresh.length;
+    extra->exitLength[1] = continued.length;
+}
+
+/**
+ * @brief Summarize a chunk of text, gathering its letters.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk
+ * @param extra output variable, letters of the text chunk
+ */
+static void summarizeLetters(const unsigned char * text, int size, struct chunkSummary * summary, struct chunkStats * extra) {
+    summarizeChunkWith(text, size, summary, extra, STAT_LETTERS);
+}
+
+/**
+ * @brief Summarize a chunk of text, gathering its word lengths.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk
+ * @param extra output variable, word lengths of the text chunk
+ */
+static void summarizeLengths(const unsigned char * text, int size, struct chunkSummary * summary, struct chunkStats * extra) {
+    summarizeChunkWith(text, size, summary, extra, STAT_LENGTHS);
+}
+
+/**
+ * @brief Summarize a chunk of text, gathering its letters and word lengths.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk
+ * @param extra output variable, letters and word lengths of the text chunk
+ */
+static void summarizeLettersLengths(const unsigned char * text, int size, struct chunkSummary * summary,
+                                    struct chunkStats * extra) {
+    summarizeChunkWith(text, size, summary, extra, STAT_LETTERS | STAT_LENGTHS);
+}
+
+/**
+ * @brief Summarize a chunk of text cut at arbitrary byte offsets, gathering a set of statistics.
+ * 
+ * Only the vowel counts are gathered by summarizeChunk itself; the letters and word lengths are gathered letter by
+ * letter, by the instance of the kernel which only computes the statistics asked for.
+ * 
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param stats statistics to gather, STAT_VOWELS with STAT_LETTERS and/or STAT_LENGTHS
+ * @param summary output variable, summary of the text chunk
+ * @param extra output variable, letters and word lengths of the text chunk (untouched if not asked for)
+ */
+void summarizeChunkStats(const unsigned char * text, int size, int stats, struct chunkSummary * summary,
+                         struct chunkStats * extra) {
+    switch(stats & (STAT_LETTERS | STAT_LENGTHS)) {
+        case STAT_LETTERS:
+            summarizeLetters(text, size, summary, extra);
+            break;
+        case STAT_LENGTHS:
+            summarizeLengths(text, size, summary, extra);
+            break;
+        case STAT_LETTERS | STAT_LENGTHS:
+            summarizeLettersLengths(text, size, summary, extra);
+            break;
+        default:
+            summarizeChunk(text, size, summary);
+    }
+}
+
+/**
+ * @brief Scan the letters cut between chunks, gathering a set of statistics.
+ * 
+ * @param tally running counts
+ * @param extra running statistics (STAT_LETTERS or STAT_LENGTHS only)
+ * @param bytes bytes of the letters
+ * @param size number of bytes
+ * @param whole true if no more bytes of these letters may follow, false to keep an incomplete last letter pending
+ * @param stats statistics to gather besides the vowels
+ */
+static inline __attribute__((always_inline)) void scanPendingWith(struct wordTally * tally, struct statsTally * extra,
+        const unsigned char * bytes, int size, bool whole, const int stats) {
+    int pos = 0;
+    unsigned int words = 0, vowels[VOWELS] = {0}, letters[LETTER_NUM] = {0}, lengths[WORDLENGTH_BINS] = {0};
+
+    while(pos < size) {
+        if(!whole && (pos + letterSize[bytes[pos]] > size)) break;
+        pos = scanLettersWith(bytes, pos, pos + 1, size, &tally->scan, &words, vowels, letters, lengths, stats);
+    }
+    tally->words += words;
+    for(int k = 0; k < VOWELS; k++) tally->vowels[k] += vowels[k];
+    if(stats & STAT_LETTERS) for(int l = 0; l < LETTER_NUM; l++) extra->letters[l] += letters[l];
+    if(stats & STAT_LENGTHS) for(int l = 0; l < WORDLENGTH_BINS; l++) extra->lengths[l] += lengths[l];
+    tally->pendingSize = (pos < size) ? size - pos : 0;
+    memcpy(tally->pending, &bytes[pos < size ? pos : size], tally->pendingSize);
+}
+
+/**
+ * @brief Fold the summary and statistics of the next chunk of a text into its running counts.
+ * 
+ * Instantiated for each set of statistics, which must be a constant.
+ * 
+ * @param tally running counts of the text up to the chunk (zeroed before the first chunk)
+ * @param extra running statistics of the text up to the chunk (STAT_LETTERS or STAT_LENGTHS only)
+ * @param summary summary of the chunk
+ * @param chunkExtra statistics of the chunk (STAT_LETTERS or STAT_LENGTHS only)
+ * @param stats statistics gathered besides the vowels
+ */
+static inline __attribute__((always_inline)) void foldChunkWith(struct wordTally * tally, struct statsTally * extra,
+        const struct chunkSummary * summary, const struct chunkStats * chunkExtra, const int stats) {
+    unsigned char cut[6];
+    int cutSize = tally->pendingSize;
+
+    memcpy(cut, tally->pending, tally->pendingSize);
+    memcpy(&cut[cutSize], summary->head, summary->headSize);
+    cutSize += summary->headSize;
+    scanPendingWith(tally, extra, cut, cutSize, summary->hasLetters, stats);
+    if(!summary->hasLetters) return;
+
+    int b = tally->scan.inWord ? 1 : 0;
+    tally->words += summary->words[b];
+    for(int k = 0; k < VOWELS; k++) tally->vowels[k] += summary->vowels[b][k];
+    if(b) { // the word going on gets the vowels it had not found yet
+        unsigned char newVowels = summary->continuedVowels & ~tally->scan.seenVowels;
+        for(int k = 0; k < VOWELS; k++) if(newVowels & (1 << k)) tally->vowels[k]++;
+    }
+    if(stats & STAT_LETTERS) for(int l = 0; l < LETTER_NUM; l++) extra->letters[l] += chunkExtra->letters[l];
+    if(stats & STAT_LENGTHS) {
+        if(b) { // the word going on gets the letters it has in the chunk, and is counted if it ends there
+            tally->scan.length += chunkExtra->continuedLength;
+            if(!summary->continuedThrough) extra->lengths[lengthBin(tally->scan.length)]++;
+        }
+        for(int l = 0; l < WORDLENGTH_BINS; l++) extra->lengths[l] += chunkExtra->lengths[b][l];
+    }
+    if(b && summary->continuedThrough) tally->scan.seenVowels |= summary->continuedVowels;
+    else {
+        tally->scan.inWord = summary->exitInWord[b];
+        tally->scan.seenVowels = summary->exitVowels[b];
+        if(stats & STAT_LENGTHS) tally->scan.length = chunkExtra->exitLength[b];
+    }
+    tally->pendingSize = summary->tailSize;
+    memcpy(tally->pending, summary->tail, summary->tailSize);
+}
+
+/**
+ * @brief Fold the summary of the next chunk of a text into its running counts.
+ * 
+ * @param tally running counts of the text up to the chunk (zeroed before the first chunk)
+ * @param summary summary of the chunk
+ */
+void foldChunk(struct wordTally * tally, const struct chunkSummary * summary) {
+    foldChunkWith(tally, NULL, summary, NULL, 0);
+}
+
+/**
+ * @brief Fold the summary and statistics of the next chunk of a text into its running counts.
+ * 
+ * @param tally running counts of the text up to the chunk (zeroed before the first chunk)
+ * @param extra running statistics of the text up to the chunk (zeroed before the first chunk)
+ * @param summary summary of the chunk
+ * @param chunkExtra statistics of the chunk (may be NULL if only the vowels are gathered)
+ * @param stats statistics gathered, as given to summarizeChunkStats
+ */
+void foldChunkStats(struct wordTally * tally, struct statsTally * extra, const struct chunkSummary * summary,
+                    const struct chunkStats * chunkExtra, int stats) {
+    switch(stats & (STAT_LETTERS | STAT_LENGTHS)) {
+        case STAT_LETTERS:
+            foldChunkWith(tally, extra, summary, chunkExtra, STAT_LETTERS);
+            break;
+        case STAT_LENGTHS:
+            foldChunkWith(tally, extra, summary, chunkExtra, STAT_LENGTHS);
+            break;
+        case STAT_LETTERS | STAT_LENGTHS:
+            foldChunkWith(tally, extra, summary, chunkExtra, STAT_LETTERS | STAT_LENGTHS);
+            break;
+        default:
+            foldChunkWith(tally, extra, summary, chunkExtra, 0);
+    }
+}
+
+/**
+ * @brief Finish the running counts of a text once all of its chunks were folded.
+ * 
+ * @param tally running counts of the text
+ */
+void finishTally(struct wordTally * tally) {
+    unsigned char cut[3];
+    int cutSize = tally->pendingSize;
+
+    memcpy(cut, tally->pending, cutSize);
+    scanPendingWith(tally, NULL, cut, cutSize, true, 0); // a letter cut by the end of the text is scanned as is
+}
+
+/**
+ * @brief Finish the running counts and statistics of a text once all of its chunks were folded.
+ * 
+ * The word the text ends inside is only counted in the word length histogram here.
+ * 
+ * @param tally running counts of the text
+ * @param extra running statistics of the text
+ * @param stats statistics gathered, as given to summarizeChunkStats
+ */
+void finishTallyStats(struct wordTally * tally, struct statsTally * extra, int stats) {
+    unsigned char cut[3];
+    int cutSize = tally->pendingSize;
+
+    memcpy(cut, tally->pending, cutSize);
+    switch(stats & (STAT_LETTERS | STAT_LENGTHS)) {
+        case STAT_LETTERS:
+            scanPendingWith(tally, extra, cut, cutSize, true, STAT_LETTERS);
+            break;
+        case STAT_LENGTHS:
+            scanPendingWith(tally, extra, cut, cutSize, true, STAT_LENGTHS);
+            break;
+        case STAT_LETTERS | STAT_LENGTHS:
+            scanPendingWith(tally, extra, cut, cutSize, true, STAT_LETTERS | STAT_LENGTHS);
+            break;
+        default:
+            scanPendingWith(tally, extra, cut, cutSize, true, 0);
+    }
+    if((stats & STAT_LENGTHS) && tally->scan.inWord) {
+        extra->lengths[lengthBin(tally->scan.length)]++;
+        tally->scan.inWord = false;
+    }
+}
+
+/**
+ * @brief Parse a set of statistics given on the command line.
+ * 
+ * @param arg comma-separated list of vowels, letters and lengths (or all)
+ * @param stats output variable, STAT_VOWELS combined with the statistics listed
+ * @return true if every statistic listed is known, false otherwise
+ */
+bool parseStats(const char * arg, int * stats) {
+    int parsed = STAT_VOWELS;
+
+    while(*arg != '\0') {
+        size_t length = strcspn(arg, ",");
+        if((length == 6) && (strncmp(arg, "vowels", length) == 0)) parsed |= STAT_VOWELS;
+        else if((length == 7) && (strncmp(arg, "letters", length) == 0)) parsed |= STAT_LETTERS;
+        else if((length == 7) && (strncmp(arg, "lengths", length) == 0)) parsed |= STAT_LENGTHS;
+        else if((length == 3) && (strncmp(arg, "all", length) == 0)) parsed |= STAT_VOWELS | STAT_LETTERS | STAT_LENGTHS;
+        else return false;
+        arg += length;
+        if(*arg == ',') arg++;
+    }
+    *stats = parsed;
+    return true;
+}
+
+/**
+ * @brief Parse a chunk size given on the command line.
+ * 
+ * @param arg number of bytes, optionally followed by K or M, or "auto"
+ * @param size output variable, chunk size in bytes (0 for auto)
+ * @return true if the chunk size is valid and between CHUNKSIZE_MIN and CHUNKSIZE_MAX, false otherwise
+ */
+bool parseChunkSize(const char * arg, unsigned int * size) {
+    char * end;
+
+    if(strcmp(arg, "auto") == 0) {
+        *size = 0;
+        return true;
+    }
+    unsigned long long bytes = strtoull(arg, &end, 10);
+    if(end == arg) return false;
+    if((*end == 'K') || (*end == 'k')) {
+        bytes *= 1024;
+        end++;
+    }
+    else if((*end == 'M') || (*end == 'm')) {
+        bytes *= 1024 * 1024;
+        end++;
+    }
+    if((*end != '\0') || (bytes < CHUNKSIZE_MIN) || (bytes > CHUNKSIZE_MAX)) return false;
+    *size = (unsigned int)bytes;
+    return true;
+}
+
+/**
+ * @brief Pick a chunk size for a set of files, from the throughput measured on their first bytes.
+ * 
+ * The first bytes of the first non-empty file are read and summarized in chunks, and timed. Chunks are made large
+ * enough for handing them out to cost a small share of their time, but small enough for every worker to get several
+ * of them.
+ * 
+ * @param names names of the files
+ * @param nFiles number of files
+ * @param nWorkers number of workers sharing the chunks
+ * @param chunkCost fixed cost, in seconds, of handing a chunk to a worker
+ * @return unsigned int : chunk size in bytes, a power of two between CHUNKSIZE_MIN and CHUNKSIZE_MAX
+ */
+unsigned int tuneChunkSize(char ** names, int nFiles, int nWorkers, double chunkCost) {
+    double totalSize = 0, throughput = 0;
+    int probe = -1;
+    struct stat st;
+
+    int step = (nFiles + TUNESAMPLEFILES - 1) / TUNESAMPLEFILES; // long lists are sampled, not stat'ed twice
+    for(int i = 0; i < nFiles; i += step) {
+        if((stat(names[i], &st) == -1) || (st.st_size == 0)) continue;
+        totalSize += (double)st.st_size * step;
+        if(probe < 0) probe = i;
+    }
+
+    FILE * fp;
+    unsigned char * text;
+    if((probe >= 0) && ((text = (unsigned char *)malloc(TUNEPROBESIZE)) != NULL)) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if((fp = fopen(names[probe], "rb")) != NULL) {
+            size_t bytesRead = fread(text, 1, TUNEPROBESIZE, fp);
+            fclose(fp);
+            struct chunkSummary summary;
+            for(size_t pos = 0; pos < bytesRead; pos += TUNEPROBECHUNK) {
+                summarizeChunk(&text[pos], (bytesRead - pos < TUNEPROBECHUNK) ? bytesRead - pos : TUNEPROBECHUNK, &summary);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double elapsed = (double)(t1.tv_sec - t0.tv_sec) + 1.0e-9 * (double)(t1.tv_nsec - t0.tv_nsec);
+            if(elapsed > 0) throughput = (double)bytesRead / elapsed;
+        }
+        free(text);
+    }
+
+    double size = (throughput > 0) ? throughput * chunkCost / TUNEOVERHEAD : CHUNKSIZE_MAX;
+    if((nWorkers > 0) && (size > totalSize / (nWorkers * TUNECHUNKSPERWORKER))) {
+        size = totalSize / (nWorkers * TUNECHUNKSPERWORKER); // keep the load balanced
+    }
+    unsigned int chunkSize = CHUNKSIZE_MIN;
+    while((chunkSize < CHUNKSIZE_MAX) && (2.0 * chunkSize <= size)) chunkSize *= 2;
+    return chunkSize;
 }
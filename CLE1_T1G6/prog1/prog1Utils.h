@@ -3,61 +3,270 @@
  * @author Afonso Campos (afonso.campos@ua.pt)
  * @author Simão Arrais (simaoarrais@ua.pt)
  * @brief Problem name: Vowel Count.
- * 
+ *
  * Utility functions for UTF8 text processing.
- * 
+ *
+ * Letters are classified in a single step by precomputed lookup tables, which give the letter size, whether it is a
+ * separator or starts a word and the vowel it folds to. Shared by the pthread (CLE1) and MPI (CLE2) programs.
+ *
+ * Text may also be cut at any byte offset: each chunk is then summarized on its own and the summaries are folded in
+ * order, which gives the same counts as scanning the whole text at once.
+ *
+ * Besides the words holding each vowel, the letters of the text and the lengths of its words may be gathered in the
+ * same pass. Each set of statistics has its own instance of the kernel, so those not asked for cost nothing.
+ *
  * Functions:
- *     \li getLetterSize
- *     \li isAlpha
- *     \li isSeparator
- *     \li isVowel.
- * 
+ *     \li classifyLetter
+ *     \li useKernels
+ *     \li countWords
+ *     \li summarizeChunk
+ *     \li foldChunk
+ *     \li finishTally
+ *     \li summarizeChunkStats
+ *     \li foldChunkStats
+ *     \li finishTallyStats
+ *     \li parseStats
+ *     \li parseChunkSize
+ *     \li tuneChunkSize.
+ *
  * @version 0.1
  * @date 2023-03-22
- * 
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
 #ifndef PROG1_UTILS_H
 #define PROG1_UTILS_H
 
 #include <stdbool.h>
 
+/** \brief letter class flag: the letter is a separator. */
+#define LETTER_SEPARATOR 0x80
+
+/** \brief letter class flag: the letter starts a word when found outside of one (alpha or underscore). */
+#define LETTER_WORDSTART 0x40
+
+/** \brief letter class mask: vowel the letter folds to (accents and case removed), bit i for the i-th of a, e, i, o, u, y. */
+#define LETTER_VOWELS 0x3F
+
+/** \brief smallest chunk size, in bytes, which may be asked for. */
+#define CHUNKSIZE_MIN (4 * 1024)
+
+/** \brief largest chunk size, in bytes, which may be asked for. */
+#define CHUNKSIZE_MAX (64 * 1024 * 1024)
+
+/** \brief number of vowels told apart by the letter classes. */
+#define LETTER_VOWELNUM 6
+
+/** \brief number of letters counted, a to z (accents and case removed). */
+#define LETTER_NUM 26
+
+/** \brief number of bins of the word length histogram, the last one holding the words of that many letters or more. */
+#define WORDLENGTH_BINS 32
+
+/** \brief statistic: words and, for each vowel, the words holding it (always gathered). */
+#define STAT_VOWELS 0x1
+
+/** \brief statistic: number of each letter, a to z. */
+#define STAT_LETTERS 0x2
+
+/** \brief statistic: histogram of the word lengths, in letters (UTF8 characters). */
+#define STAT_LENGTHS 0x4
+
+/** \brief state of a word scan, carried from letter to letter. */
+struct wordScan {
+    bool inWord;                /**< the last letter scanned belongs to a word */
+    unsigned char seenVowels;   /**< vowels already found in the current word (LETTER_VOWELS bits) */
+    unsigned int length;        /**< letters of the current word so far (only kept when gathering word lengths) */
+};
+
+/** \brief summary of a chunk of text cut at arbitrary byte offsets, for both word states the chunk may start in. */
+struct chunkSummary {
+    unsigned char head[3];                          /**< continuation bytes ending the letter cut by the chunk start */
+    unsigned char headSize;                         /**< number of bytes in head */
+    unsigned char tail[3];                          /**< first bytes of the letter cut by the chunk end */
+    unsigned char tailSize;                         /**< number of bytes in tail */
+    bool hasLetters;                                /**< the chunk holds more than the end of a cut letter */
+    unsigned int words[2];                          /**< words started, for a chunk starting outside [0] or inside [1] a word */
+    unsigned int vowels[2][LETTER_VOWELNUM];        /**< words started holding each vowel, likewise */
+    unsigned char continuedVowels;                  /**< vowels found in the word going on at the chunk start */
+    bool continuedThrough;                          /**< the word going on at the chunk start does not end in it */
+    bool exitInWord[2];                             /**< the chunk ends inside a word, likewise */
+    unsigned char exitVowels[2];                    /**< vowels found in the word the chunk ends inside, likewise */
+};
+
+/** \brief statistics of a chunk gathered besides its summary, likewise. */
+struct chunkStats {
+    unsigned int letters[LETTER_NUM];               /**< letters of the chunk (those cut by either end aside) */
+    unsigned int lengths[2][WORDLENGTH_BINS];       /**< words ended in the chunk by length, for a chunk starting outside [0] or inside [1] a word (the word going on at the start aside) */
+    unsigned int continuedLength;                   /**< letters of the word going on at the chunk start, within the chunk */
+    unsigned int exitLength[2];                     /**< letters of the word the chunk ends inside, likewise */
+};
+
+/** \brief running counts of a text whose chunk summaries are folded in order. */
+struct wordTally {
+    unsigned long long words;                       /**< number of words */
+    unsigned long long vowels[LETTER_VOWELNUM];     /**< number of words holding each vowel */
+    struct wordScan scan;                           /**< word state at the end of the last chunk folded */
+    unsigned char pending[3];                       /**< first bytes of a letter cut by the end of the last chunk */
+    unsigned char pendingSize;                      /**< number of bytes in pending */
+};
+
+/** \brief running statistics of a text gathered besides its word and vowel counts. */
+struct statsTally {
+    unsigned long long letters[LETTER_NUM];         /**< number of each letter */
+    unsigned long long lengths[WORDLENGTH_BINS];    /**< number of words of each length, from one letter on */
+};
+
+/** \brief size, in bytes, of an UTF8 character announced by its first byte. */
+extern const unsigned char letterSize[256];
+
+/** \brief class of one byte characters indexed by the byte (0 for the first byte of longer characters). */
+extern const unsigned char oneByteClass[256];
+
+/** \brief class of two byte characters starting by 0xC3 (Latin-1 letters) indexed by the low bits of their second byte. */
+extern const unsigned char latinClass[64];
+
+/** \brief letter (a to z, 0 if none) two byte characters starting by 0xC3 fold to, indexed by the low bits of their second byte. */
+extern const unsigned char latinLetter[64];
+
+/** \brief class of three byte characters starting by 0xE2 0x80 (punctuation) indexed by the low bits of their third byte. */
+extern const unsigned char punctuationClass[64];
+
+/**
+ * @brief Classify an UTF8 character.
+ *
+ * A character ends at the first byte which is not a continuation byte, even if its first byte announces more, so a
+ * malformed character is read the same whether the text is scanned whole or cut at any offset.
+ *
+ * @param bytes bytes of the UTF8 character (as many as its first byte announces must be readable)
+ * @param size output variable, size of the UTF8 character
+ * @return unsigned char : class of the character, a combination of LETTER_SEPARATOR, LETTER_WORDSTART and a vowel bit
+ */
+static inline unsigned char classifyLetter(const unsigned char * bytes, unsigned int * size) {
+    unsigned char lead = bytes[0];
+    unsigned int announced = letterSize[lead];
+    if(announced == 1) {
+        *size = 1;
+        return oneByteClass[lead];
+    }
+    *size = 1;
+    while((*size < announced) && ((bytes[*size] & 0xC0) == 0x80)) (*size)++;
+    if((lead == 0xC3) && (*size == 2)) return latinClass[bytes[1] & 0x3F];
+    if((lead == 0xE2) && (*size == 3) && (bytes[1] == 0x80)) return punctuationClass[bytes[2] & 0x3F];
+    return 0;
+}
+
+/**
+ * @brief Use the kernels of a given CPU feature level from now on, to compare them.
+ *
+ * Not meant to be called while other threads scan text.
+ *
+ * @param name scalar, sse4.2 or avx2
+ * @return true if the kernels are in use, false if the name is unknown or the CPU lacks the features
+ */
+extern bool useKernels(const char * name);
+
+/**
+ * @brief Count the words of a text chunk and, for each vowel, the words holding it.
+ *
+ * Plain ASCII blocks are scanned with AVX2 or SSE4.2 when the CPU has them (the PROG1_KERNEL environment variable,
+ * set to scalar, sse4.2 or avx2, caps the kernel picked), any other text letter by letter.
+ *
+ * @param text text chunk, starting outside of a word
+ * @param size size, in bytes, of the text chunk
+ * @param wordCount output variable, incremented by the number of words in the text chunk
+ * @param vowelCounts output variable, incremented by the number of words holding each vowel (a, e, i, o, u, y)
+ */
+extern void countWords(const unsigned char * text, int size, unsigned int * wordCount, unsigned int * vowelCounts);
+
+/**
+ * @brief Summarize a chunk of text cut at arbitrary byte offsets.
+ *
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param summary output variable, summary of the text chunk
+ */
+extern void summarizeChunk(const unsigned char * text, int size, struct chunkSummary * summary);
+
+/**
+ * @brief Fold the summary of the next chunk of a text into its running counts.
+ *
+ * @param tally running counts of the text up to the chunk (zeroed before the first chunk)
+ * @param summary summary of the chunk
+ */
+extern void foldChunk(struct wordTally * tally, const struct chunkSummary * summary);
+
+/**
+ * @brief Finish the running counts of a text once all of its chunks were folded.
+ *
+ * @param tally running counts of the text
+ */
+extern void finishTally(struct wordTally * tally);
+
+/**
+ * @brief Summarize a chunk of text cut at arbitrary byte offsets, gathering a set of statistics.
+ *
+ * Only the vowel counts are gathered by summarizeChunk itself; the letters and word lengths are gathered letter by
+ * letter, by the instance of the kernel which only computes the statistics asked for.
+ *
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param stats statistics to gather, STAT_VOWELS with STAT_LETTERS and/or STAT_LENGTHS
+ * @param summary output variable, summary of the text chunk
+ * @param extra output variable, letters and word lengths of the text chunk (untouched if not asked for)
+ */
+extern void summarizeChunkStats(const unsigned char * text, int size, int stats, struct chunkSummary * summary,
+                                struct chunkStats * extra);
+
+/**
+ * @brief Fold the summary and statistics of the next chunk of a text into its running counts.
+ *
+ * @param tally running counts of the text up to the chunk (zeroed before the first chunk)
+ * @param extra running statistics of the text up to the chunk (zeroed before the first chunk)
+ * @param summary summary of the chunk
+ * @param chunkExtra statistics of the chunk (may be NULL if only the vowels are gathered)
+ * @param stats statistics gathered, as given to summarizeChunkStats
+ */
+extern void foldChunkStats(struct wordTally * tally, struct statsTally * extra, const struct chunkSummary * summary,
+                           const struct chunkStats * chunkExtra, int stats);
+
 /**
- * @brief Get the size in bytes of UTF8 character.
- * 
- * @param byte first byte of the character
- * @return unsigned int : size in bytes of the whole character
+ * @brief Finish the running counts and statistics of a text once all of its chunks were folded.
+ *
+ * @param tally running counts of the text
+ * @param extra running statistics of the text
+ * @param stats statistics gathered, as given to summarizeChunkStats
  */
-extern unsigned int getLetterSize(unsigned char byte);
+extern void finishTallyStats(struct wordTally * tally, struct statsTally * extra, int stats);
 
 /**
- * @brief Check if UTF8 character is a separator.
- * 
- * @param bytes array of bytes of UTF8 character
- * @param size size of UTF8 character
- * @return true : UTF8 character is separator
- * @return false : UTF8 character is not separator
+ * @brief Parse a set of statistics given on the command line.
+ *
+ * @param arg comma-separated list of vowels, letters and lengths (or all)
+ * @param stats output variable, STAT_VOWELS combined with the statistics listed
+ * @return true if every statistic listed is known, false otherwise
  */
-extern bool isSeparator(unsigned char bytes[4], int size);
+extern bool parseStats(const char * arg, int * stats);
 
 /**
- * @brief Check if UTF8 character is a vowel, if so, return the vowel without accentuation and lowercase
- * 
- * @param bytes array of bytes of UTF8 character
- * @param size size of UTF8 character
- * @return unsigned char : 'x' if not a vowel, otherwise, vowel with no accentuation and lower-case 
+ * @brief Parse a chunk size given on the command line.
+ *
+ * @param arg number of bytes, optionally followed by K or M, or "auto"
+ * @param size output variable, chunk size in bytes (0 for auto)
+ * @return true if the chunk size is valid and between CHUNKSIZE_MIN and CHUNKSIZE_MAX, false otherwise
  */
-extern unsigned char isVowel(unsigned char bytes[4], int size);
+extern bool parseChunkSize(const char * arg, unsigned int * size);
 
 /**
- * @brief Check if UTF8 character is alpha.
- * 
- * @param bytes array of bytes of UTF8 character
- * @param size size of UTF8 character
- * @return true : UTF8 character is alpha
- * @return false : UTF8 character is not alpha
+ * @brief Pick a chunk size for a set of files, from the throughput measured on their first bytes.
+ *
+ * @param names names of the files
+ * @param nFiles number of files
+ * @param nWorkers number of workers sharing the chunks
+ * @param chunkCost fixed cost, in seconds, of handing a chunk to a worker
+ * @return unsigned int : chunk size in bytes, a power of two between CHUNKSIZE_MIN and CHUNKSIZE_MAX
  */
-extern bool isAlpha(unsigned char bytes[4], int size);
+extern unsigned int tuneChunkSize(char ** names, int nFiles, int nWorkers, double chunkCost);
 
-#endif 
+#endif
@@ -0,0 +1,414 @@
+/**
+ * @file resultCache.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * On-disk cache of the counts of whole files, so files which did not change since the last run are not read again.
+ *
+ * The cache file is a header followed by a table of entries, a power of two of them, probed linearly from the hash
+ * of the device and inode. The table is doubled, and its entries placed again, once it is 70% full; entries of files
+ * which were deleted are never evicted, a cache file may simply be removed. The file is mapped shared, so stores
+ * reach it without any write back, and locked with flock for the run.
+ *
+ * Functions:
+ *     \li cacheOpen
+ *     \li cacheKeyOf
+ *     \li cacheLookup
+ *     \li cacheHashFile
+ *     \li cacheStore
+ *     \li cacheClose.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "resultCache.h"
+
+/** \brief first bytes of a cache file */
+#define CACHEMAGIC "VCCACHE1"
+
+/** \brief number of entries of a new cache file */
+#define CACHECAPACITY 1024
+
+/** \brief share of the entries which may be used before the table is doubled, in percent */
+#define CACHELOAD 70
+
+/** \brief bytes of a file hashed at a time, a multiple of the 32 byte stripes of XXH64 */
+#define HASHBLOCK (1 << 20)
+
+/** \brief primes of XXH64 */
+#define XXPRIME1 0x9E3779B185EBCA87ULL
+#define XXPRIME2 0xC2B2AE3D27D4EB4FULL
+#define XXPRIME3 0x165667B19E3779F9ULL
+#define XXPRIME4 0x85EBCA77C2B2AE63ULL
+#define XXPRIME5 0x27D4EB2F165667C5ULL
+
+/** \brief header of a cache file */
+struct cacheHeader {
+    char magic[8];          /**< CACHEMAGIC */
+    uint32_t entrySize;     /**< size of an entry, so files of another layout are refused */
+    uint32_t reserved;      /**< padding */
+    uint64_t capacity;      /**< number of entries of the table, a power of two */
+    uint64_t count;         /**< number of entries used */
+};
+
+/** \brief entry of the table */
+struct cacheEntry {
+    struct cacheKey key;                /**< key of the file */
+    uint64_t words;                     /**< number of words */
+    uint64_t vowels[CACHEVOWELS];       /**< number of words holding each vowel */
+    uint64_t used;                      /**< 1 if the entry holds a file, 0 if free */
+};
+
+/** \brief flag signaling if a cache is open */
+bool cacheOn = false;
+
+/** \brief flag signaling if hits are checked against the hash of the file's content */
+bool cacheVerify = false;
+
+/** \brief descriptor of the cache file */
+static int cacheFd = -1;
+
+/** \brief mapping of the cache file */
+static struct cacheHeader * cacheMap = NULL;
+
+/**
+ * @brief Size of a cache file holding a number of entries.
+ *
+ * @param capacity number of entries
+ * @return size_t : size, in bytes
+ */
+static size_t cacheBytes(uint64_t capacity) {
+    return sizeof(struct cacheHeader) + capacity * sizeof(struct cacheEntry);
+}
+
+/**
+ * @brief Entries of the mapped table.
+ *
+ * @return struct cacheEntry* : first entry
+ */
+static struct cacheEntry * cacheEntries(void) {
+    return (struct cacheEntry *)(cacheMap + 1);
+}
+
+/**
+ * @brief Map (or map again, after growing) the cache file.
+ *
+ * @param capacity number of entries of the file
+ * @return true on success, false otherwise
+ */
+static bool mapCache(uint64_t capacity) {
+    void * map = mmap(NULL, cacheBytes(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, cacheFd, 0);
+    if(map == MAP_FAILED) return false;
+    cacheMap = (struct cacheHeader *)map;
+    return true;
+}
+
+/**
+ * @brief Open (or create) a cache file and map it to memory.
+ *
+ * An empty file is laid out as a new cache.
+ *
+ * @param path name of the cache file
+ * @param verify true to store the hash of the files' content and check it on every hit
+ * @return true on success, false if the file can not be opened, is locked by another run or is not a cache (errno
+ *         is set, EWOULDBLOCK if locked)
+ */
+bool cacheOpen(const char * path, bool verify) {
+    struct stat st;
+    struct cacheHeader header;
+
+    if((cacheFd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1) return false;
+    if((flock(cacheFd, LOCK_EX | LOCK_NB) == -1) || (fstat(cacheFd, &st) == -1)) goto fail;
+    if(st.st_size == 0) { // new cache
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHEMAGIC, sizeof(header.magic));
+        header.entrySize = sizeof(struct cacheEntry);
+        header.capacity = CACHECAPACITY;
+        if((ftruncate(cacheFd, (off_t)cacheBytes(CACHECAPACITY)) == -1) ||
+           (pwrite(cacheFd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))) goto fail;
+    }
+    else if((st.st_size < (off_t)sizeof(header)) || (pread(cacheFd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) ||
+            (memcmp(header.magic, CACHEMAGIC, sizeof(header.magic)) != 0) || (header.entrySize != sizeof(struct cacheEntry)) ||
+            (header.capacity == 0) || ((header.capacity & (header.capacity - 1)) != 0) ||
+            ((off_t)cacheBytes(header.capacity) != st.st_size)) {
+        errno = EINVAL; // not a cache file, or of another layout
+        goto fail;
+    }
+    if(!mapCache(header.capacity)) goto fail;
+    cacheOn = true;
+    cacheVerify = verify;
+    return true;
+
+fail: {
+        int error = errno;
+        close(cacheFd);
+        cacheFd = -1;
+        errno = error;
+        return false;
+    }
+}
+
+/**
+ * @brief Build the key of a file from its stat.
+ *
+ * @param st stat of the file
+ * @param key output variable, key of the file (not hashed)
+ */
+void cacheKeyOf(const struct stat * st, struct cacheKey * key) {
+    memset(key, 0, sizeof(struct cacheKey));
+    key->dev = (uint64_t)st->st_dev;
+    key->ino = (uint64_t)st->st_ino;
+    key->size = (uint64_t)st->st_size;
+    key->mtimeSec = (int64_t)st->st_mtim.tv_sec;
+    key->mtimeNsec = (int64_t)st->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Find the entry of a file, or the free entry it would go to.
+ *
+ * @param key key of the file (only its device and inode are compared)
+ * @return struct cacheEntry* : entry of the file, or a free entry
+ */
+static struct cacheEntry * findEntry(const struct cacheKey * key) {
+    uint64_t mask = cacheMap->capacity - 1;
+    uint64_t h = (key->dev * XXPRIME1) ^ (key->ino * XXPRIME2);
+    h ^= h >> 31;
+    struct cacheEntry * entries = cacheEntries();
+    for(uint64_t i = h & mask;; i = (i + 1) & mask) { // the table is never full, a free entry ends the probe
+        if(!entries[i].used || ((entries[i].key.dev == key->dev) && (entries[i].key.ino == key->ino))) return &entries[i];
+    }
+}
+
+/**
+ * @brief Look a file up in the cache.
+ *
+ * An entry with the file's device and inode is a hit if the size and modification time match, and, when verifying,
+ * if it holds a hash matching that of the file's content now.
+ *
+ * @param name name of the file, read to check its hash when verifying
+ * @param key key of the file, its hash is filled in when verifying an entry with the same stat
+ * @param words output variable, number of words of the file on a hit
+ * @param vowels output variable, number of words holding each vowel on a hit
+ * @return true on a hit, false otherwise (or if no cache is open)
+ */
+bool cacheLookup(const char * name, struct cacheKey * key, unsigned long long * words, unsigned long long * vowels) {
+    if(!cacheOn) return false;
+    struct cacheEntry * entry = findEntry(key);
+    if(!entry->used || (entry->key.size != key->size) || (entry->key.mtimeSec != key->mtimeSec) ||
+       (entry->key.mtimeNsec != key->mtimeNsec)) return false;
+    if(cacheVerify && ((entry->key.hash == 0) || !cacheHashFile(name, &key->hash) || (key->hash != entry->key.hash))) {
+        return false;
+    }
+    *words = entry->words;
+    for(int j = 0; j < CACHEVOWELS; j++) vowels[j] = entry->vowels[j];
+    return true;
+}
+
+/**
+ * @brief Rotate a 64 bit word left.
+ *
+ * @param x word
+ * @param r number of bits
+ * @return uint64_t : rotated word
+ */
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * @brief Read a little endian 64 bit word.
+ *
+ * @param p bytes
+ * @return uint64_t : word
+ */
+static inline uint64_t read64(const unsigned char * p) {
+    uint64_t v = 0;
+    for(int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+/**
+ * @brief Read a little endian 32 bit word.
+ *
+ * @param p bytes
+ * @return uint64_t : word
+ */
+static inline uint64_t read32(const unsigned char * p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24);
+}
+
+/**
+ * @brief Mix a lane of input into an accumulator of XXH64.
+ *
+ * @param acc accumulator
+ * @param input lane of input
+ * @return uint64_t : new accumulator
+ */
+static inline uint64_t xxRound(uint64_t acc, uint64_t input) {
+    acc += input * XXPRIME2;
+    acc = rotl64(acc, 31);
+    return acc * XXPRIME1;
+}
+
+/**
+ * @brief Merge an accumulator of XXH64 into the hash.
+ *
+ * @param h hash
+ * @param acc accumulator
+ * @return uint64_t : new hash
+ */
+static inline uint64_t xxMerge(uint64_t h, uint64_t acc) {
+    h ^= xxRound(0, acc);
+    return h * XXPRIME1 + XXPRIME4;
+}
+
+/**
+ * @brief Hash the content of a file with XXH64 (seed 0).
+ *
+ * The file is read in blocks of whole 32 byte stripes, only the last block holds the bytes past the last stripe.
+ *
+ * @param name name of the file
+ * @param hash output variable, hash of the content
+ * @return true on success, false if the file can not be read
+ */
+bool cacheHashFile(const char * name, uint64_t * hash) {
+    uint64_t v[4] = {XXPRIME1 + XXPRIME2, XXPRIME2, 0, -XXPRIME1};
+    uint64_t total = 0;
+    unsigned char * block;
+    size_t got;
+    int fd;
+
+    if((fd = open(name, O_RDONLY | O_CLOEXEC)) == -1) return false;
+    if((block = (unsigned char *)malloc(HASHBLOCK)) == NULL) {
+        close(fd);
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    do {
+        got = 0;
+        while(got < HASHBLOCK) { // fill the block, so only the last one is short
+            ssize_t n = read(fd, block + got, HASHBLOCK - got);
+            if((n < 0) && (errno == EINTR)) continue;
+            if(n < 0) {
+                free(block);
+                close(fd);
+                return false;
+            }
+            if(n == 0) break;
+            got += (size_t)n;
+        }
+        size_t stripes = (got == HASHBLOCK) ? got : got - got % 32;
+        for(size_t p = 0; p < stripes; p += 32) {
+            for(int l = 0; l < 4; l++) v[l] = xxRound(v[l], read64(block + p + 8 * l));
+        }
+        total += got;
+    } while(got == HASHBLOCK);
+    close(fd);
+
+    uint64_t h;
+    const unsigned char * p = block + (got - got % 32), * end = block + got;
+    if(total >= 32) {
+        h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+        for(int l = 0; l < 4; l++) h = xxMerge(h, v[l]);
+    }
+    else h = XXPRIME5;
+    h += total;
+    for(; p + 8 <= end; p += 8) h = rotl64(h ^ xxRound(0, read64(p)), 27) * XXPRIME1 + XXPRIME4;
+    if(p + 4 <= end) {
+        h = rotl64(h ^ (read32(p) * XXPRIME1), 23) * XXPRIME2 + XXPRIME3;
+        p += 4;
+    }
+    for(; p < end; p++) h = rotl64(h ^ (*p * XXPRIME5), 11) * XXPRIME1;
+    h ^= h >> 33;
+    h *= XXPRIME2;
+    h ^= h >> 29;
+    h *= XXPRIME3;
+    h ^= h >> 32;
+
+    free(block);
+    *hash = h;
+    return true;
+}
+
+/**
+ * @brief Double the table, placing its entries again.
+ *
+ * @return true on success, false if the file can not grow (the table is left as it was)
+ */
+static bool growCache(void) {
+    uint64_t capacity = cacheMap->capacity, count = cacheMap->count;
+    struct cacheEntry * old;
+
+    if((old = (struct cacheEntry *)malloc(capacity * sizeof(struct cacheEntry))) == NULL) return false;
+    memcpy(old, cacheEntries(), capacity * sizeof(struct cacheEntry));
+    if(ftruncate(cacheFd, (off_t)cacheBytes(2 * capacity)) == -1) {
+        free(old);
+        return false;
+    }
+    munmap(cacheMap, cacheBytes(capacity));
+    if(!mapCache(2 * capacity)) { // the file is larger than its header says, it is refused by the next run
+        cacheMap = NULL;
+        cacheOn = false;
+        free(old);
+        return false;
+    }
+    memset(cacheEntries(), 0, 2 * capacity * sizeof(struct cacheEntry));
+    cacheMap->capacity = 2 * capacity;
+    cacheMap->count = count;
+    for(uint64_t i = 0; i < capacity; i++) {
+        if(old[i].used) *findEntry(&old[i].key) = old[i];
+    }
+    free(old);
+    return true;
+}
+
+/**
+ * @brief Store the counts of a file in the cache, replacing those of an older version of it.
+ *
+ * @param key key of the file, hashed when verifying
+ * @param words number of words of the file
+ * @param vowels number of words holding each vowel
+ */
+void cacheStore(const struct cacheKey * key, unsigned long long words, const unsigned long long * vowels) {
+    if(!cacheOn) return;
+    struct cacheEntry * entry = findEntry(key);
+    if(!entry->used) {
+        if(((cacheMap->count + 1) * 100 > cacheMap->capacity * CACHELOAD)) { // keep the probes short
+            if(!growCache()) return;
+            entry = findEntry(key);
+        }
+        cacheMap->count++;
+    }
+    entry->key = *key;
+    entry->words = words;
+    for(int j = 0; j < CACHEVOWELS; j++) entry->vowels[j] = vowels[j];
+    entry->used = 1;
+}
+
+/**
+ * @brief Unmap and unlock the cache file.
+ */
+void cacheClose(void) {
+    if(cacheMap != NULL) munmap(cacheMap, cacheBytes(cacheMap->capacity));
+    if(cacheFd != -1) close(cacheFd); // releases the lock
+    cacheMap = NULL;
+    cacheFd = -1;
+    cacheOn = false;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file resultCache.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * On-disk cache of the counts of whole files, so files which did not change since the last run are not read again.
+ *
+ * The cache is a memory-mapped open-addressing table keyed by the device and inode of a file; an entry is only a hit
+ * if the size and modification time stat'ed match those stored. On request, the XXH64 hash of the file's content is
+ * stored too, and checked on every hit, which costs a read of the file but not its counting. The cache file is
+ * locked for the run; a run which finds it locked by another goes on without a cache.
+ *
+ * Not thread safe: lookups are made by the main thread before the workers start, stores inside the monitor.
+ *
+ * Functions:
+ *     \li cacheOpen
+ *     \li cacheKeyOf
+ *     \li cacheLookup
+ *     \li cacheHashFile
+ *     \li cacheStore
+ *     \li cacheClose.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/** \brief number of vowels cached for each file. */
+#define CACHEVOWELS 6
+
+/** \brief identity of a file's content, as stat'ed (and hashed). */
+struct cacheKey {
+    uint64_t dev;           /**< device holding the file */
+    uint64_t ino;           /**< inode of the file */
+    uint64_t size;          /**< size of the file, in bytes */
+    int64_t mtimeSec;       /**< modification time, seconds */
+    int64_t mtimeNsec;      /**< modification time, nanoseconds */
+    uint64_t hash;          /**< XXH64 of the content (0 if not hashed) */
+};
+
+/** \brief flag signaling if a cache is open */
+extern bool cacheOn;
+
+/** \brief flag signaling if hits are checked against the hash of the file's content */
+extern bool cacheVerify;
+
+/**
+ * @brief Open (or create) a cache file and map it to memory.
+ *
+ * @param path name of the cache file
+ * @param verify true to store the hash of the files' content and check it on every hit
+ * @return true on success, false if the file can not be opened, is locked by another run or is not a cache (errno
+ *         is set, EWOULDBLOCK if locked)
+ */
+extern bool cacheOpen(const char * path, bool verify);
+
+/**
+ * @brief Build the key of a file from its stat.
+ *
+ * @param st stat of the file
+ * @param key output variable, key of the file (not hashed)
+ */
+extern void cacheKeyOf(const struct stat * st, struct cacheKey * key);
+
+/**
+ * @brief Look a file up in the cache.
+ *
+ * @param name name of the file, read to check its hash when verifying
+ * @param key key of the file, its hash is filled in when verifying an entry with the same stat
+ * @param words output variable, number of words of the file on a hit
+ * @param vowels output variable, number of words holding each vowel on a hit
+ * @return true on a hit, false otherwise (or if no cache is open)
+ */
+extern bool cacheLookup(const char * name, struct cacheKey * key, unsigned long long * words, unsigned long long * vowels);
+
+/**
+ * @brief Hash the content of a file with XXH64.
+ *
+ * @param name name of the file
+ * @param hash output variable, hash of the content
+ * @return true on success, false if the file can not be read
+ */
+extern bool cacheHashFile(const char * name, uint64_t * hash);
+
+/**
+ * @brief Store the counts of a file in the cache, replacing those of an older version of it.
+ *
+ * @param key key of the file, hashed when verifying
+ * @param words number of words of the file
+ * @param vowels number of words holding each vowel
+ */
+extern void cacheStore(const struct cacheKey * key, unsigned long long words, const unsigned long long * vowels);
+
+/**
+ * @brief Unmap and unlock the cache file.
+ */
+extern void cacheClose(void);
+
+#endif
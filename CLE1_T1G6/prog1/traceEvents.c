@@ -0,0 +1,325 @@
+/**
+ * @file traceEvents.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Timeline of the threads, as Chrome / Perfetto trace events.
+ *
+ *  Each thread records its spans in a track of its own, grown geometrically, so recording takes no lock; tracks are
+ *  only linked into a list, under a lock, the first time a thread records a span or is named. Spans imported from
+ *  other MPI ranks are kept apart and written with the local ones on closing.
+ *
+ *  Functions:
+ *     \li traceOpen
+ *     \li traceThread
+ *     \li traceNow
+ *     \li traceSpan
+ *     \li traceLock
+ *     \li traceWait
+ *     \li traceExport
+ *     \li traceImport
+ *     \li traceClose.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "traceEvents.h"
+
+/** \brief initial number of spans a track has room for */
+#define TRACECAPACITY 1024
+
+/** \brief track of a thread */
+struct traceTrack {
+    struct traceEvent * events;     /**< spans of the thread */
+    size_t count;                   /**< number of spans */
+    size_t capacity;                /**< number of spans the array has room for */
+    int tid;                        /**< track id, in order of the first span */
+    char name[32];                  /**< name of the track, empty if the thread was not named */
+    struct traceTrack * next;       /**< next track in the list */
+};
+
+/** \brief flag signaling if a trace is open */
+bool traceOn = false;
+
+/** \brief name of the trace file, NULL if none is written */
+static char * tracePath = NULL;
+
+/** \brief name of the process */
+static char traceProcess[64];
+
+/** \brief process id of the local spans */
+static int tracePid = 0;
+
+/** \brief time the trace was opened */
+static struct timespec traceOrigin;
+
+/** \brief locking flag which warrants mutual exclusion on the list of tracks */
+static pthread_mutex_t traceListLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief list of the tracks of the threads, most recent first */
+static struct traceTrack * traceTracks = NULL;
+
+/** \brief number of tracks */
+static int nTracks = 0;
+
+/** \brief spans imported from other processes */
+static struct traceTrack imported = {NULL, 0, 0, -1, "", NULL};
+
+/** \brief track of the calling thread, NULL until it records its first span */
+static _Thread_local struct traceTrack * self = NULL;
+
+/**
+ * @brief Get the track of the calling thread, creating it on the first call.
+ *
+ * @return struct traceTrack* : track of the thread, NULL if memory runs out
+ */
+static struct traceTrack * ownTrack(void) {
+    if(self == NULL) {
+        if((self = (struct traceTrack *)calloc(1, sizeof(struct traceTrack))) == NULL) return NULL;
+        pthread_mutex_lock(&traceListLock);
+        self->tid = nTracks++;
+        self->next = traceTracks;
+        traceTracks = self;
+        pthread_mutex_unlock(&traceListLock);
+    }
+    return self;
+}
+
+/**
+ * @brief Append a span to a track, growing it geometrically.
+ *
+ * @param track track
+ * @param event span
+ * @return true on success, false if memory runs out (the span is dropped)
+ */
+static bool append(struct traceTrack * track, const struct traceEvent * event) {
+    if(track->count == track->capacity) {
+        size_t capacity = (track->capacity > 0) ? 2 * track->capacity : TRACECAPACITY;
+        struct traceEvent * events;
+        if((events = (struct traceEvent *)realloc(track->events, capacity * sizeof(struct traceEvent))) == NULL) return false;
+        track->events = events;
+        track->capacity = capacity;
+    }
+    track->events[track->count++] = *event;
+    return true;
+}
+
+/**
+ * @brief Print a string as a JSON string.
+ *
+ * @param fp output stream
+ * @param text string
+ */
+static void printJsonString(FILE * fp, const char * text) {
+    fputc('"', fp);
+    for(const unsigned char * c = (const unsigned char *)text; *c; c++) {
+        if((*c == '"') || (*c == '\\')) fprintf(fp, "\\%c", *c);
+        else if(*c < 0x20) fprintf(fp, "\\u%04x", *c);
+        else fputc(*c, fp);
+    }
+    fputc('"', fp);
+}
+
+/**
+ * @brief Print the spans of a track as complete ("X") trace events, in microseconds.
+ *
+ * @param fp output stream
+ * @param track track
+ */
+static void printSpans(FILE * fp, const struct traceTrack * track) {
+    for(size_t i = 0; i < track->count; i++) {
+        const struct traceEvent * e = &track->events[i];
+        fprintf(fp, ",\n{\"name\": ");
+        printJsonString(fp, e->name);
+        fprintf(fp, ", \"cat\": ");
+        printJsonString(fp, e->cat);
+        fprintf(fp, ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                e->start * 1.0e6, e->duration * 1.0e6, e->pid, e->tid);
+    }
+}
+
+/**
+ * @brief Open a trace, spans are recorded from then on.
+ *
+ * @param path name of the trace file, written on closing (NULL for a trace which is only exported)
+ * @param process name of the process
+ * @param pid process id of the spans, the MPI rank
+ * @return true on success, false if memory runs out
+ */
+bool traceOpen(const char * path, const char * process, int pid) {
+    if((path != NULL) && ((tracePath = strdup(path)) == NULL)) return false;
+    snprintf(traceProcess, sizeof(traceProcess), "%s", process);
+    tracePid = pid;
+    clock_gettime(CLOCK_MONOTONIC, &traceOrigin);
+    traceOn = true;
+    return true;
+}
+
+/**
+ * @brief Name the track of the calling thread, e.g. "worker" 2.
+ *
+ * @param role role of the thread
+ * @param id application defined identification of the thread
+ */
+void traceThread(const char * role, int id) {
+    struct traceTrack * track;
+
+    if(!traceOn || ((track = ownTrack()) == NULL)) return;
+    snprintf(track->name, sizeof(track->name), "%s %d", role, id);
+}
+
+/**
+ * @brief Read the clock of the trace.
+ *
+ * @return double : time, in seconds from the opening of the trace, 0 if no trace is open
+ */
+double traceNow(void) {
+    struct timespec t;
+
+    if(!traceOn) return 0;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)(t.tv_sec - traceOrigin.tv_sec) + 1.0e-9 * (double)(t.tv_nsec - traceOrigin.tv_nsec);
+}
+
+/**
+ * @brief Record a span of the calling thread, from a given time to now.
+ *
+ * @param name name of the span
+ * @param cat category of the span
+ * @param start start of the span, from traceNow
+ */
+void traceSpan(const char * name, const char * cat, double start) {
+    struct traceTrack * track;
+    struct traceEvent event;
+
+    if(!traceOn || ((track = ownTrack()) == NULL)) return;
+    snprintf(event.name, sizeof(event.name), "%s", name);
+    snprintf(event.cat, sizeof(event.cat), "%s", cat);
+    event.start = start;
+    event.duration = traceNow() - start;
+    event.pid = tracePid;
+    event.tid = track->tid;
+    append(track, &event);
+}
+
+/**
+ * @brief Lock a monitor's locking flag, recording the wait as a span named after the monitor operation.
+ *
+ * @param site name of the monitor operation
+ * @param mutex locking flag
+ * @return int : status of pthread_mutex_lock
+ */
+int traceLock(const char * site, pthread_mutex_t * mutex) {
+    if(!traceOn) return pthread_mutex_lock(mutex);
+
+    double start = traceNow();
+    int status = pthread_mutex_lock(mutex);
+    traceSpan(site, "lock", start);
+    return status;
+}
+
+/**
+ * @brief Wait on a synchronization point of a monitor, recording the wait as a span named after the monitor operation.
+ *
+ * @param site name of the monitor operation
+ * @param cond synchronization point
+ * @param mutex locking flag, held
+ * @return int : status of pthread_cond_wait
+ */
+int traceWait(const char * site, pthread_cond_t * cond, pthread_mutex_t * mutex) {
+    if(!traceOn) return pthread_cond_wait(cond, mutex);
+
+    double start = traceNow();
+    int status = pthread_cond_wait(cond, mutex);
+    traceSpan(site, "wait", start);
+    return status;
+}
+
+/**
+ * @brief Gather the spans of every thread of the process, to be sent to the rank writing the trace.
+ *
+ * @param events output variable, array of spans (owned by the caller, NULL if none)
+ * @return size_t : number of spans
+ */
+size_t traceExport(struct traceEvent ** events) {
+    size_t count = 0;
+
+    *events = NULL;
+    pthread_mutex_lock(&traceListLock);
+    for(struct traceTrack * t = traceTracks; t != NULL; t = t->next) count += t->count;
+    if((count > 0) && ((*events = (struct traceEvent *)malloc(count * sizeof(struct traceEvent))) == NULL)) count = 0;
+    size_t n = 0;
+    for(struct traceTrack * t = traceTracks; (*events != NULL) && (t != NULL); t = t->next) {
+        memcpy(&(*events)[n], t->events, t->count * sizeof(struct traceEvent));
+        n += t->count;
+    }
+    pthread_mutex_unlock(&traceListLock);
+    return count;
+}
+
+/**
+ * @brief Add the spans of another process to the trace.
+ *
+ * @param events array of spans
+ * @param count number of spans
+ */
+void traceImport(const struct traceEvent * events, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if(!append(&imported, &events[i])) break;
+    }
+}
+
+/**
+ * @brief Close the trace, writing it to its file.
+ *
+ * Called once every other thread recording spans is done. Processes other than the local one are named after their
+ * MPI rank.
+ *
+ * @return true on success (or if no file is written), false if the file can not be written
+ */
+bool traceClose(void) {
+    FILE * fp;
+
+    if(!traceOn) return true;
+    traceOn = false;
+    if(tracePath == NULL) return true;
+    if((fp = fopen(tracePath, "w")) == NULL) return false;
+
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": ", tracePid);
+    printJsonString(fp, traceProcess);
+    fprintf(fp, "}}");
+    int * named = NULL, nNamed = 0;
+    for(size_t i = 0; i < imported.count; i++) { // name each other process once, on its first span
+        int pid = imported.events[i].pid, k = 0;
+        while((k < nNamed) && (named[k] != pid)) k++;
+        if((k < nNamed) || (pid == tracePid)) continue;
+        int * grown;
+        if((grown = (int *)realloc(named, (nNamed + 1) * sizeof(int))) != NULL) {
+            named = grown;
+            named[nNamed++] = pid;
+        }
+        fprintf(fp, ",\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"rank %d\"}}", pid, pid);
+    }
+    free(named);
+    for(struct traceTrack * t = traceTracks; t != NULL; t = t->next) {
+        if(t->name[0] == '\0') continue;
+        fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": ", tracePid, t->tid);
+        printJsonString(fp, t->name);
+        fprintf(fp, "}}");
+    }
+    for(struct traceTrack * t = traceTracks; t != NULL; t = t->next) printSpans(fp, t);
+    printSpans(fp, &imported);
+    fprintf(fp, "\n]}\n");
+
+    return (fclose(fp) == 0);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file traceEvents.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Timeline of the threads, as Chrome / Perfetto trace events.
+ *
+ *  Spans (name, category, start and duration) are recorded per thread while a trace is open and written as a trace
+ *  event JSON file when it is closed: one process per program (or MPI rank), one track per thread. Nothing is
+ *  recorded, and the clock is not read, when no trace is open.
+ *
+ *  A span is timed as
+ *
+ *      double start = traceNow();
+ *      ...
+ *      traceSpan("read", "io", start);
+ *
+ *  The MPI programs gather the spans of the other ranks with traceExport / traceImport, rank 0 writes them all.
+ *  Shared by the vowel count (prog1, CLE1 and CLE2) and bitonic sort (prog2) programs.
+ *
+ *  Functions:
+ *     \li traceOpen
+ *     \li traceThread
+ *     \li traceNow
+ *     \li traceSpan
+ *     \li traceLock
+ *     \li traceWait
+ *     \li traceExport
+ *     \li traceImport
+ *     \li traceClose.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/** \brief maximum length of the name of a span (longer names are cut) */
+#define TRACENAMELEN 23
+
+/** \brief maximum length of the category of a span (longer categories are cut) */
+#define TRACECATLEN 7
+
+/** \brief span of a trace, plain data so it can be sent between MPI ranks as bytes */
+struct traceEvent {
+    char name[TRACENAMELEN + 1];    /**< name of the span */
+    char cat[TRACECATLEN + 1];      /**< category of the span */
+    double start;                   /**< start, in seconds from the opening of the trace */
+    double duration;                /**< duration, in seconds */
+    int pid;                        /**< process (MPI rank) of the span */
+    int tid;                        /**< track (thread) of the span */
+};
+
+/** \brief flag signaling if a trace is open */
+extern bool traceOn;
+
+/**
+ * @brief Open a trace, spans are recorded from then on.
+ *
+ * @param path name of the trace file, written on closing (NULL for a trace which is only exported)
+ * @param process name of the process
+ * @param pid process id of the spans, the MPI rank
+ * @return true on success, false if memory runs out
+ */
+extern bool traceOpen(const char * path, const char * process, int pid);
+
+/**
+ * @brief Name the track of the calling thread, e.g. "worker" 2.
+ *
+ * @param role role of the thread
+ * @param id application defined identification of the thread
+ */
+extern void traceThread(const char * role, int id);
+
+/**
+ * @brief Read the clock of the trace.
+ *
+ * @return double : time, in seconds from the opening of the trace, 0 if no trace is open
+ */
+extern double traceNow(void);
+
+/**
+ * @brief Record a span of the calling thread, from a given time to now.
+ *
+ * @param name name of the span
+ * @param cat category of the span
+ * @param start start of the span, from traceNow
+ */
+extern void traceSpan(const char * name, const char * cat, double start);
+
+/**
+ * @brief Lock a monitor's locking flag, recording the wait as a span named after the monitor operation.
+ *
+ * @param site name of the monitor operation
+ * @param mutex locking flag
+ * @return int : status of pthread_mutex_lock
+ */
+extern int traceLock(const char * site, pthread_mutex_t * mutex);
+
+/**
+ * @brief Wait on a synchronization point of a monitor, recording the wait as a span named after the monitor operation.
+ *
+ * @param site name of the monitor operation
+ * @param cond synchronization point
+ * @param mutex locking flag, held
+ * @return int : status of pthread_cond_wait
+ */
+extern int traceWait(const char * site, pthread_cond_t * cond, pthread_mutex_t * mutex);
+
+/**
+ * @brief Gather the spans of every thread of the process, to be sent to the rank writing the trace.
+ *
+ * @param events output variable, array of spans (owned by the caller, NULL if none)
+ * @return size_t : number of spans
+ */
+extern size_t traceExport(struct traceEvent ** events);
+
+/**
+ * @brief Add the spans of another process to the trace.
+ *
+ * @param events array of spans
+ * @param count number of spans
+ */
+extern void traceImport(const struct traceEvent * events, size_t count);
+
+/**
+ * @brief Close the trace, writing it to its file.
+ *
+ * Called once every other thread recording spans is done.
+ *
+ * @return true on success (or if no file is written), false if the file can not be written
+ */
+extern bool traceClose(void);
+
+#endif
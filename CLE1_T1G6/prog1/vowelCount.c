@@ -0,0 +1,550 @@
+/**
+ * @file vowelCount.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Embeddable vowel counting library (libvowelcount), with no global state.
+ *
+ * A piece of text is summarized and folded into the state of its text, as the chunks of a file are; the counts of
+ * the text so far are those of a copy of the state, finished.
+ *
+ * The pool threads wait for jobs on a queue. A job cuts its files into chunks numbered across all of them; threads
+ * claim chunk numbers with an atomic counter, read them with pread into a buffer of their own, kept from job to job,
+ * and store the summary of each. The thread storing the last summary of a file folds them in order and reports the
+ * file. A job is taken off the queue once its chunks were all claimed, so the threads move on to the next while the
+ * last chunks of the previous one are still being counted. Each file is opened by the first thread claiming one of
+ * its chunks and closed once its last chunk is summarized.
+ *
+ * Built with -DMONITOR_PROBE (monitorProbe.c and traceEvents.c linked in), the pool's locks and waits are probed
+ * like the monitors of prog1; otherwise the library stands alone.
+ *
+ * Functions:
+ *     \li vc_init
+ *     \li vc_count_buffer
+ *     \li vc_pool_create
+ *     \li vc_pool_destroy
+ *     \li vc_pool_stats
+ *     \li vc_count_files.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "vowelCount.h"
+#include "prog1Utils.h"
+
+#ifdef MONITOR_PROBE
+
+#include "monitorProbe.h"
+
+/** \brief enter the pool's monitor, probed as prog1's monitors are (monitorProbe.h) */
+#define vcLock(site, mutex) monitorLock(site, mutex)
+
+/** \brief exit the pool's monitor */
+#define vcUnlock(site, mutex) monitorUnlock(site, mutex)
+
+/** \brief wait on a synchronization point of the pool's monitor */
+#define vcWait(site, cond, mutex) monitorWait(site, cond, mutex)
+
+#else
+
+#define vcLock(site, mutex) pthread_mutex_lock(mutex)
+#define vcUnlock(site, mutex) pthread_mutex_unlock(mutex)
+#define vcWait(site, cond, mutex) pthread_cond_wait(cond, mutex)
+
+#endif
+
+/** \brief number of chunk summaries a job keeps at most, the chunk size is doubled until its files fit in them */
+#define VC_MAXCHUNKS (1 << 22)
+
+/** \brief descriptor of a file: not opened yet */
+#define VC_FILECLOSED (-1)
+
+/** \brief descriptor of a file: being opened by the first thread claiming one of its chunks */
+#define VC_FILEOPENING (-2)
+
+/** \brief descriptor of a file: could not be opened, its chunks are left empty */
+#define VC_FILEFAILED (-3)
+
+/** \brief files counted by a call to vc_count_files */
+struct vcJob {
+    vc_pool * pool;                     /**< pool counting the job */
+    const char * const * paths;         /**< names of the files */
+    size_t nPaths;                      /**< number of files */
+    vc_result * results;                /**< counts of each file */
+    vc_file_done done;                  /**< called as each file is done (may be NULL) */
+    void * arg;                         /**< argument given to done */
+    unsigned int chunkSize;             /**< size, in bytes, of the chunks */
+    off_t * sizes;                      /**< size of each file, as stat'ed when the job was submitted */
+    size_t * firstChunk;                /**< number of the first chunk of each file (and past the last one) */
+    struct chunkSummary * summaries;    /**< summary of each chunk */
+    double * start;                     /**< time at which each file was opened, when its first chunk was claimed */
+    atomic_int * desc;                  /**< descriptor of each file, or VC_FILECLOSED, VC_FILEOPENING, VC_FILEFAILED */
+    atomic_int * errors;                /**< errno of the first failure on each file, 0 if none */
+    atomic_size_t * pending;            /**< number of chunks of each file not summarized yet */
+    size_t nChunks;                     /**< number of chunks of the job */
+    atomic_size_t nextChunk;            /**< number of the next chunk to claim */
+    size_t filesLeft;                   /**< number of files not reported yet (pool lock) */
+    int workers;                        /**< number of threads which took the job (pool lock) */
+    pthread_mutex_t reportLock;         /**< locking flag which warrants files are reported one at a time */
+    pthread_cond_t finished;            /**< submitter waiting for the job to be done */
+    struct vcJob * next;                /**< next job of the queue */
+};
+
+/** \brief pool of counting threads */
+struct vc_pool {
+    pthread_t * threads;        /**< counting threads */
+    int nThreads;               /**< number of counting threads */
+    int nStarted;               /**< number of counting threads which took an id */
+    vc_thread_stats * stats;    /**< work done by each counting thread, stored as it leaves a job */
+    double born;                /**< time at which the pool was started */
+    pthread_mutex_t lock;       /**< locking flag which warrants mutual exclusion on the queue and the jobs' counters */
+    pthread_cond_t jobPosted;   /**< threads waiting for a job */
+    struct vcJob * head;        /**< oldest job with chunks left to claim */
+    struct vcJob * tail;        /**< newest job */
+    bool quit;                  /**< the pool is being stopped */
+};
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return double : time, in seconds, from an arbitrary origin
+ */
+static double monotonicClock(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1.0e-9 * (double)t.tv_nsec;
+}
+
+/**
+ * @brief Start counting a new text.
+ *
+ * @param state state of the text
+ */
+void vc_init(vc_state * state) {
+    memset(state, 0, sizeof(vc_state));
+}
+
+/**
+ * @brief Copy finished counts into a result.
+ *
+ * @param tally running counts, finished
+ * @param bytes number of bytes counted
+ * @param error errno of a failure, 0 if none
+ * @param result output variable, counts
+ */
+static void storeResult(const struct wordTally * tally, uint64_t bytes, int error, vc_result * result) {
+    result->words = tally->words;
+    for(int k = 0; k < VC_VOWELS; k++) result->vowels[k] = tally->vowels[k];
+    result->bytes = bytes;
+    result->seconds = 0;
+    result->error = error;
+}
+
+/**
+ * @brief Count the next piece of a text, cut at any byte offset.
+ *
+ * The piece is summarized in chunks of at most CHUNKSIZE_MAX bytes, folded into the state in order.
+ *
+ * @param text bytes of the piece (may be NULL if size is 0)
+ * @param size size, in bytes, of the piece
+ * @param state state of the text, updated
+ * @param result output variable, counts of the text up to the end of the piece as if it ended there (may be NULL)
+ */
+void vc_count_buffer(const uint8_t * text, size_t size, vc_state * state, vc_result * result) {
+    for(size_t pos = 0; pos < size;) {
+        int n = (size - pos < CHUNKSIZE_MAX) ? (int)(size - pos) : CHUNKSIZE_MAX;
+        struct chunkSummary summary;
+        summarizeChunk(text + pos, n, &summary);
+        foldChunk(&state->tally, &summary);
+        pos += n;
+    }
+    state->bytes += size;
+
+    if(result != NULL) { // the letter cut by the end of the piece, if any, is scanned on a copy
+        struct wordTally tally = state->tally;
+        finishTally(&tally);
+        storeResult(&tally, state->bytes, 0, result);
+    }
+}
+
+/**
+ * @brief Record the first failure on a file of a job.
+ *
+ * @param job the job
+ * @param idx index of the file
+ * @param error errno of the failure
+ */
+static void failFile(struct vcJob * job, size_t idx, int error) {
+    int none = 0;
+    atomic_compare_exchange_strong(&job->errors[idx], &none, error);
+}
+
+/**
+ * @brief Report a file of a job, with its counts already stored.
+ *
+ * @param job the job
+ * @param idx index of the file
+ */
+static void reportJobFile(struct vcJob * job, size_t idx) {
+    if(job->done == NULL) return;
+    vcLock("reportJobFile", &job->reportLock);
+    job->done(idx, &job->results[idx], job->arg);
+    vcUnlock("reportJobFile", &job->reportLock);
+}
+
+/**
+ * @brief Make sure a file of a job is open before one of its chunks is read.
+ *
+ * The first thread to claim one of the file's chunks opens it, the others wait for it to be done.
+ *
+ * @param job the job
+ * @param idx index of the file
+ * @return int : descriptor of the file, -1 if it could not be opened
+ */
+static int openJobFile(struct vcJob * job, size_t idx) {
+    int fd = atomic_load(&job->desc[idx]);
+
+    if((fd == VC_FILECLOSED) && atomic_compare_exchange_strong(&job->desc[idx], &fd, VC_FILEOPENING)) {
+        job->start[idx] = monotonicClock(); // the file's processing time starts with its first claim
+        if((fd = open(job->paths[idx], O_RDONLY)) == -1) {
+            failFile(job, idx, errno);
+            fd = VC_FILEFAILED;
+        }
+        else posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // chunks are claimed in order, let the kernel read ahead
+        atomic_store(&job->desc[idx], fd);
+    }
+    while((fd = atomic_load(&job->desc[idx])) == VC_FILEOPENING) sched_yield(); // another thread is opening it
+    return (fd >= 0) ? fd : -1;
+}
+
+/**
+ * @brief Fold the summaries of the chunks of a file, in order, into its counts and report them.
+ *
+ * Carried out by the thread storing the file's last summary.
+ *
+ * @param job the job
+ * @param idx index of the file
+ */
+static void finishJobFile(struct vcJob * job, size_t idx) {
+    struct wordTally tally;
+    int fd = atomic_load(&job->desc[idx]);
+
+    if(fd >= 0) close(fd);
+    memset(&tally, 0, sizeof(tally));
+    for(size_t c = job->firstChunk[idx]; c < job->firstChunk[idx + 1]; c++) foldChunk(&tally, &job->summaries[c]);
+    finishTally(&tally);
+    storeResult(&tally, (uint64_t)job->sizes[idx], atomic_load(&job->errors[idx]), &job->results[idx]);
+    job->results[idx].seconds = monotonicClock() - job->start[idx];
+    reportJobFile(job, idx);
+
+    vcLock("finishJobFile", &job->pool->lock);
+    if((--job->filesLeft == 0) && (job->workers == 0)) pthread_cond_signal(&job->finished);
+    vcUnlock("finishJobFile", &job->pool->lock);
+}
+
+/**
+ * @brief Read and summarize a chunk of a job.
+ *
+ * A chunk which can not be read is left empty and its file's failure recorded.
+ *
+ * @param job the job
+ * @param c number of the chunk
+ * @param buffer buffer of the thread, room for a chunk (NULL if it could not be allocated)
+ * @return size_t : number of bytes read
+ */
+static size_t countChunk(struct vcJob * job, size_t c, unsigned char * buffer) {
+    size_t lo = 0, hi = job->nPaths; // file of the chunk: the last one starting at or before it (empty files skipped)
+    while(hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(job->firstChunk[mid] <= c) lo = mid;
+        else hi = mid;
+    }
+    size_t idx = lo;
+    off_t start = (off_t)(c - job->firstChunk[idx]) * job->chunkSize;
+    size_t size = (job->sizes[idx] - start < (off_t)job->chunkSize) ? (size_t)(job->sizes[idx] - start) : job->chunkSize;
+    size_t got = 0;
+    int fd = openJobFile(job, idx);
+
+    if(buffer == NULL) failFile(job, idx, ENOMEM);
+    else if(fd >= 0) while(got < size) { // the file may be shorter than stat'ed, what is left is counted
+        ssize_t n = pread(fd, buffer + got, size - got, start + (off_t)got);
+        if(n <= 0) {
+            if((n < 0) && (errno == EINTR)) continue;
+            failFile(job, idx, (n < 0) ? errno : EIO);
+            break;
+        }
+        got += (size_t)n;
+    }
+    if(got > 0) summarizeChunk(buffer, (int)got, &job->summaries[c]);
+    else memset(&job->summaries[c], 0, sizeof(struct chunkSummary)); // folds into nothing
+
+    if(atomic_fetch_sub(&job->pending[idx], 1) == 1) finishJobFile(job, idx);
+    return got;
+}
+
+/**
+ * @brief Life cycle of a pool thread: take the oldest job, count its chunks until none is left to claim, repeat.
+ *
+ * @param args the pool
+ * @return void* : NULL
+ */
+static void * poolThread(void * args) {
+    vc_pool * pool = (vc_pool *)args;
+    unsigned char * buffer = NULL;
+    size_t capacity = 0;
+
+    vcLock("poolThread", &pool->lock);
+    int id = pool->nStarted++;
+    while(true) {
+        while(!pool->quit && (pool->head == NULL)) vcWait("poolThread", &pool->jobPosted, &pool->lock);
+        if(pool->head == NULL) break; // stopping, every job was served
+        struct vcJob * job = pool->head;
+        job->workers++;
+        vcUnlock("poolThread", &pool->lock);
+
+        if(capacity < job->chunkSize) { // the buffer is kept from job to job, grown to the largest chunk size
+            free(buffer);
+            capacity = ((buffer = (unsigned char *)malloc(job->chunkSize)) != NULL) ? job->chunkSize : 0;
+        }
+        size_t c;
+        vc_thread_stats done = {0, 0, 0, 0};
+        while((c = atomic_fetch_add(&job->nextChunk, 1)) < job->nChunks) {
+            double since = monotonicClock();
+            done.bytes += countChunk(job, c, buffer);
+            done.busy += monotonicClock() - since;
+            done.chunks++;
+        }
+
+        vcLock("poolThread", &pool->lock);
+        pool->stats[id].chunks += done.chunks;
+        pool->stats[id].bytes += done.bytes;
+        pool->stats[id].busy += done.busy;
+        if(pool->head == job) { // every chunk was claimed, the next job may start
+            pool->head = job->next;
+            if(pool->head == NULL) pool->tail = NULL;
+        }
+        if((--job->workers == 0) && (job->filesLeft == 0)) pthread_cond_signal(&job->finished);
+    }
+    vcUnlock("poolThread", &pool->lock);
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Start a pool of counting threads.
+ *
+ * @param nThreads number of threads (0 for one per online CPU)
+ * @return vc_pool* : the pool, NULL on failure (errno is set)
+ */
+vc_pool * vc_pool_create(int nThreads) {
+    vc_pool * pool;
+
+    if(nThreads < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if(nThreads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nThreads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if((pool = (vc_pool *)calloc(1, sizeof(vc_pool))) == NULL) return NULL;
+    if(((pool->threads = (pthread_t *)malloc(nThreads * sizeof(pthread_t))) == NULL) ||
+       ((pool->stats = (vc_thread_stats *)calloc(nThreads, sizeof(vc_thread_stats))) == NULL)) {
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    pool->born = monotonicClock();
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->jobPosted, NULL);
+    for(; pool->nThreads < nThreads; pool->nThreads++) {
+        int error = pthread_create(&pool->threads[pool->nThreads], NULL, poolThread, pool);
+        if(error != 0) {
+            vc_pool_destroy(pool);
+            errno = error;
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+/**
+ * @brief Stop a pool of counting threads, once the jobs submitted are done, and free it.
+ *
+ * @param pool the pool (may be NULL)
+ */
+void vc_pool_destroy(vc_pool * pool) {
+    if(pool == NULL) return;
+    vcLock("vc_pool_destroy", &pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->jobPosted);
+    vcUnlock("vc_pool_destroy", &pool->lock);
+    for(int i = 0; i < pool->nThreads; i++) pthread_join(pool->threads[i], NULL);
+    pthread_cond_destroy(&pool->jobPosted);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->stats);
+    free(pool);
+}
+
+/**
+ * @brief Get the work done by each thread of a pool, up to the last job it left.
+ *
+ * A thread's idle time is the time since the pool was started not spent on chunks, so it includes the chunks of
+ * the job it is counting, if any.
+ *
+ * @param pool the pool
+ * @param stats output variable, work done by each thread
+ * @param nStats room of stats, in threads
+ * @return int : number of threads of the pool (stats holds the first nStats of them)
+ */
+int vc_pool_stats(vc_pool * pool, vc_thread_stats * stats, int nStats) {
+    vcLock("vc_pool_stats", &pool->lock);
+    double alive = monotonicClock() - pool->born;
+    for(int i = 0; (i < nStats) && (i < pool->nThreads); i++) {
+        stats[i] = pool->stats[i];
+        stats[i].idle = alive - stats[i].busy;
+    }
+    vcUnlock("vc_pool_stats", &pool->lock);
+    return pool->nThreads;
+}
+
+/**
+ * @brief Free the arrays of a job.
+ *
+ * @param job the job
+ * @param ownResults true if the results were allocated for the job
+ */
+static void freeJob(struct vcJob * job, bool ownResults) {
+    free(job->sizes);
+    free(job->firstChunk);
+    free(job->start);
+    free(job->summaries);
+    free(job->desc);
+    free(job->errors);
+    free(job->pending);
+    if(ownResults) free(job->results);
+}
+
+/**
+ * @brief Count a set of files, cut into chunks shared by the threads of a pool, and wait for them to be done.
+ *
+ * The files are stat'ed up front; empty files and those which can not be stat'ed are reported right away, by the
+ * calling thread.
+ *
+ * @param pool pool of counting threads (NULL for a pool started and stopped for this call only)
+ * @param paths names of the files
+ * @param nPaths number of files
+ * @param chunkSize size, in bytes, of the chunks (0 for VC_CHUNKSIZE), kept between CHUNKSIZE_MIN and CHUNKSIZE_MAX
+ * @param results output variable, counts of each file (may be NULL if done is given)
+ * @param done called as each file is done (may be NULL)
+ * @param arg argument given to done
+ * @return int : 0 on success, -1 if the job could not be started (errno is set)
+ */
+int vc_count_files(vc_pool * pool, const char * const * paths, size_t nPaths, size_t chunkSize,
+                   vc_result * results, vc_file_done done, void * arg) {
+    struct vcJob job;
+    bool ownResults = (results == NULL);
+    off_t totalSize = 0;
+
+    if(nPaths == 0) return 0;
+    if(pool == NULL) { // a pool for this call only
+        int status;
+        if((pool = vc_pool_create(0)) == NULL) return -1;
+        status = vc_count_files(pool, paths, nPaths, chunkSize, results, done, arg);
+        vc_pool_destroy(pool);
+        return status;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.pool = pool;
+    job.paths = paths;
+    job.nPaths = nPaths;
+    job.results = results;
+    job.done = done;
+    job.arg = arg;
+    if((ownResults && ((job.results = (vc_result *)calloc(nPaths, sizeof(vc_result))) == NULL)) ||
+       ((job.sizes = (off_t *)calloc(nPaths, sizeof(off_t))) == NULL) ||
+       ((job.firstChunk = (size_t *)malloc((nPaths + 1) * sizeof(size_t))) == NULL) ||
+       ((job.start = (double *)calloc(nPaths, sizeof(double))) == NULL) ||
+       ((job.desc = (atomic_int *)malloc(nPaths * sizeof(atomic_int))) == NULL) ||
+       ((job.errors = (atomic_int *)malloc(nPaths * sizeof(atomic_int))) == NULL) ||
+       ((job.pending = (atomic_size_t *)malloc(nPaths * sizeof(atomic_size_t))) == NULL)) {
+        freeJob(&job, ownResults);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for(size_t i = 0; i < nPaths; i++) {
+        struct stat st;
+        atomic_init(&job.desc[i], VC_FILECLOSED);
+        atomic_init(&job.errors[i], 0);
+        if(stat(paths[i], &st) == -1) atomic_store(&job.errors[i], errno);
+        else if(S_ISDIR(st.st_mode)) atomic_store(&job.errors[i], EISDIR);
+        else job.sizes[i] = st.st_size;
+        totalSize += job.sizes[i];
+    }
+    if(chunkSize == 0) chunkSize = VC_CHUNKSIZE;
+    if(chunkSize < CHUNKSIZE_MIN) chunkSize = CHUNKSIZE_MIN;
+    if(chunkSize > CHUNKSIZE_MAX) chunkSize = CHUNKSIZE_MAX;
+    while((chunkSize < CHUNKSIZE_MAX) && ((size_t)totalSize / chunkSize > VC_MAXCHUNKS)) chunkSize *= 2;
+    job.chunkSize = (unsigned int)chunkSize;
+
+    job.firstChunk[0] = 0;
+    for(size_t i = 0; i < nPaths; i++) {
+        size_t nChunks = ((size_t)job.sizes[i] + chunkSize - 1) / chunkSize;
+        atomic_init(&job.pending[i], nChunks);
+        job.firstChunk[i + 1] = job.firstChunk[i] + nChunks;
+        if(nChunks > 0) job.filesLeft++;
+    }
+    job.nChunks = job.firstChunk[nPaths];
+    atomic_init(&job.nextChunk, 0);
+    if((job.nChunks > 0) &&
+       ((job.summaries = (struct chunkSummary *)malloc(job.nChunks * sizeof(struct chunkSummary))) == NULL)) {
+        freeJob(&job, ownResults);
+        errno = ENOMEM;
+        return -1;
+    }
+    pthread_mutex_init(&job.reportLock, NULL);
+    pthread_cond_init(&job.finished, NULL);
+
+    for(size_t i = 0; i < nPaths; i++) { // files with no chunks are done already
+        if(job.firstChunk[i + 1] > job.firstChunk[i]) continue;
+        memset(&job.results[i], 0, sizeof(vc_result));
+        job.results[i].error = atomic_load(&job.errors[i]);
+        reportJobFile(&job, i);
+    }
+
+    vcLock("vc_count_files", &pool->lock);
+    if(job.nChunks > 0) {
+        if(pool->tail != NULL) pool->tail->next = &job;
+        else pool->head = &job;
+        pool->tail = &job;
+        pthread_cond_broadcast(&pool->jobPosted);
+    }
+    while((job.filesLeft > 0) || (job.workers > 0)) vcWait("vc_count_files", &job.finished, &pool->lock);
+    vcUnlock("vc_count_files", &pool->lock);
+
+    pthread_cond_destroy(&job.finished);
+    pthread_mutex_destroy(&job.reportLock);
+    freeJob(&job, ownResults);
+    return 0;
+}
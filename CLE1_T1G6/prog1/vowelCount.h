@@ -0,0 +1,140 @@
+/**
+ * @file vowelCount.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Embeddable vowel counting library (libvowelcount), with no global state.
+ *
+ * A text may be counted in memory, in pieces cut at any byte offset, with vc_count_buffer: the state carried from
+ * one piece to the next holds the word going on and the bytes of a cut letter, so the counts are those of the whole
+ * text. Files are counted by a pool of threads which is kept alive from one call to vc_count_files to the next, with
+ * its chunk buffers; several threads may submit files to the same pool, jobs are served in the order they came.
+ *
+ * Built on the kernels of prog1Utils.c, which only hold the kernel picked at the first call.
+ *  Build: gcc -O2 -c vowelCount.c prog1Utils.c && ar rcs libvowelcount.a vowelCount.o prog1Utils.o
+ *  Link:  -lvowelcount -pthread -lm
+ *
+ * Functions:
+ *     \li vc_init
+ *     \li vc_count_buffer
+ *     \li vc_pool_create
+ *     \li vc_pool_destroy
+ *     \li vc_pool_stats
+ *     \li vc_count_files.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef VOWEL_COUNT_H
+#define VOWEL_COUNT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "prog1Utils.h"
+
+/** \brief number of vowels counted (a, e, i, o, u, y). */
+#define VC_VOWELS LETTER_VOWELNUM
+
+/** \brief chunk size, in bytes, files are cut into when none is given. */
+#define VC_CHUNKSIZE (256 * 1024)
+
+/** \brief state of a text counted in pieces, carried from one piece to the next. */
+typedef struct vc_state {
+    struct wordTally tally;     /**< running counts and word state at the end of the last piece */
+    uint64_t bytes;             /**< number of bytes counted */
+} vc_state;
+
+/** \brief counts of a text. */
+typedef struct vc_result {
+    uint64_t words;             /**< number of words */
+    uint64_t vowels[VC_VOWELS]; /**< number of words holding each vowel (a, e, i, o, u, y) */
+    uint64_t bytes;             /**< number of bytes counted */
+    double seconds;             /**< time, in seconds, from the first chunk of the file being claimed to its counts */
+    int error;                  /**< 0, or the errno of the failure which left a file uncounted */
+} vc_result;
+
+/** \brief work done by a pool thread since the pool was started. */
+typedef struct vc_thread_stats {
+    uint64_t chunks;            /**< number of chunks counted */
+    uint64_t bytes;             /**< number of bytes counted */
+    double busy;                /**< time, in seconds, spent reading and counting chunks */
+    double idle;                /**< time, in seconds, spent waiting for jobs or chunks */
+} vc_thread_stats;
+
+/** \brief pool of counting threads. */
+typedef struct vc_pool vc_pool;
+
+/**
+ * @brief Called as each file of vc_count_files is done, from one of the pool threads (never two at once for a job).
+ *
+ * @param index index of the file in the paths given
+ * @param result counts of the file
+ * @param arg argument given to vc_count_files
+ */
+typedef void (*vc_file_done)(size_t index, const vc_result * result, void * arg);
+
+/**
+ * @brief Start counting a new text.
+ *
+ * @param state state of the text
+ */
+extern void vc_init(vc_state * state);
+
+/**
+ * @brief Count the next piece of a text, cut at any byte offset.
+ *
+ * @param text bytes of the piece (may be NULL if size is 0)
+ * @param size size, in bytes, of the piece
+ * @param state state of the text, updated
+ * @param result output variable, counts of the text up to the end of the piece as if it ended there (may be NULL)
+ */
+extern void vc_count_buffer(const uint8_t * text, size_t size, vc_state * state, vc_result * result);
+
+/**
+ * @brief Start a pool of counting threads.
+ *
+ * @param nThreads number of threads (0 for one per online CPU)
+ * @return vc_pool* : the pool, NULL on failure (errno is set)
+ */
+extern vc_pool * vc_pool_create(int nThreads);
+
+/**
+ * @brief Stop a pool of counting threads, once the jobs submitted are done, and free it.
+ *
+ * @param pool the pool (may be NULL)
+ */
+extern void vc_pool_destroy(vc_pool * pool);
+
+/**
+ * @brief Get the work done by each thread of a pool, up to the last job it left.
+ *
+ * @param pool the pool
+ * @param stats output variable, work done by each thread
+ * @param nStats room of stats, in threads
+ * @return int : number of threads of the pool (stats holds the first nStats of them)
+ */
+extern int vc_pool_stats(vc_pool * pool, vc_thread_stats * stats, int nStats);
+
+/**
+ * @brief Count a set of files, cut into chunks shared by the threads of a pool, and wait for them to be done.
+ *
+ * A file which can not be read is reported with its errno in the error field of its result; the others are counted.
+ *
+ * @param pool pool of counting threads (NULL for a pool started and stopped for this call only)
+ * @param paths names of the files
+ * @param nPaths number of files
+ * @param chunkSize size, in bytes, of the chunks (0 for VC_CHUNKSIZE), kept between CHUNKSIZE_MIN and CHUNKSIZE_MAX
+ * @param results output variable, counts of each file (may be NULL if done is given)
+ * @param done called as each file is done (may be NULL)
+ * @param arg argument given to done
+ * @return int : 0 on success, -1 if the job could not be started (errno is set)
+ */
+extern int vc_count_files(vc_pool * pool, const char * const * paths, size_t nPaths, size_t chunkSize,
+                          vc_result * results, vc_file_done done, void * arg);
+
+#endif
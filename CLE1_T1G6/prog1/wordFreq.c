@@ -0,0 +1,555 @@
+/**
+ * @file wordFreq.c (implementation file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Frequency of the words of the files, for the most frequent ones to be reported.
+ *
+ * Each worker's table is WORDSHARDS open-addressing tables probed linearly, the shard picked by the top bits of the
+ * hash of the folded word and the slot by its low bits. Folded words are copied once, the first time they are met,
+ * into an arena of large blocks owned by the table; entries only point to them, so merging moves no bytes. Shards
+ * are merged into those of the first table: mergers claim them with an atomic counter, each keeps the k best words
+ * of a shard in a heap, and the candidates of all shards are sorted at the end.
+ *
+ * Functions:
+ *     \li wordFreqInit
+ *     \li wordFreqChunk
+ *     \li wordFreqStitch
+ *     \li wordFreqTop.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "wordFreq.h"
+#include "prog1Utils.h"
+
+/** \brief number of shards of each table, a power of two */
+#define WORDSHARDS 64
+
+/** \brief bits of the hash picking the shard */
+#define SHARDBITS 6
+
+/** \brief initial number of slots of each shard, a power of two */
+#define SHARDCAPACITY 64
+
+/** \brief share of the slots of a shard which may be used before it is doubled, in percent */
+#define SHARDLOAD 70
+
+/** \brief size, in bytes, of the arena blocks holding the folded words */
+#define ARENABLOCK (1 << 20)
+
+/** \brief initial size, in bytes, of the buffers holding a word being folded and the edges being joined */
+#define WORDBUFFER 256
+
+/** \brief multipliers of the word hash */
+#define HASHPRIME1 0x9E3779B97F4A7C15ULL
+#define HASHPRIME2 0xFF51AFD7ED558CCDULL
+#define HASHPRIME3 0xC4CEB9FE1A85EC53ULL
+
+/** \brief slot of a shard: a folded word and its occurrences */
+struct wordEntry {
+    uint64_t hash;                  /**< hash of the word */
+    const unsigned char * key;      /**< folded bytes of the word, in an arena (NULL if the slot is free) */
+    size_t length;                  /**< number of folded bytes */
+    unsigned long long count;       /**< occurrences of the word */
+};
+
+/** \brief open-addressing table of the words whose hash falls in the shard */
+struct wordShard {
+    struct wordEntry * slots;       /**< slots, a power of two of them */
+    size_t capacity;                /**< number of slots */
+    size_t used;                    /**< number of slots used */
+};
+
+/** \brief block of an arena, the folded words following its header */
+struct arenaBlock {
+    struct arenaBlock * next;       /**< block filled before this one */
+};
+
+/** \brief table of the words met by a worker */
+struct wordTable {
+    struct wordShard shards[WORDSHARDS];    /**< shards, by the top bits of the hash */
+    struct arenaBlock * blocks;             /**< arena blocks, last one first */
+    unsigned char * arenaNext;              /**< first free byte of the last block */
+    size_t arenaLeft;                       /**< free bytes of the last block */
+    unsigned char * word;                   /**< buffer of the word being folded */
+    size_t wordCapacity;                    /**< size of the word buffer */
+    unsigned char * joined;                 /**< buffer of the edges being joined */
+    size_t joinedCapacity;                  /**< size of the joined buffer */
+};
+
+/** \brief merge of the shards, shared by the mergers */
+struct wordMerge {
+    atomic_int nextShard;           /**< next shard to merge */
+    int k;                                      /**< number of candidates kept per shard, at most */
+    struct topWord * candidates[WORDSHARDS];    /**< best words of each shard, a heap */
+    int nCandidates[WORDSHARDS];                /**< number of candidates of each shard */
+    atomic_bool failed;                         /**< memory ran out while merging */
+};
+
+/** \brief table of each worker (NULL until its first chunk) */
+static struct wordTable ** tables = NULL;
+
+/** \brief number of tables */
+static int nTables = 0;
+
+/**
+ * @brief Hash the folded bytes of a word.
+ *
+ * @param key folded bytes
+ * @param length number of bytes
+ * @return uint64_t : hash of the word
+ */
+static uint64_t hashWord(const unsigned char * key, size_t length) {
+    uint64_t h = length * HASHPRIME1, lane;
+    size_t pos = 0;
+
+    for(; pos + 8 <= length; pos += 8) {
+        memcpy(&lane, &key[pos], 8);
+        h = (h ^ lane) * HASHPRIME1;
+        h ^= h >> 29;
+    }
+    if(pos < length) {
+        lane = 0;
+        memcpy(&lane, &key[pos], length - pos);
+        h = (h ^ lane) * HASHPRIME1;
+    }
+    h ^= h >> 33; // avalanche, the shard is picked by the top bits and the slot by the low ones
+    h *= HASHPRIME2;
+    h ^= h >> 33;
+    h *= HASHPRIME3;
+    return h ^ (h >> 33);
+}
+
+/**
+ * @brief Find the slot of a word in a shard: its own, or the free slot it would take.
+ *
+ * @param shard shard of the word
+ * @param hash hash of the word
+ * @param key folded bytes of the word
+ * @param length number of folded bytes
+ * @return struct wordEntry* : slot of the word
+ */
+static struct wordEntry * findSlot(struct wordShard * shard, uint64_t hash, const unsigned char * key, size_t length) {
+    size_t mask = shard->capacity - 1;
+
+    for(size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct wordEntry * slot = &shard->slots[i];
+        if(slot->key == NULL) return slot;
+        if((slot->hash == hash) && (slot->length == length) && (memcmp(slot->key, key, length) == 0)) return slot;
+    }
+}
+
+/**
+ * @brief Make room in a shard for one more word, doubling it once it is SHARDLOAD full.
+ *
+ * @param shard shard
+ * @return true on success, false if memory runs out
+ */
+static bool reserveSlot(struct wordShard * shard) {
+    if((shard->used + 1) * 100 <= shard->capacity * SHARDLOAD) return true;
+
+    struct wordShard grown = {NULL, 2 * shard->capacity, shard->used};
+    if((grown.slots = (struct wordEntry *)calloc(grown.capacity, sizeof(struct wordEntry))) == NULL) return false;
+    for(size_t i = 0; i < shard->capacity; i++) { // hashes are kept, entries are only placed again
+        if(shard->slots[i].key != NULL) *findSlot(&grown, shard->slots[i].hash, shard->slots[i].key, shard->slots[i].length) = shard->slots[i];
+    }
+    free(shard->slots);
+    *shard = grown;
+    return true;
+}
+
+/**
+ * @brief Copy a folded word into the arena of a table.
+ *
+ * @param table table
+ * @param key folded bytes
+ * @param length number of bytes
+ * @return const unsigned char* : copy of the word, NULL if memory runs out
+ */
+static const unsigned char * arenaCopy(struct wordTable * table, const unsigned char * key, size_t length) {
+    if(length > table->arenaLeft) {
+        size_t size = (length > ARENABLOCK / 4) ? length : ARENABLOCK; // long words get a block of their own
+        struct arenaBlock * block;
+        if((block = (struct arenaBlock *)malloc(sizeof(struct arenaBlock) + size)) == NULL) return NULL;
+        if(size == length) { // the last block keeps its free bytes
+            block->next = table->blocks->next;
+            table->blocks->next = block;
+            memcpy(block + 1, key, length);
+            return (const unsigned char *)(block + 1);
+        }
+        block->next = table->blocks;
+        table->blocks = block;
+        table->arenaNext = (unsigned char *)(block + 1);
+        table->arenaLeft = size;
+    }
+    unsigned char * copy = table->arenaNext;
+    memcpy(copy, key, length);
+    table->arenaNext += length;
+    table->arenaLeft -= length;
+    return copy;
+}
+
+/**
+ * @brief Count one occurrence of a folded word in a table.
+ *
+ * @param table table
+ * @param key folded bytes, copied the first time the word is met
+ * @param length number of bytes
+ * @return true on success, false if memory runs out
+ */
+static bool addWord(struct wordTable * table, const unsigned char * key, size_t length) {
+    uint64_t hash = hashWord(key, length);
+    struct wordShard * shard = &table->shards[hash >> (64 - SHARDBITS)];
+    struct wordEntry * slot = findSlot(shard, hash, key, length);
+
+    if(slot->key == NULL) { // first time met
+        if(!reserveSlot(shard)) return false;
+        slot = findSlot(shard, hash, key, length);
+        if((slot->key = arenaCopy(table, key, length)) == NULL) return false;
+        slot->hash = hash;
+        slot->length = length;
+        shard->used++;
+    }
+    slot->count++;
+    return true;
+}
+
+/**
+ * @brief Grow a buffer so it holds at least a given number of bytes.
+ *
+ * @param buffer buffer, reallocated
+ * @param capacity size of the buffer, updated
+ * @param needed number of bytes needed
+ * @return true on success, false if memory runs out
+ */
+static bool growBuffer(unsigned char ** buffer, size_t * capacity, size_t needed) {
+    if(needed <= *capacity) return true;
+
+    size_t grown = *capacity;
+    while(grown < needed) grown *= 2;
+    unsigned char * bytes;
+    if((bytes = (unsigned char *)realloc(*buffer, grown)) == NULL) return false;
+    *buffer = bytes;
+    *capacity = grown;
+    return true;
+}
+
+/**
+ * @brief Get the table of a worker, creating it at its first call.
+ *
+ * @param id worker identification
+ * @return struct wordTable* : table of the worker, NULL if memory runs out
+ */
+static struct wordTable * tableOf(int id) {
+    struct wordTable * table = tables[id];
+
+    if(table != NULL) return table;
+    if((table = (struct wordTable *)calloc(1, sizeof(struct wordTable))) == NULL) return NULL;
+    for(int s = 0; s < WORDSHARDS; s++) {
+        table->shards[s].capacity = SHARDCAPACITY;
+        if((table->shards[s].slots = (struct wordEntry *)calloc(SHARDCAPACITY, sizeof(struct wordEntry))) == NULL) return NULL;
+    }
+    table->wordCapacity = table->joinedCapacity = WORDBUFFER;
+    if(((table->blocks = (struct arenaBlock *)malloc(sizeof(struct arenaBlock) + ARENABLOCK)) == NULL) ||
+       ((table->word = (unsigned char *)malloc(WORDBUFFER)) == NULL) ||
+       ((table->joined = (unsigned char *)malloc(WORDBUFFER)) == NULL)) return NULL;
+    table->blocks->next = NULL;
+    table->arenaNext = (unsigned char *)(table->blocks + 1);
+    table->arenaLeft = ARENABLOCK;
+    return tables[id] = table;
+}
+
+/**
+ * @brief Intern the words of a text starting outside of a word, the last one ending with the text.
+ *
+ * @param table table of the worker
+ * @param text text
+ * @param size size, in bytes, of the text
+ * @return true on success, false if memory runs out
+ */
+static bool internText(struct wordTable * table, const unsigned char * text, size_t size) {
+    unsigned char letter[4];
+    unsigned int step;
+    bool inWord = false;
+    size_t length = 0;
+
+    for(size_t pos = 0; pos < size; pos += step) {
+        const unsigned char * bytes = &text[pos];
+        if(pos + 4 > size) { // letter may be cut by the end of the text, do not read past it
+            for(size_t j = 0; j < 4; j++) letter[j] = (pos + j < size) ? text[pos + j] : 0;
+            bytes = letter;
+        }
+        unsigned char cls = classifyLetter(bytes, &step);
+
+        if(inWord) {
+            if(cls & LETTER_SEPARATOR) {
+                inWord = false;
+                if(!addWord(table, table->word, length)) return false;
+                continue;
+            }
+        }
+        else {
+            if(!(cls & LETTER_WORDSTART)) continue;
+            inWord = true;
+            length = 0;
+        }
+        if((length + 4 > table->wordCapacity) && !growBuffer(&table->word, &table->wordCapacity, length + 4)) return false;
+        if(step == 1) table->word[length++] = ((bytes[0] >= 'A') && (bytes[0] <= 'Z')) ? bytes[0] | 0x20 : bytes[0];
+        else if((step == 2) && (bytes[0] == 0xC3) && ((bytes[1] & 0xC0) == 0x80) && latinLetter[bytes[1] & 0x3F]) {
+            table->word[length++] = latinLetter[bytes[1] & 0x3F];
+        }
+        else for(unsigned int j = 0; (j < step) && (pos + j < size); j++) table->word[length++] = bytes[j];
+    }
+    return !inWord || addWord(table, table->word, length);
+}
+
+/**
+ * @brief Check if a byte is a hard separator: one which ends a word and is outside of any, whatever the word state.
+ *
+ * @param byte byte of the text
+ * @return true if the byte is a separator other than a bracket
+ */
+static inline bool isHardSeparator(unsigned char byte) {
+    return (oneByteClass[byte] & LETTER_SEPARATOR) && !(oneByteClass[byte] & LETTER_WORDSTART) && (byte < 0x80);
+}
+
+/**
+ * @brief Set up the word tables, one per worker.
+ *
+ * @param n number of workers
+ * @return true on success, false if memory runs out
+ */
+bool wordFreqInit(int n) {
+    nTables = n;
+    return (tables = (struct wordTable **)calloc(n, sizeof(struct wordTable *))) != NULL;
+}
+
+/**
+ * @brief Intern the words of a chunk which lie between its first and last hard separator.
+ *
+ * Operation carried out by the workers, on their own table.
+ *
+ * @param id worker identification
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param edges output variable, bytes around the words interned (copied, freed once stitched)
+ * @return true on success, false if memory runs out
+ */
+bool wordFreqChunk(int id, const unsigned char * text, int size, struct wordEdges * edges) {
+    struct wordTable * table;
+    int first = 0, last = size - 1;
+
+    memset(edges, 0, sizeof(struct wordEdges));
+    if((table = tableOf(id)) == NULL) return false;
+    while((first < size) && !isHardSeparator(text[first])) first++;
+    if(first < size) {
+        while(!isHardSeparator(text[last])) last--;
+        edges->cut = true;
+        edges->headSize = first + 1;
+        edges->tailSize = size - last - 1;
+        if(!internText(table, &text[first + 1], last - first)) return false; // the last separator ends the last word
+    }
+    else edges->headSize = size; // the whole chunk may be a piece of a single word
+
+    if(edges->headSize + edges->tailSize == 0) return true;
+    if((edges->bytes = (unsigned char *)malloc(edges->headSize + edges->tailSize)) == NULL) return false;
+    memcpy(edges->bytes, text, edges->headSize);
+    memcpy(&edges->bytes[edges->headSize], &text[size - edges->tailSize], edges->tailSize);
+    return true;
+}
+
+/**
+ * @brief Intern the words cut between the chunks of a file, once all of them were interned.
+ *
+ * Operation carried out by the worker done with the file's last chunk, on its own table. The tail of a chunk and
+ * the head of the next are joined: they start after a hard separator (or at the start of the file), so outside of a
+ * word, and end with one (or at the end of the file). Chunks without one are joined whole.
+ *
+ * @param id worker identification
+ * @param edges edges of the chunks of the file, in order (freed)
+ * @param nChunks number of chunks of the file
+ * @return true on success, false if memory runs out
+ */
+bool wordFreqStitch(int id, struct wordEdges * edges, size_t nChunks) {
+    struct wordTable * table;
+    size_t size = 0;
+    bool ok = ((table = tableOf(id)) != NULL);
+
+    for(size_t c = 0; c < nChunks; c++) {
+        ok = ok && growBuffer(&table->joined, &table->joinedCapacity, size + edges[c].headSize + edges[c].tailSize);
+        if(ok && (edges[c].bytes != NULL)) { // empty chunks have no edges
+            memcpy(&table->joined[size], edges[c].bytes, edges[c].headSize);
+            size += edges[c].headSize;
+            if(edges[c].cut) {
+                ok = internText(table, table->joined, size);
+                memcpy(table->joined, &edges[c].bytes[edges[c].headSize], edges[c].tailSize);
+                size = edges[c].tailSize;
+            }
+        }
+        free(edges[c].bytes);
+        edges[c].bytes = NULL;
+    }
+    return ok && internText(table, table->joined, size);
+}
+
+/**
+ * @brief Check if a word ranks below another: fewer occurrences, or as many and greater folded bytes.
+ *
+ * @param a first word
+ * @param b second word
+ * @return true if a ranks below b
+ */
+static bool ranksBelow(const struct topWord * a, const struct topWord * b) {
+    if(a->count != b->count) return a->count < b->count;
+    size_t common = (a->length < b->length) ? a->length : b->length;
+    int order = memcmp(a->word, b->word, common);
+    return (order != 0) ? (order > 0) : (a->length > b->length);
+}
+
+/**
+ * @brief Compare two words by rank, best first, for qsort.
+ *
+ * @param a first word
+ * @param b second word
+ * @return int : order of the words
+ */
+static int compareRanks(const void * a, const void * b) {
+    if(ranksBelow((const struct topWord *)a, (const struct topWord *)b)) return 1;
+    return ranksBelow((const struct topWord *)b, (const struct topWord *)a) ? -1 : 0;
+}
+
+/**
+ * @brief Offer a word to a min-heap of the best k words, the worst at its root.
+ *
+ * @param heap heap
+ * @param n number of words in the heap, updated
+ * @param k room of the heap
+ * @param word word offered
+ */
+static void offerWord(struct topWord * heap, int * n, int k, const struct topWord * word) {
+    int i;
+
+    if(*n < k) { // sift up
+        for(i = (*n)++; (i > 0) && ranksBelow(word, &heap[(i - 1) / 2]); i = (i - 1) / 2) heap[i] = heap[(i - 1) / 2];
+        heap[i] = *word;
+        return;
+    }
+    if(!ranksBelow(&heap[0], word)) return;
+    for(i = 0;;) { // replace the root and sift down
+        int child = 2 * i + 1;
+        if(child >= k) break;
+        if((child + 1 < k) && ranksBelow(&heap[child + 1], &heap[child])) child++;
+        if(!ranksBelow(&heap[child], word)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = *word;
+}
+
+/**
+ * @brief Merger routine: merge shards into those of the first table and keep the best words of each.
+ *
+ * @param args merge shared by the mergers
+ * @return void* : NULL
+ */
+static void * mergeShards(void * args) {
+    struct wordMerge * merge = (struct wordMerge *)args;
+    int s, first = 0;
+
+    while((first < nTables) && (tables[first] == NULL)) first++;
+    while((s = atomic_fetch_add(&merge->nextShard, 1)) < WORDSHARDS) {
+        struct wordShard * target = &tables[first]->shards[s];
+        for(int t = first + 1; t < nTables; t++) {
+            if(tables[t] == NULL) continue;
+            struct wordShard * source = &tables[t]->shards[s];
+            for(size_t i = 0; i < source->capacity; i++) {
+                struct wordEntry * entry = &source->slots[i];
+                if(entry->key == NULL) continue;
+                struct wordEntry * slot = findSlot(target, entry->hash, entry->key, entry->length);
+                if(slot->key == NULL) {
+                    if(!reserveSlot(target)) {
+                        atomic_store(&merge->failed, true);
+                        return NULL;
+                    }
+                    slot = findSlot(target, entry->hash, entry->key, entry->length);
+                    *slot = *entry; // the key stays in the source's arena
+                    slot->count = 0;
+                    target->used++;
+                }
+                slot->count += entry->count;
+            }
+        }
+        int room = (target->used < (size_t)merge->k) ? (int)target->used : merge->k;
+        if((merge->candidates[s] = (struct topWord *)malloc((room + 1) * sizeof(struct topWord))) == NULL) {
+            atomic_store(&merge->failed, true);
+            return NULL;
+        }
+        for(size_t i = 0; i < target->capacity; i++) {
+            if(target->slots[i].key == NULL) continue;
+            struct topWord word = {(const char *)target->slots[i].key, target->slots[i].length, target->slots[i].count};
+            offerWord(merge->candidates[s], &merge->nCandidates[s], room, &word);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Merge the word tables and pick the most frequent words.
+ *
+ * Operation carried out by the main thread, once the workers are done. Ties are broken by the folded bytes.
+ *
+ * @param k number of words to pick
+ * @param nMergers number of threads merging the shards
+ * @param top output variable, the words picked, most frequent first (allocated, to be freed)
+ * @return int : number of words picked (fewer than k if there are not as many distinct words), -1 on failure
+ */
+int wordFreqTop(int k, int nMergers, struct topWord ** top) {
+    struct wordMerge merge;
+    pthread_t * mergers;
+    size_t total = 0;
+    int n = 0, first = 0;
+
+    *top = NULL;
+    while((first < nTables) && (tables[first] == NULL)) first++;
+    if(first == nTables) return 0; // no word was met
+    memset(&merge, 0, sizeof(struct wordMerge));
+    atomic_init(&merge.nextShard, 0);
+    atomic_init(&merge.failed, false);
+    merge.k = k;
+    if((mergers = (pthread_t *)malloc(nMergers * sizeof(pthread_t))) == NULL) return -1;
+
+    int started = 0;
+    for(; started < nMergers; started++) {
+        if(pthread_create(&mergers[started], NULL, mergeShards, &merge) != 0) break;
+    }
+    if(started == 0) mergeShards(&merge); // no thread could be started, merge alone
+    for(int i = 0; i < started; i++) pthread_join(mergers[i], NULL);
+    free(mergers);
+
+    for(int s = 0; s < WORDSHARDS; s++) total += merge.nCandidates[s];
+    if(!atomic_load(&merge.failed) && ((*top = (struct topWord *)malloc((total + 1) * sizeof(struct topWord))) != NULL)) {
+        for(int s = 0; s < WORDSHARDS; s++) { // the best words of the shards, packed, then sorted
+            memcpy(&(*top)[n], merge.candidates[s], merge.nCandidates[s] * sizeof(struct topWord));
+            n += merge.nCandidates[s];
+        }
+        qsort(*top, n, sizeof(struct topWord), compareRanks);
+        if(n > k) n = k;
+    }
+    else n = -1;
+    for(int s = 0; s < WORDSHARDS; s++) free(merge.candidates[s]);
+    return n;
+}
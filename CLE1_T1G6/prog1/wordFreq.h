@@ -0,0 +1,96 @@
+/**
+ * @file wordFreq.h (interface file)
+ * @author Afonso Campos (afonso.campos@ua.pt)
+ * @author Simão Arrais (simaoarrais@ua.pt)
+ * @brief Problem name: Vowel Count.
+ *
+ * Frequency of the words of the files, for the most frequent ones to be reported.
+ *
+ * Words are segmented as they are counted, and folded as the vowels are: case and the accents of Latin-1 letters are
+ * removed, any other character is kept as is. Each worker interns the words of its chunks into a table of its own,
+ * so no lock is taken while counting; the tables are split into shards by hash, which are merged in parallel, one
+ * shard per merger at a time, once the workers are done.
+ *
+ * Chunks are cut at arbitrary byte offsets, so only the words between the first and the last hard separator of a
+ * chunk (any separator but a bracket, which may also start a word) are interned with it. The bytes around them are
+ * kept as the chunk's edges and interned, in order, by the worker done with the file's last chunk.
+ *
+ * Functions:
+ *     \li wordFreqInit
+ *     \li wordFreqChunk
+ *     \li wordFreqStitch
+ *     \li wordFreqTop.
+ *
+ * @version 0.1
+ * @date 2023-03-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#ifndef WORD_FREQ_H
+#define WORD_FREQ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** \brief bytes of a chunk around the words interned with it, to be joined with those of its neighbours. */
+struct wordEdges {
+    unsigned char * bytes;  /**< head bytes followed by tail bytes (NULL if none) */
+    int headSize;           /**< bytes from the chunk start up to its first hard separator, included (all if none) */
+    int tailSize;           /**< bytes after the last hard separator of the chunk */
+    bool cut;               /**< the chunk holds a hard separator, so the word state is known after its head */
+};
+
+/** \brief word picked among the most frequent ones. */
+struct topWord {
+    const char * word;          /**< folded bytes of the word (not terminated) */
+    size_t length;              /**< number of folded bytes */
+    unsigned long long count;   /**< occurrences of the word */
+};
+
+/**
+ * @brief Set up the word tables, one per worker.
+ *
+ * @param nTables number of workers
+ * @return true on success, false if memory runs out
+ */
+extern bool wordFreqInit(int nTables);
+
+/**
+ * @brief Intern the words of a chunk which lie between its first and last hard separator.
+ *
+ * Operation carried out by the workers, on their own table.
+ *
+ * @param id worker identification
+ * @param text text chunk
+ * @param size size, in bytes, of the text chunk
+ * @param edges output variable, bytes around the words interned (copied, freed once stitched)
+ * @return true on success, false if memory runs out
+ */
+extern bool wordFreqChunk(int id, const unsigned char * text, int size, struct wordEdges * edges);
+
+/**
+ * @brief Intern the words cut between the chunks of a file, once all of them were interned.
+ *
+ * Operation carried out by the worker done with the file's last chunk, on its own table.
+ *
+ * @param id worker identification
+ * @param edges edges of the chunks of the file, in order (freed)
+ * @param nChunks number of chunks of the file
+ * @return true on success, false if memory runs out
+ */
+extern bool wordFreqStitch(int id, struct wordEdges * edges, size_t nChunks);
+
+/**
+ * @brief Merge the word tables and pick the most frequent words.
+ *
+ * Operation carried out by the main thread, once the workers are done. Ties are broken by the folded bytes.
+ *
+ * @param k number of words to pick
+ * @param nMergers number of threads merging the shards
+ * @param top output variable, the words picked, most frequent first (allocated, to be freed)
+ * @return int : number of words picked (fewer than k if there are not as many distinct words), -1 on failure
+ */
+extern int wordFreqTop(int k, int nMergers, struct topWord ** top);
+
+#endif
@@ -0,0 +1 @@
+../prog1/monitorProbe.c
\ No newline at end of file
@@ -0,0 +1 @@
+../prog1/monitorProbe.h
\ No newline at end of file
@@ -0,0 +1 @@
+../prog1/perfCounters.c
\ No newline at end of file
@@ -0,0 +1 @@
+../prog1/perfCounters.h
\ No newline at end of file
@@ -20,13 +20,17 @@
 #include <stdlib.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <string.h>
+#include <errno.h>
 
 #include "prog2SM.h"
 #include "prog2Utils.h"
 #include "probConst.h"
+#include "traceEvents.h"
+#include "perfCounters.h"
 
 /** \brief return status on monitor initialization */
 int statusInitMon;
@@ -55,6 +59,31 @@ int nThreads = 4;
 /** \brief sorting order, positive integer for increasing */
 int dir = 1;
 
+/** \brief profiled phase: loading the sequence from the file */
+#define PHASE_LOAD 0
+
+/** \brief profiled phase: sorting a subsequence locally */
+#define PHASE_SORT 1
+
+/** \brief profiled phase: merging bitonic subsequences, one per level (PHASE_MERGE + level - 1) */
+#define PHASE_MERGE 2
+
+/** \brief number of merge levels profiled apart, deeper levels are charged to the last one */
+#define MERGELEVELS 16
+
+/** \brief names of the profiled phases */
+static const char * phaseNames[PHASE_MERGE + MERGELEVELS + 1] = {"load", "sort"};
+
+/** \brief profiled phase: validating the sorted sequence, after the merge levels */
+static int phaseValidate = PHASE_MERGE;
+
+/** \brief long command line options */
+static const struct option longOptions[] = {
+    {"trace", required_argument, NULL, 'T'},
+    {"perf", no_argument, NULL, 'P'},
+    {NULL, 0, NULL, 0}
+};
+
 /**
  * @brief Main thread.
  *
@@ -70,6 +99,8 @@ int main(int argc, char *argv[]) {
     // Process the command line options
     int opt;
     char * file;
+    char * traceFile = NULL;
+    bool profile = false;
 
     if((file = (char *)malloc((MAXFILENAMELEN+1) * sizeof(char))) == NULL) {
         fprintf(stderr, "Error allocating memory.\n");
@@ -80,7 +111,7 @@ int main(int argc, char *argv[]) {
     opterr = 0;
     do {
         bool errFlg = false;
-        switch (opt = getopt(argc, argv, "t:f:d:")) {
+        switch (opt = getopt_long(argc, argv, "t:f:d:", longOptions, NULL)) {
             case 't':
                 if(atoi(optarg) <= 0) {
                     fprintf(stderr, "%s: number of threads must be a positive integer!\n", basename(argv[0]));
@@ -102,6 +133,12 @@ int main(int argc, char *argv[]) {
                 }
                 dir = (int) atoi(optarg);
                 break;
+            case 'T':
+                traceFile = optarg;
+                break;
+            case 'P':
+                profile = true;
+                break;
             case '?': 
                 fprintf (stderr, "%s: invalid option\n", basename (argv[0]));
                 errFlg = true;
@@ -115,6 +152,25 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    if((traceFile != NULL) && !traceOpen(traceFile, basename(argv[0]), 0)) {
+        fprintf(stderr, "Error on allocating space to the trace.\n");
+        return EXIT_FAILURE;
+    }
+    traceThread("main", 0);
+    if(profile) { // one phase per merge level, the number of active workers is halved after each
+        int nPhases = PHASE_MERGE;
+        for(int workers = nThreads; (workers > 1) && (nPhases < PHASE_MERGE + MERGELEVELS); workers /= 2, nPhases++) {
+            char * name;
+            if((name = (char *)malloc(32)) == NULL) break;
+            snprintf(name, 32, "merge level %d", nPhases - PHASE_MERGE + 1);
+            phaseNames[nPhases] = name;
+        }
+        phaseValidate = nPhases;
+        phaseNames[nPhases++] = "validate";
+        perfInit(phaseNames, nPhases);
+    }
+    perfThreadStart("main", 0);
+
     if((statusWorker = malloc (nThreads * sizeof (int))) == NULL) {
         fprintf(stderr, "Error on allocating space to the return status arrays of worker threads.\n");
         exit(EXIT_FAILURE);
@@ -168,10 +224,16 @@ int main(int argc, char *argv[]) {
     printf("its status was %d\n", *pStatus);
 
     // check if sequence is properly sorted
+    struct perfSample sample;
+    perfBegin(&sample);
     validateSequence();
+    perfEnd(phaseValidate, &sample);
+    perfThreadStop();
 
     printf ("\nElapsed time = %.6f s\n", get_delta_time ());
-    
+    if(!traceClose()) fprintf(stderr, "Error on writing trace file %s: %s\n", traceFile, strerror(errno));
+    perfReport();
+
     return 0;
 }
 
@@ -184,13 +246,24 @@ int main(int argc, char *argv[]) {
  * @return void* 
  */
 static void *distributor(void * args) {
+    traceThread("distributor", 0);
+    perfThreadStart("distributor", 0);
+
     // read file sequence and store in SM
+    double spanStart = traceNow();
+    struct perfSample sample;
+    perfBegin(&sample);
     readFromFileAndStore();
+    perfEnd(PHASE_LOAD, &sample);
+    perfThreadStop();
+    traceSpan("read", "io", spanStart);
     int nActiveWorkers = nThreads;
 
     while(true) { // while the whole sequence is not sorted
         // distribute ranges to workers (reduce worker number in half each iteration)
+        spanStart = traceNow();
         distributeRanges(&nActiveWorkers);
+        traceSpan("round", "sync", spanStart);
         if(nActiveWorkers == 0) break;
     }
     
@@ -210,23 +283,43 @@ static void *worker(void * args) {
     unsigned int id = *((unsigned int *) args);
     bool quit = false;
 
+    int level = 0; // merge level of the last merge
+    traceThread("worker", id);
+    perfThreadStart("worker", id);
     while(true) {
         int command = 0;
         int chunkSize;
         int * chunk;
         // get pointer to subsequence and its size
+        double spanStart = traceNow();
         quit = fetchSubSequence(id, &command, &chunkSize, &chunk);
+        traceSpan("barrier (fetch)", "sync", spanStart);
 
         if(quit) break;
 
         // sort the subsequence
         int localDir = command < 0 ? -1 : 1;
-        if(command == ORDER_NON_BITONIC_DCR || command == ORDER_NON_BITONIC_INCR) bitonicSort(&chunk, 0, chunkSize, localDir);
-        else if(command == ORDER_BITONIC_DCR || command == ORDER_BITONIC_INCR) bitonicMerge(&chunk, 0, chunkSize, localDir);
+        spanStart = traceNow();
+        struct perfSample sample;
+        perfBegin(&sample);
+        if(command == ORDER_NON_BITONIC_DCR || command == ORDER_NON_BITONIC_INCR) {
+            bitonicSort(&chunk, 0, chunkSize, localDir);
+            perfEnd(PHASE_SORT, &sample);
+            traceSpan("sort", "cpu", spanStart);
+        }
+        else if(command == ORDER_BITONIC_DCR || command == ORDER_BITONIC_INCR) {
+            bitonicMerge(&chunk, 0, chunkSize, localDir);
+            if(level < MERGELEVELS) level++;
+            perfEnd(PHASE_MERGE + level - 1, &sample);
+            traceSpan("merge", "cpu", spanStart);
+        }
 
         // tell distributor you're finished sorting
+        spanStart = traceNow();
         signalFinished(id);
+        traceSpan("barrier (finish)", "sync", spanStart);
     }
+    perfThreadStop();
 
     statusWorker[id] = EXIT_SUCCESS;
     pthread_exit(&statusWorker[id]);
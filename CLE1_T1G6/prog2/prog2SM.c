@@ -8,7 +8,8 @@
  *  Both threads and the monitor are implemented using the pthread library which enables the creation of a
  *  monitor of the Lampson / Redell type.
  *
- *  Data transfer region implemented as a monitor.
+ *  Data transfer region implemented as a monitor, entered and left through the wrappers of monitorProbe.h, which time
+ *  them when built with -DMONITOR_PROBE.
  *
  *  Definition of the operations carried out by the threads:
  *     \li (distributor) readFromFileAndStore
@@ -34,6 +35,7 @@
 
 #include "probConst.h"
 #include "prog2SM.h"
+#include "monitorProbe.h"
 
 /** \brief return status on monitor initialization */
 extern int statusInitMon;
@@ -137,7 +139,7 @@ static void initialization(void) {
  * @param fileName name of the file to be stored
  */
 void storeFileName(char * fileName) {
-    statusMain = pthread_mutex_lock(&accessCR);
+    statusMain = monitorLock("storeFileName", &accessCR);
     if(statusMain) {
         errno = statusMain;
         perror("Error on main thread entering monitor (CF).");
@@ -147,7 +149,7 @@ void storeFileName(char * fileName) {
 
     file = fileName;
 
-    statusMain = pthread_mutex_unlock(&accessCR);
+    statusMain = monitorUnlock("storeFileName", &accessCR);
     if(statusMain) {
         errno = statusMain;
         perror("Error on main thread exiting monitor (CF).");
@@ -162,7 +164,7 @@ void storeFileName(char * fileName) {
  * 
  */
 void readFromFileAndStore() {
-    statusDistributor = pthread_mutex_lock(&accessCR);
+    statusDistributor = monitorLock("readFromFileAndStore", &accessCR);
     if(statusDistributor) {
         errno = statusDistributor;
         perror("Error on distributor thread entering monitor (CF).");
@@ -190,7 +192,7 @@ void readFromFileAndStore() {
 
     fclose(fp);
 
-    statusDistributor = pthread_mutex_unlock(&accessCR);
+    statusDistributor = monitorUnlock("readFromFileAndStore", &accessCR);
     if(statusDistributor) {
         errno = statusDistributor;
         perror("Error on distributor thread exiting monitor (CF).");
@@ -208,7 +210,7 @@ void readFromFileAndStore() {
  * @param activeWorkers number of workers currently still alive
  */
 void distributeRanges(int * activeWorkers) {
-    statusDistributor = pthread_mutex_lock(&accessCR);
+    statusDistributor = monitorLock("distributeRanges", &accessCR);
     if(statusDistributor) {
         errno = statusDistributor;
         perror("Error on distributor thread entering monitor (CF).");
@@ -217,7 +219,7 @@ void distributeRanges(int * activeWorkers) {
 
     // wait for all workers to be free
     while(waitingWorkers < *activeWorkers) {
-        if((statusDistributor = pthread_cond_wait(&allWorkersWaiting, &accessCR)) != 0) {
+        if((statusDistributor = monitorWait("distributeRanges", &allWorkersWaiting, &accessCR)) != 0) {
             errno = statusDistributor;
             perror("Error on waiting in allWorkersWaiting");
             statusDistributor = EXIT_FAILURE;
@@ -259,7 +261,7 @@ void distributeRanges(int * activeWorkers) {
 
     // wait for workers to finish
     while(finishedWorkers != *activeWorkers) { // while not all workers have finsihed, wait
-        if((statusDistributor = pthread_cond_wait(&allWorkersFinished, &accessCR)) != 0) {
+        if((statusDistributor = monitorWait("distributeRanges", &allWorkersFinished, &accessCR)) != 0) {
             errno = statusDistributor;
             perror("Error on waiting in allWorkersFinished");
             statusDistributor = EXIT_FAILURE;
@@ -283,7 +285,7 @@ void distributeRanges(int * activeWorkers) {
         pthread_exit(&statusDistributor);
     }
 
-    statusDistributor = pthread_mutex_unlock(&accessCR);
+    statusDistributor = monitorUnlock("distributeRanges", &accessCR);
     if(statusDistributor) {
         errno = statusDistributor;
         perror("Error on distributor thread exiting monitor (CF).");
@@ -304,7 +306,7 @@ void distributeRanges(int * activeWorkers) {
  * @return false : the worker should continue it's life cycle
  */
 bool fetchSubSequence(unsigned int workerID, int * command, int * chunkSize, int ** chunk) {
-    statusWorker[workerID] = pthread_mutex_lock(&accessCR);
+    statusWorker[workerID] = monitorLock("fetchSubSequence", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
         perror("Error on distributor thread entering monitor (CF).");
@@ -313,7 +315,7 @@ bool fetchSubSequence(unsigned int workerID, int * command, int * chunkSize, int
 
     // check assigned state, if DIE quit successfully
     if(workerCommand[workerID] == DIE) {
-        statusWorker[workerID] = pthread_mutex_unlock(&accessCR); // leave monitor
+        statusWorker[workerID] = monitorUnlock("fetchSubSequence", &accessCR); // leave monitor
         if(statusWorker[workerID]) {
             errno = statusWorker[workerID];
             perror("Error on leaving monitor (CF).");
@@ -334,7 +336,7 @@ bool fetchSubSequence(unsigned int workerID, int * command, int * chunkSize, int
     }
 
     // wait for distributor to distribute ranges and commands
-    if((statusWorker[workerID] = pthread_cond_wait(&waitForWork, &accessCR)) != 0) {
+    if((statusWorker[workerID] = monitorWait("fetchSubSequence", &waitForWork, &accessCR)) != 0) {
         errno = statusWorker[workerID];
         perror("Error on waiting in waitForWork");
         statusWorker[workerID] = EXIT_FAILURE;
@@ -348,7 +350,7 @@ bool fetchSubSequence(unsigned int workerID, int * command, int * chunkSize, int
     *chunkSize = workerRange[workerID][1] - workerRange[workerID][0] + 1;
     *chunk = &sequence[workerRange[workerID][0]];
 
-    statusWorker[workerID] = pthread_mutex_unlock(&accessCR);
+    statusWorker[workerID] = monitorUnlock("fetchSubSequence", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
         perror("Error on distributor thread exiting monitor (CF).");
@@ -366,7 +368,7 @@ bool fetchSubSequence(unsigned int workerID, int * command, int * chunkSize, int
  * @param workerID worker identification
  */
 void signalFinished(unsigned int workerID) {
-    statusWorker[workerID] = pthread_mutex_lock(&accessCR);
+    statusWorker[workerID] = monitorLock("signalFinished", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
         perror("Error on distributor thread entering monitor (CF).");
@@ -385,14 +387,14 @@ void signalFinished(unsigned int workerID) {
     }
 
     // wait for distributor to close up this run
-    if((statusWorker[workerID] = pthread_cond_wait(&waitForWork, &accessCR)) != 0) {
+    if((statusWorker[workerID] = monitorWait("signalFinished", &waitForWork, &accessCR)) != 0) {
         errno = statusWorker[workerID];
         perror("Error on waiting in waitForWork");
         statusWorker[workerID] = EXIT_FAILURE;
         pthread_exit(&statusWorker[workerID]);
     }
 
-    statusWorker[workerID] = pthread_mutex_unlock(&accessCR);
+    statusWorker[workerID] = monitorUnlock("signalFinished", &accessCR);
     if(statusWorker[workerID]) {
         errno = statusWorker[workerID];
         perror("Error on distributor thread exiting monitor (CF).");
@@ -407,7 +409,7 @@ void signalFinished(unsigned int workerID) {
  * 
  */
 void validateSequence() {
-    statusMain = pthread_mutex_lock(&accessCR);
+    statusMain = monitorLock("validateSequence", &accessCR);
     if(statusMain) {
         errno = statusMain;
         perror("Error on main thread entering monitor (CF).");
@@ -434,7 +436,7 @@ void validateSequence() {
     }
     if(i == (sequenceSize-1)) printf("Everything is OK!\n");
 
-    statusMain = pthread_mutex_unlock(&accessCR);
+    statusMain = monitorUnlock("validateSequence", &accessCR);
     if(statusMain) {
         errno = statusMain;
         perror("Error on main thread exiting monitor (CF).");
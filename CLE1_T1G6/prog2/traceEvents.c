@@ -0,0 +1 @@
+../prog1/traceEvents.c
\ No newline at end of file
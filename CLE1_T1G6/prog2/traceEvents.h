@@ -0,0 +1 @@
+../prog1/traceEvents.h
\ No newline at end of file
@@ -19,25 +19,242 @@
 #include <stdlib.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
 
 #include "prog1Utils.h"
+#include "prog1Files.h"
+#include "prog1Report.h"
+#include "traceEvents.h"
 
-/** \brief maximum string length for a file name. */
-#define MAXFILENAMELEN 30
-
-/** \brief maximum number of files as input. */
-#define MAXFILECOUNT 10
-
-/** \brief maximum chunk size for each worker to read. */
+/** \brief default chunk size for each worker to read. */
 #define MAXTEXTSIZE 4000
 
+/** \brief fixed cost, in seconds, of handing a chunk to a worker (a message round trip), to tune the chunk size. */
+#define CHUNKCOST 5.0e-5
+
 /** \brief number of defined vowels. */
 #define VOWELNUM 6
 
-/** \brief list of characters considered vowels */
-static unsigned char vowels[6] = {'a', 'e', 'i', 'o', 'u', 'y'};
+/** \brief maximum number of trace spans sent to the dispatcher in one message, received into a buffer on its stack. */
+#define TRACEBLOCK 256
+
+/** \brief maximum number of chunk summaries a worker sends to the dispatcher in one message. */
+#define SUMMARYBATCH 64
+
+/** \brief bytes of text a worker summarizes at most before sending the summaries held, so files are reported soon. */
+#define SUMMARYBATCHBYTES (1024 * 1024)
+
+/** \brief message tag of the batches of chunk summaries, apart from the chunks handed out and the run report. */
+#define SUMMARYTAG 1
+
+/** \brief initial number of chunks handed out and not folded yet the dispatcher has room for. */
+#define PENDINGCHUNKS 64
+
+/** \brief long command line options */
+static const struct option longOptions[] = {
+    {"format", required_argument, NULL, 'F'},
+    {"trace", required_argument, NULL, 'T'},
+    {NULL, 0, NULL, 0}
+};
+
+/** \brief summary of a text chunk, with the index of the chunk in the order chunks were handed out. */
+struct summaryRecord {
+    unsigned long long chunk;       /**< index of the chunk */
+    struct chunkSummary summary;    /**< summary of the chunk */
+};
+
+/** \brief batch of summary records sent to the dispatcher without waiting, kept until the send completes. */
+struct summaryBatch {
+    MPI_Request request;                            /**< send of the batch (MPI_REQUEST_NULL if none is pending) */
+    int nRecords;                                   /**< number of records */
+    struct summaryRecord records[SUMMARYBATCH];     /**< records, in the order the chunks were summarized */
+};
+
+/** \brief summary records of a worker not known to be sent yet. */
+struct summaryBatches {
+    struct summaryBatch ** batches;     /**< batches, being sent or free */
+    int nBatches;                       /**< number of batches */
+    struct summaryBatch * filling;      /**< batch being filled (NULL if none) */
+    unsigned long long bytes;           /**< bytes of text summarized by the records of the batch being filled */
+};
+
+/** \brief chunk handed out whose summary was not folded yet. */
+struct pendingChunk {
+    int file;                       /**< file the chunk belongs to */
+    bool arrived;                   /**< the summary of the chunk was received */
+    struct chunkSummary summary;    /**< summary of the chunk, once received */
+};
+
+/** \brief chunks handed out by the dispatcher whose summaries were not folded yet, in a ring indexed by chunk index. */
+struct pendingChunks {
+    struct pendingChunk * slots;    /**< ring of chunks, chunk i being in slot i modulo capacity */
+    unsigned long long capacity;    /**< number of slots (a power of two, 0 before the first chunk) */
+    unsigned long long handedOut;   /**< number of chunks handed out */
+    unsigned long long folded;      /**< number of chunks whose summary was folded, in hand-out order */
+};
+
+/**
+ * @brief Send the batch of summary records being filled to the dispatcher, without waiting.
+ *
+ * @param out summary records of the worker
+ */
+static void sendSummaries(struct summaryBatches * out) {
+    double spanStart = traceNow();
+    MPI_Isend(out->filling->records, out->filling->nRecords * sizeof(struct summaryRecord), MPI_BYTE, 0, SUMMARYTAG,
+              MPI_COMM_WORLD, &out->filling->request);
+    traceSpan("send summaries", "mpi", spanStart);
+    out->filling = NULL;
+    out->bytes = 0;
+}
+
+/**
+ * @brief Store the summary of a text chunk, sending the summaries held once there are enough of them.
+ *
+ * The batch filled is one whose send completed, or a new one: the worker never waits for the dispatcher to receive.
+ *
+ * @param out summary records of the worker
+ * @param chunk index of the chunk
+ * @param summary summary of the chunk
+ * @param bytes size, in bytes, of the chunk
+ * @return true on success, false if memory runs out
+ */
+static bool storeSummary(struct summaryBatches * out, unsigned long long chunk, const struct chunkSummary * summary,
+                         int bytes) {
+    for(int b = 0; (out->filling == NULL) && (b < out->nBatches); b++) { // reuse a batch already sent
+        int sent = true;
+        if(out->batches[b]->request != MPI_REQUEST_NULL) MPI_Test(&out->batches[b]->request, &sent, MPI_STATUS_IGNORE);
+        if(sent) {
+            out->filling = out->batches[b];
+            out->filling->nRecords = 0;
+        }
+    }
+    if(out->filling == NULL) {
+        struct summaryBatch ** batches;
+        if((batches = (struct summaryBatch **)realloc(out->batches, (out->nBatches + 1) * sizeof(struct summaryBatch *))) == NULL) {
+            return false;
+        }
+        out->batches = batches;
+        if((out->filling = (struct summaryBatch *)malloc(sizeof(struct summaryBatch))) == NULL) return false;
+        out->filling->request = MPI_REQUEST_NULL;
+        out->filling->nRecords = 0;
+        out->batches[out->nBatches++] = out->filling;
+    }
+
+    struct summaryRecord * record = &out->filling->records[out->filling->nRecords++];
+    record->chunk = chunk;
+    record->summary = *summary;
+    out->bytes += bytes + 1; // an empty chunk still counts
+    if((out->filling->nRecords == SUMMARYBATCH) || (out->bytes >= SUMMARYBATCHBYTES)) sendSummaries(out);
+    return true;
+}
+
+/**
+ * @brief Send the summary records left to the dispatcher and wait until every batch was sent.
+ *
+ * @param out summary records of the worker, freed
+ */
+static void endSummaries(struct summaryBatches * out) {
+    if(out->filling != NULL) sendSummaries(out);
+    for(int b = 0; b < out->nBatches; b++) {
+        MPI_Wait(&out->batches[b]->request, MPI_STATUS_IGNORE);
+        free(out->batches[b]);
+    }
+    free(out->batches);
+}
+
+/**
+ * @brief Give the next chunk to be handed out an index, growing the ring of pending chunks if it is full.
+ *
+ * @param pending chunks handed out whose summaries were not folded yet
+ * @param file file the chunk belongs to
+ * @param chunk output variable, index of the chunk
+ * @return true on success, false if memory runs out
+ */
+static bool handOutChunk(struct pendingChunks * pending, int file, unsigned long long * chunk) {
+    if(pending->handedOut - pending->folded == pending->capacity) { // double the ring, chunks keep their index
+        unsigned long long capacity = (pending->capacity > 0) ? 2 * pending->capacity : PENDINGCHUNKS;
+        struct pendingChunk * slots;
+        if((slots = (struct pendingChunk *)malloc(capacity * sizeof(struct pendingChunk))) == NULL) return false;
+        for(unsigned long long i = pending->folded; i < pending->handedOut; i++) {
+            slots[i & (capacity - 1)] = pending->slots[i & (pending->capacity - 1)];
+        }
+        free(pending->slots);
+        pending->slots = slots;
+        pending->capacity = capacity;
+    }
+    struct pendingChunk * slot = &pending->slots[pending->handedOut & (pending->capacity - 1)];
+    slot->file = file;
+    slot->arrived = false;
+    *chunk = pending->handedOut++;
+    return true;
+}
+
+/**
+ * @brief Receive the batches of summary records sent by the workers and store the summaries by chunk index.
+ *
+ * @param pending chunks handed out whose summaries were not folded yet
+ * @param records buffer of SUMMARYBATCH records
+ * @param wait true to wait for a batch if none has arrived, false to only take those already arrived
+ */
+static void receiveSummaries(struct pendingChunks * pending, struct summaryRecord * records, bool wait) {
+    int arrived = wait;
+
+    if(!wait) MPI_Iprobe(MPI_ANY_SOURCE, SUMMARYTAG, MPI_COMM_WORLD, &arrived, MPI_STATUS_IGNORE);
+    while(arrived) {
+        MPI_Status status;
+        int size;
+        double spanStart = traceNow();
+        MPI_Recv(records, SUMMARYBATCH * sizeof(struct summaryRecord), MPI_BYTE, MPI_ANY_SOURCE, SUMMARYTAG,
+                 MPI_COMM_WORLD, &status);
+        traceSpan("recv summaries", "mpi", spanStart);
+        MPI_Get_count(&status, MPI_BYTE, &size);
+        for(int r = 0; r < size / (int)sizeof(struct summaryRecord); r++) {
+            struct pendingChunk * slot = &pending->slots[records[r].chunk & (pending->capacity - 1)];
+            slot->summary = records[r].summary;
+            slot->arrived = true;
+        }
+        MPI_Iprobe(MPI_ANY_SOURCE, SUMMARYTAG, MPI_COMM_WORLD, &arrived, MPI_STATUS_IGNORE);
+    }
+}
+
+/**
+ * @brief Take the next chunk to be folded, in hand-out order, if its summary arrived.
+ *
+ * @param pending chunks handed out whose summaries were not folded yet
+ * @return chunk whose summary is to be folded now (valid until the next chunk is handed out), NULL if none
+ */
+static struct pendingChunk * nextFolded(struct pendingChunks * pending) {
+    if(pending->folded == pending->handedOut) return NULL;
+    struct pendingChunk * slot = &pending->slots[pending->folded & (pending->capacity - 1)];
+    if(!slot->arrived) return NULL;
+    pending->folded++;
+    return slot;
+}
+
+/**
+ * @brief Finish the counts of a file once the summaries of all its chunks were folded, and report them.
+ *
+ * The output is flushed, so whoever reads it may start on the file while the next ones are still being processed.
+ *
+ * @param format output format
+ * @param name file name
+ * @param bytes number of bytes of the file
+ * @param start time at which the first chunk of the file was handed out
+ * @param tally running counts of the file
+ * @param wordCount output variable, number of words of the file
+ * @param vowelCounts output variable, number of words of the file holding each vowel
+ * @param error errno of the failure which left the file uncounted or cut short, 0 if none
+ */
+static void finishFile(int format, const char * name, off_t bytes, double start, struct wordTally * tally,
+                       unsigned long long * wordCount, unsigned long long * vowelCounts, int error) {
+    finishTally(tally);
+    *wordCount = tally->words;
+    for(int j = 0; j < VOWELNUM; j++) vowelCounts[j] = tally->vowels[j];
+    reportFile(format, name, (long long)bytes, wallClock() - start, *wordCount, vowelCounts, error);
+}
 
 int main(int argc, char *argv[]) {
     int rank, totProc;
@@ -45,8 +262,12 @@ int main(int argc, char *argv[]) {
     MPI_Init (&argc, &argv);
     MPI_Comm_rank (MPI_COMM_WORLD, &rank);
     MPI_Comm_size (MPI_COMM_WORLD, &totProc);
+    double runStart = wallClock();
 
     // Memory for dispatcher
+    /** \brief list of the names of the files, in the order they were given */
+    struct fileList fileNames = {NULL, 0, 0};
+
     /** \brief array of file name for each file */
     char ** files;
 
@@ -54,56 +275,91 @@ int main(int argc, char *argv[]) {
     int nFiles = 0;
 
     /** \brief array of word counts for each file */
-    unsigned int * wordCount;
+    unsigned long long * wordCount;
 
     /** \brief 2D array of vowel count for each file and vowel */
-    unsigned int ** vowelCounts;
+    unsigned long long ** vowelCounts;
+
+    /** \brief array of running counts of each file, chunk summaries are folded into them in order */
+    struct wordTally * tallies;
+
+    /** \brief chunks handed out whose summaries were not folded yet */
+    struct pendingChunks pending = {NULL, 0, 0, 0};
+
+    /** \brief buffer the batches of summary records are received into */
+    struct summaryRecord * received;
 
     /** \brief array of pointers signaling the bytes already processed for each file */
-    unsigned int * fileBuffer;
+    off_t * fileBuffer;
 
     /** \brief boolean array signaling if a file is done being processed */
     bool * fileOver;
 
+    /** \brief array of the errno of the failure which left each file uncounted or cut short, 0 if none */
+    int * fileError = NULL;
+
+    /** \brief flag signaling if a file could not be counted in full, the run then ends with a failure */
+    bool filesFailed = false;
+
+    /** \brief array of the number of chunks of each file handed out whose summary was not folded yet */
+    unsigned int * chunksOut;
+
+    /** \brief array of the times at which the first chunk of each file was handed out */
+    double * fileStart;
+
+    /** \brief output format of the results (FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV) */
+    int outputFormat = FORMAT_TEXT;
+
+    /** \brief array of the work done by each worker (rank i + 1) */
+    struct workerStats * workerStats;
+
     /** \brief file currently being processed */
     int currFile;
 
-    /** \brief array of pointers to the file each worker is processing */
-    int * currFileWorker;
-
     // Memory for worker
     int chunkSize;
 
+    /** \brief summary of a text chunk */
+    struct chunkSummary summary;
+
+    /** \brief index of the received text chunk, in the order chunks were handed out */
+    unsigned long long chunkIndex;
+
+    /** \brief summaries of the text chunks processed, sent to the dispatcher in batches */
+    struct summaryBatches summaries = {NULL, 0, NULL, 0};
+
+    /** \brief work done by this worker */
+    struct workerStats stats = {0, 0, 0, 0};
+
     // Memory for both
-    unsigned char chunk[MAXTEXTSIZE];
-    // if((chunk = (unsigned char *)malloc(MAXTEXTSIZE * sizeof(unsigned char))) == NULL) {
-    //     printf(stderr, "Error on allocating memory for text chunk.");
-    //     MPI_Finalize();
-    //     return EXIT_FAILURE;
-    // }
+    /** \brief size, in bytes, of the text chunks the files are cut into (0 to tune it) */
+    unsigned int textSize = MAXTEXTSIZE;
+
+    unsigned char * chunk;
 
     /** \brief flag signaling if the work is finished (all files processed) */
     bool workFinished = false;
 
+    /** \brief name of the trace file, only known to the dispatcher (NULL if no trace is written) */
+    char * traceFile = NULL;
+
+    /** \brief flag signaling if a trace is recorded, on every rank */
+    bool tracing;
+
+    if(totProc < 2) {
+        fprintf(stderr, "At least two processes are needed: a dispatcher and a worker.\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
     if(rank == 0) { // init dispatcher structures
         int opt;
 
-        if((files = (char **)malloc(MAXFILECOUNT * sizeof(char *))) == NULL) {
-            fprintf(stderr, "Error allocating memory for file names.\n");
-            return EXIT_FAILURE;
-        }
-        for(int i = 0; i < MAXFILECOUNT; i++) {
-            if((files[i] = (char *)malloc((MAXFILENAMELEN+1) * sizeof(char))) == NULL) {
-                fprintf(stderr, "Error allocating memory for file names.\n");
-                return EXIT_FAILURE;
-            }
-        }
-
         // Process Command Line
         opterr = 0;
         do {
             bool errFlg = false;
-            switch (opt = getopt(argc, argv, "f:")) {
+            switch (opt = getopt_long(argc, argv, "f:l:c:", longOptions, NULL)) {
                 // case 't':
                 //     if(atoi(optarg) <= 0) {
                 //         fprintf(stderr, "%s: number of threads must be a positive integer!\n", basename(argv[0]));
@@ -111,21 +367,36 @@ int main(int argc, char *argv[]) {
                 //     }
                 //     nThreads = (int) atoi(optarg);
                 //     break;
+                case 'c':
+                    if(!parseChunkSize(optarg, &textSize)) {
+                        fprintf(stderr, "%s: chunk size must be auto or between %i KB and %i MB!\n", basename(argv[0]),
+                                CHUNKSIZE_MIN / 1024, CHUNKSIZE_MAX / (1024 * 1024));
+                        errFlg = true;
+                    }
+                    break;
                 case 'f':
                     optind--;
-                    for(;optind < argc && *argv[optind] != '-'; optind++) {
-                        if(nFiles >= MAXFILECOUNT) {
-                            fprintf(stderr, "%s: you may only select up to %i files!\n", basename(argv[0]), MAXFILECOUNT);
-                            errFlg = true;
-                            break;
-                        }
-                        char* fileName = argv[optind];
-                        if(strlen(fileName) > MAXFILENAMELEN) {
-                            fprintf(stderr, "%s: file names may not be larger than %i characters!\n", basename(argv[0]), MAXFILENAMELEN);
+                    for(;optind < argc && *argv[optind] != '-'; optind++) { // files or directory trees
+                        if(!addPath(&fileNames, argv[optind])) {
+                            fprintf(stderr, "%s: can not read %s: %s\n", basename(argv[0]), argv[optind], strerror(errno));
                             errFlg = true;
                             break;
                         }
-                        strcpy(files[nFiles++], fileName);
+                    }
+                    break;
+                case 'F':
+                    if(!parseFormat(optarg, &outputFormat)) {
+                        fprintf(stderr, "%s: output format must be text, json or csv!\n", basename(argv[0]));
+                        errFlg = true;
+                    }
+                    break;
+                case 'T':
+                    traceFile = optarg;
+                    break;
+                case 'l':
+                    if(!addPathList(&fileNames, optarg)) { // list of files or directory trees, one per line
+                        fprintf(stderr, "%s: can not read the paths listed in %s: %s\n", basename(argv[0]), optarg, strerror(errno));
+                        errFlg = true;
                     }
                     break;
                 case '?': 
@@ -144,19 +415,26 @@ int main(int argc, char *argv[]) {
             MPI_Finalize();
             return EXIT_FAILURE;
         }
+        files = fileNames.names;
+        nFiles = fileNames.count;
 
-        if(((wordCount = (unsigned int *)malloc(VOWELNUM * sizeof(unsigned int))) == NULL) ||
-           ((vowelCounts = (unsigned int **)malloc(nFiles * sizeof(unsigned int *))) == NULL) ||
-           ((fileBuffer = (unsigned int *)malloc(nFiles * sizeof(unsigned int))) == NULL) ||
+        if(((fileBuffer = (off_t *)malloc(nFiles * sizeof(off_t))) == NULL) ||
            ((fileOver = (bool *)malloc(nFiles * sizeof(bool))) == NULL) ||
-           ((currFileWorker = (int *)malloc((totProc-1) * sizeof(int))) == NULL)) {
+           ((fileError = (int *)calloc(nFiles, sizeof(int))) == NULL) ||
+           ((chunksOut = (unsigned int *)calloc(nFiles, sizeof(unsigned int))) == NULL) ||
+           ((fileStart = (double *)malloc(nFiles * sizeof(double))) == NULL) ||
+           ((workerStats = (struct workerStats *)malloc(totProc * sizeof(struct workerStats))) == NULL) ||
+           ((tallies = (struct wordTally *)calloc(nFiles, sizeof(struct wordTally))) == NULL) ||
+           ((received = (struct summaryRecord *)malloc(SUMMARYBATCH * sizeof(struct summaryRecord))) == NULL) ||
+           ((wordCount = (unsigned long long *)malloc(nFiles * sizeof(unsigned long long))) == NULL) ||
+           ((vowelCounts = (unsigned long long **)malloc(nFiles * sizeof(unsigned long long *))) == NULL)) {
             printf("Error on allocating space!\n");
             MPI_Finalize();
             return EXIT_FAILURE;
         }
         for(int i = 0; i < nFiles; i++) {
-            if((vowelCounts[i] = (unsigned int *)malloc(VOWELNUM * sizeof(unsigned int))) == NULL) {
-                printf("Error on allocating space to the vowel counts!\n");
+            if((vowelCounts[i] = (unsigned long long *)malloc(VOWELNUM * sizeof(unsigned long long))) == NULL) {
+                printf("Error on allocating space!\n");
                 MPI_Finalize();
                 return EXIT_FAILURE;
             }
@@ -165,192 +443,182 @@ int main(int argc, char *argv[]) {
         for(int i = 0; i < nFiles; i++) {
             fileBuffer[i] = 0; // all file processing starts at the beginning of the file
             fileOver[i] = false; // initially, no files are processed
-            for(int j = 0; j < VOWELNUM; j++) { // initialize word and vowel counts
-                vowelCounts[i][j] = 0;
-                wordCount[j] = 0;
-            }
-        }
-        for(int i = 0; i < (totProc-1); i++) { // initialize pointers from workers to files
-            currFileWorker[i] = 0;
         }
         currFile = 0; // processing starts with file with index 0
         workFinished = false;
+
+        // pick the chunk size from the throughput of the first chunks, if asked to
+        if(textSize == 0) textSize = tuneChunkSize(files, nFiles, totProc - 1, CHUNKCOST);
+    }
+
+    MPI_Bcast(&textSize, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    tracing = (traceFile != NULL);
+    MPI_Bcast(&tracing, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
+    if(tracing) { // every rank starts its clock as the barrier is left, so the tracks line up
+        char process[32];
+        snprintf(process, sizeof(process), "rank %d", rank);
+        MPI_Barrier(MPI_COMM_WORLD);
+        if(!traceOpen(traceFile, process, rank)) fprintf(stderr, "Error on allocating space to the trace.\n");
+        traceThread((rank == 0) ? "dispatcher" : "worker", rank);
+    }
+    if((chunk = (unsigned char *)malloc(textSize * sizeof(unsigned char))) == NULL) {
+        fprintf(stderr, "Error on allocating memory for text chunk.\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
     }
 
     // Processing
-    while(!workFinished) {
-        if(rank == 0) {
-            for(int currWorker = 1; currWorker < totProc; currWorker++) {
-                MPI_Send(&workFinished, sizeof(bool), MPI_C_BOOL, currWorker, 0, MPI_COMM_WORLD);
-                if(!workFinished) {
-                    currFileWorker[currWorker-1] = currFile;
-                    // int currFileInit = currFile;
-
-                    FILE * fp = fopen(files[currFile], "r");
-
-                    if(fseek(fp, fileBuffer[currFile], SEEK_SET) != 0) {
-                        fclose(fp);
-                        perror("Error repositioning file buffer.");
-                        MPI_Finalize();
-                        return EXIT_FAILURE;
-                    }
+    // chunks are cut at arbitrary byte offsets and indexed in hand-out order, workers send back their summaries in
+    // batches without waiting, the dispatcher stores them by chunk index as they arrive and folds them in order
+    // between hand-outs, each file is reported as soon as the summary of its last chunk is folded
+    if(rank == 0) { // hand out chunks to the workers in turn, then tell every one of them the work is finished
+        int currWorker = 1;
+        FILE * fp = NULL; // current file, opened once and read through chunk after chunk
+        reportBegin(outputFormat);
+        while(!workFinished && (nFiles > 0)) {
+            int chunkFileInit = currFile;
+
+            if(fp == NULL) { // first chunk of the file, its processing time starts
+                fileStart[currFile] = wallClock();
+                if((fp = fopen(files[currFile], "rb")) == NULL) { // files which can not be opened are left empty
+                    fileError[currFile] = errno;
+                    fprintf(stderr, "Error on opening file %s: %s\n", files[currFile], strerror(errno));
+                }
+            }
 
-                    // read chunk of text
-                    size_t bytesRead = fread(chunk, 1, MAXTEXTSIZE, fp);
+            // read chunk of text
+            double spanStart = traceNow();
+            size_t bytesRead = (fp != NULL) ? fread(chunk, 1, textSize, fp) : 0;
+            traceSpan("read", "io", spanStart);
+            if((fp != NULL) && ferror(fp)) { // the file is cut short where the read failed
+                fileError[currFile] = (errno != 0) ? errno : EIO;
+                fprintf(stderr, "Error on reading file %s: %s\n", files[currFile], strerror(fileError[currFile]));
+            }
 
-                    // verify if text contains only full words
-                    if(bytesRead < MAXTEXTSIZE) { // read captured the file until its end, so nothing was cut
-                        fileOver[currFile] = true;
-                        fileBuffer[currFile] += bytesRead;
-                        chunkSize = bytesRead;
-                    }
-                    else { // check if word/letter was cut in half
-                        // look forward, is it a separator character?
-                        unsigned char letter[4];
-                        fread(letter, 1, 4, fp);
-                        bool somethingCut = true;
-                        if((letter[0] & 0xC0) != 0x80) { // it's the start of an ASCII char, we didn't cut a character in half
-                            int size = getLetterSize(letter[0]);
-                            somethingCut = !isSeparator(letter, size); // but is it a separator? if not we might've cut a word in half
-                        }
-                        if(somethingCut) { // we cut something, time to uncut it (find the first separator inside the captured text chunk)
-                            int actualBytesRead;
-                            for(actualBytesRead = (int)bytesRead; actualBytesRead >= 0; actualBytesRead--) { // walking backwards
-                                if((chunk[actualBytesRead] & 0xC0) == 0x80) continue; // not the start of a letter, continue
-                                else {
-                                    int size = getLetterSize(chunk[actualBytesRead]);
-                                    for(int i = 0; i < size; i++) letter[i] = chunk[actualBytesRead + i]; 
-                                    int isSep = isSeparator(letter, size);
-                                    if(isSep) break; // found a separator, cut text chunk here
-                                }
-                            }
-                            // update variables for progress tracking
-                            fileBuffer[currFile] += actualBytesRead;
-                            chunkSize = actualBytesRead;
-                        }
-                        else { // nothing was cut, update variables for progress tracking
-                            fileBuffer[currFile] += bytesRead;
-                            chunkSize = bytesRead;
-                        }
-                    }
+            fileBuffer[currFile] += bytesRead;
+            chunksOut[currFile]++;
+            chunkSize = bytesRead;
+            if(bytesRead < textSize) { // read captured the file until its end
+                fileOver[currFile] = true;
+            }
 
-                    if(fileOver[currFile]) { // if this file ended, move on to next file
-                        currFile++;
-                        if(currFile >= nFiles) { // no more files to process, work is done
-                            workFinished = true;    
-                        } 
-                    }
+            if(fileOver[currFile]) { // if this file ended, close it and move on to next file
+                if(fp != NULL) fclose(fp);
+                fp = NULL;
+                currFile++;
+                if(currFile >= nFiles) { // no more files to process, work is done
+                    workFinished = true;    
+                } 
+            }
 
-                    fclose(fp);
+            // fold the summaries arrived meanwhile, without waiting for those still out
+            receiveSummaries(&pending, received, false);
+            for(struct pendingChunk * done; (done = nextFolded(&pending)) != NULL;) {
+                int f = done->file;
+                foldChunk(&tallies[f], &done->summary);
+                if((--chunksOut[f] == 0) && fileOver[f]) { // file is done
+                    finishFile(outputFormat, files[f], fileBuffer[f], fileStart[f], &tallies[f], &wordCount[f], vowelCounts[f],
+                               fileError[f]);
+                }
+            }
+            if(!handOutChunk(&pending, chunkFileInit, &chunkIndex)) { // the workers are waiting, do not leave them hanging
+                fprintf(stderr, "Error on allocating space to the chunks handed out.\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
 
-                    // TODO send chunk and size to worker
-                    MPI_Send(&chunk, sizeof(unsigned char) * MAXTEXTSIZE, MPI_CHAR, currWorker, 0, MPI_COMM_WORLD);
-                    MPI_Send(&chunkSize, sizeof(int), MPI_INT, currWorker, 0, MPI_COMM_WORLD);
+            // send chunk (its size is the message size) and its index
+            bool more = false;
+            spanStart = traceNow();
+            MPI_Send(&more, 1, MPI_C_BOOL, currWorker, 0, MPI_COMM_WORLD);
+            MPI_Send(&chunkIndex, 1, MPI_UNSIGNED_LONG_LONG, currWorker, 0, MPI_COMM_WORLD);
+            MPI_Send(chunk, chunkSize, MPI_UNSIGNED_CHAR, currWorker, 0, MPI_COMM_WORLD);
+            traceSpan("send chunk", "mpi", spanStart);
 
+            currWorker = (currWorker % (totProc - 1)) + 1;
+        }
+        workFinished = true; // workers send the summaries they still hold once told so
+        for(currWorker = 1; currWorker < totProc; currWorker++) {
+            MPI_Send(&workFinished, 1, MPI_C_BOOL, currWorker, 0, MPI_COMM_WORLD);
+        }
+        while(pending.folded < pending.handedOut) { // fold the summaries still out, waiting for them
+            receiveSummaries(&pending, received, true);
+            for(struct pendingChunk * done; (done = nextFolded(&pending)) != NULL;) {
+                int f = done->file;
+                foldChunk(&tallies[f], &done->summary);
+                if(--chunksOut[f] == 0) { // file is done
+                    finishFile(outputFormat, files[f], fileBuffer[f], fileStart[f], &tallies[f], &wordCount[f], vowelCounts[f],
+                               fileError[f]);
                 }
-                else {
-                    currFileWorker[currWorker-1] = -1;
-                }     
             }
         }
-        else {
-            // recieve work finished
-            MPI_Recv(&workFinished, sizeof(bool), MPI_C_BOOL, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            // printf("%d: Recieved workFinished %d\n", rank, workFinished);
-            if(!workFinished) {
-                // recieve chunk and size
-                MPI_Recv(&chunk, sizeof(unsigned char) * MAXTEXTSIZE, MPI_CHAR, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(&chunkSize, sizeof(int), MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                // printf("%d: Recieved chunk and chunk size (%d)\n", rank, chunkSize);
-
-                // processing
-                unsigned int wordCountPartial = 0;
-                unsigned int vowelCountPartial[VOWELNUM];
-                bool firstOccur[VOWELNUM];
-                for(int i = 0; i < VOWELNUM; i++) {
-                    vowelCountPartial[i] = 0;
-                    firstOccur[i] = false;
-                }
-                bool inWord = false;
-                unsigned int letterCount = 0;
-                for(int i = 0; i < chunkSize; i++) {
-                    letterCount++;
-                    unsigned char byte = chunk[i];
-                    unsigned char letter[4] = {byte, 0, 0, 0};
-                    int size = getLetterSize(byte);
-                    for(int j = 1; j < size; j++) letter[j] = chunk[++i];
-
-                    if(inWord) {
-                        if(isSeparator(letter, size)) inWord = false;
-                        else {
-                            unsigned char character = isVowel(letter, size);
-                            for(int j = 0; j < VOWELNUM; j++) {
-                                if(character == vowels[j] && !firstOccur[j]) {
-                                    vowelCountPartial[j]++;
-                                    firstOccur[j] = true;
-                                }
-                            }
-                        }
-                    }
-                    else {
-                        if(isAlpha(letter, size) || ((letter[0] == 0x5F) && (size = 1))) {
-                            wordCountPartial++;
-                            inWord = true;
-                            unsigned char character = isVowel(letter, size);
-                            for(int j = 0; j < VOWELNUM; j++) {
-                                firstOccur[j] = false;
-                                if(character == vowels[j]) {
-                                    vowelCountPartial[j]++;
-                                    firstOccur[j] = true;
-                                }
-                            }
-                        }
-                    }
-                }
-
-                // send counts to dispatcher
-                MPI_Send(&wordCountPartial, sizeof(unsigned int), MPI_INT, 0, 0, MPI_COMM_WORLD);
-                MPI_Send(&vowelCountPartial, sizeof(unsigned int) * VOWELNUM, MPI_INT, 0, 0, MPI_COMM_WORLD);
-
-                // check if work finished
-                MPI_Recv(&workFinished, sizeof(bool), MPI_C_BOOL, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                // printf("%d: Recieved workFinished %d\n", rank, workFinished);
+        free(pending.slots);
+        free(received);
+        for(int f = 0; f < nFiles; f++) filesFailed = filesFailed || (fileError[f] != 0);
+        for(currWorker = 1; currWorker < totProc; currWorker++) { // gather what each worker did, for the run report
+            MPI_Recv(&workerStats[currWorker - 1], sizeof(struct workerStats), MPI_BYTE, currWorker, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        reportRun(outputFormat, workerStats, totProc - 1, wallClock() - runStart);
+
+        for(currWorker = 1; tracing && (currWorker < totProc); currWorker++) { // gather the spans of the workers, in blocks
+            unsigned long long nEvents;
+            struct traceEvent events[TRACEBLOCK];
+            MPI_Recv(&nEvents, 1, MPI_UNSIGNED_LONG_LONG, currWorker, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            for(unsigned long long done = 0; done < nEvents; done += TRACEBLOCK) {
+                int block = (nEvents - done < TRACEBLOCK) ? (int)(nEvents - done) : TRACEBLOCK;
+                MPI_Recv(events, block * sizeof(struct traceEvent), MPI_BYTE, currWorker, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                traceImport(events, block);
             }
-            else {
+        }
+        if(!traceClose()) fprintf(stderr, "Error on writing trace file %s: %s\n", traceFile, strerror(errno));
+    }
+    else {
+        while(true) {
+            double since = wallClock(), spanStart = traceNow();
+
+            // recieve work finished
+            MPI_Recv(&workFinished, 1, MPI_C_BOOL, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            if(workFinished) {
+                stats.idle += wallClock() - since;
                 break;
             }
-        }
 
-        if(rank == 0) {
-            for(int currWorker = 1; currWorker < totProc; currWorker++) {
-                if(currFileWorker[currWorker-1] != -1) {
-                    int workerFile = currFileWorker[currWorker-1];
-                    unsigned int wordCountPartial;
-                    unsigned int vowelCountPartial[VOWELNUM]; 
-                    MPI_Recv(&wordCountPartial, sizeof(unsigned int), MPI_INT, currWorker, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    MPI_Recv(&vowelCountPartial, sizeof(unsigned int) * VOWELNUM, MPI_INT, currWorker, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    // printf("Disp: Recieved counts\n");
-
-                    wordCount[workerFile] += wordCountPartial;
-                    for(int i = 0; i < VOWELNUM; i++) {
-                        vowelCounts[workerFile][i] += vowelCountPartial[i];
-                    }
-                    MPI_Send(&workFinished, sizeof(bool), MPI_C_BOOL, currWorker, 0, MPI_COMM_WORLD);
-                }
+            // recieve chunk index and chunk
+            MPI_Status status;
+            MPI_Recv(&chunkIndex, 1, MPI_UNSIGNED_LONG_LONG, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Recv(chunk, textSize, MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &chunkSize);
+            double received = wallClock();
+            stats.idle += received - since;
+            traceSpan("recv chunk", "mpi", spanStart);
+
+            // processing, the summary is sent back to the dispatcher with the next ones
+            spanStart = traceNow();
+            summarizeChunk(chunk, chunkSize, &summary);
+            traceSpan("classify", "cpu", spanStart);
+            if(!storeSummary(&summaries, chunkIndex, &summary, chunkSize)) { // the dispatcher waits for it, do not hang
+                fprintf(stderr, "Error on allocating space to the chunk summaries.\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
             }
+            stats.busy += wallClock() - received;
+            stats.chunks++;
+            stats.bytes += chunkSize;
         }
-    }
-
-    if(rank == 0) {
-        for(int i = 0; i < nFiles; i++) {
-            printf("File name: %s\n", files[i]);
-            printf("Total number of words = %i\n", wordCount[i]);
-            printf("N. of words with an\n");
-            printf("\tA\tE\tI\tO\tU\tY\n");
-            printf("\t%i\t%i\t%i\t%i\t%i\t%i\n\n", vowelCounts[i][0], vowelCounts[i][1], vowelCounts[i][2], vowelCounts[i][3], vowelCounts[i][4], vowelCounts[i][5]);
+        endSummaries(&summaries);
+        MPI_Send(&stats, sizeof(struct workerStats), MPI_BYTE, 0, 0, MPI_COMM_WORLD); // for the run report
+
+        if(tracing) { // the dispatcher writes the spans of every rank
+            struct traceEvent * events;
+            unsigned long long nEvents = traceExport(&events);
+            MPI_Send(&nEvents, 1, MPI_UNSIGNED_LONG_LONG, 0, 0, MPI_COMM_WORLD);
+            for(unsigned long long done = 0; done < nEvents; done += TRACEBLOCK) {
+                int block = (nEvents - done < TRACEBLOCK) ? (int)(nEvents - done) : TRACEBLOCK;
+                MPI_Send(&events[done], block * sizeof(struct traceEvent), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+            }
+            free(events);
+            traceClose();
         }
     }
 
     MPI_Finalize();
-    return EXIT_SUCCESS;
+    return filesFailed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1 @@
+../../CLE1_T1G6/prog1/prog1Report.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../CLE1_T1G6/prog1/prog1Utils.h
\ No newline at end of file
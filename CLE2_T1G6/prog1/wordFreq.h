@@ -0,0 +1 @@
+../../CLE1_T1G6/prog1/wordFreq.h
\ No newline at end of file